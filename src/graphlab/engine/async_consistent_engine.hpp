@@ -27,6 +27,7 @@
 #define GRAPHLAB_ASYNC_CONSISTENT_ENGINE
 
 #include <deque>
+#include <fstream>
 #include <boost/bind.hpp>
 
 #include <graphlab/scheduler/ischeduler.hpp>
@@ -41,6 +42,8 @@
 #include <graphlab/rpc/dc_dist_object.hpp>
 #include <graphlab/engine/distributed_chandy_misra.hpp>
 #include <graphlab/engine/message_array.hpp>
+#include <graphlab/engine/task_profiler.hpp>
+#include <graphlab/engine/residual_tracker.hpp>
 
 #include <graphlab/util/tracepoint.hpp>
 #include <graphlab/util/memory_info.hpp>
@@ -198,8 +201,50 @@ namespace graphlab {
    * model to factorized consistency where only individual gather/apply/scatter
    * calls are guaranteed to be locally consistent. Can produce massive
    * increases in throughput at a consistency penalty.
+   * \li \b optimistic (default: false) With factorized=false, run the
+   * vertices whose whole neighborhood is local to the machine optimistically
+   * instead of through the distributed locks. The update gathers without
+   * locks and commits only if no neighbor changed since, retrying
+   * otherwise. The other vertices still use the distributed locks.
+   * \li \b optimistic_retries (default: 3) The number of times an optimistic
+   * update is retried before it falls back to the distributed locks.
+   * \li \b lock_batch (default: 0) With factorized=false, buffer up to
+   * this many distributed lock messages to each machine and send them in a
+   * single call. 0 sends every lock message on its own.
+   * \li \b lock_batch_window (default: 100) The longest time in
+   * microseconds a lock message is held back for batching.
+   * \li \b use_cache (default: false) Cache the gather of each vertex.
+   * Each machine caches the partial gather over its own edges, which
+   * \ref icontext::post_delta updates and \ref icontext::clear_gather_cache
+   * clears. With factorized=false the deltas and clears are also
+   * forwarded to the master, before the update which made them releases
+   * its locks. The master keeps the total gather up to date and reuses it
+   * without contacting the mirrors until a cache of the vertex is
+   * cleared. With factorized=true nothing orders a forwarded delta before
+   * the updates it may cause, so the master always gathers from the
+   * mirrors.
    * \li \b nfibers (default: 10000) Number of fibers to use
    * \li \b stacksize (default: 16384) Stacksize of each fiber.
+   * If the environment variable GRAPHLAB_FIBER_STACK_USAGE=1 is set, the
+   * deepest stack use of the fibers is logged at the end of start().
+   * \li \b profile_rate (default: 0) Fraction of the tasks to profile.
+   * A sampled task is timed in each of its phases: lock acquisition,
+   * gather, waiting for the mirror gathers, apply, scatter and waiting for
+   * the mirror scatters. The times and the number of fiber context switches
+   * are accumulated by the log2 of the vertex degree. At the end of start()
+   * the histogram is shown on the metrics server as task_profile.json.
+   * \li \b profile_file (default: none) If set with profile_rate, the
+   * histogram is written to this file as a tab separated table.
+   * \li \b residual_l1 (default: 0) If positive, stop once the sum of the
+   * last residuals reported by the vertices through
+   * \ref icontext::report_residual falls to this value. Every vertex must
+   * have reported a residual. Each machine sends the summary of its
+   * residuals to machine 0 about every 100ms, so the engine may run a
+   * little past the point of convergence.
+   * \li \b residual_linf (default: 0) If positive, stop once the largest
+   * of the last residuals reported by the vertices falls to this value.
+   * The largest residual is bounded from a histogram of the residuals and
+   * may be overestimated by up to a factor of 2.
    */
   template<typename VertexProgram>
   class async_consistent_engine: public iengine<VertexProgram> {
@@ -349,8 +394,68 @@ namespace graphlab {
      */
     dense_bitset has_cache;
 
+    /**
+     * \brief The epoch of the master gather the local gather cache of
+     * each vertex was last returned to.
+     *
+     * A delta posted to the local cache is forwarded to the master
+     * tagged with this epoch, and the master only accepts deltas of its
+     * current epoch. Deltas already contained in a returned cache are
+     * therefore not counted twice.
+     */
+    std::vector<uint32_t> cache_epoch;
+
+    /**
+     * \brief On the master, the total gather over all machines, kept up
+     * to date with the deltas forwarded by the mirrors. While a gather is
+     * in progress it accumulates the deltas posted since.
+     */
+    std::vector<gather_type> gather_total;
+
+    /// On the master, a bit indicating if gather_total is complete
+    dense_bitset has_total;
+
+    /**
+     * \brief On the master, the epoch of the latest gather of each
+     * vertex. Incremented by each gather and by each clear.
+     */
+    std::vector<uint32_t> gather_epoch;
+
+    /// Protects the caches of each vertex
+    std::vector<simple_spinlock> cachelocks;
+
+    /// The gather cache accounted to memory_info::GATHER_CACHE
+    memory_info::tracked_size gather_cache_size;
+
     bool use_cache;
 
+    /**
+     * Keep the total gather on the master. Requires use_cache and the
+     * distributed locks: the changes an update makes to the totals on
+     * other machines reach them before it releases its locks, so no
+     * update of a neighbor uses a total which is missing them.
+     */
+    bool use_total;
+
+    /**
+     * \brief A delta posted to, or a clear of, the gather cache of a
+     * vertex, to be applied to the total on its master.
+     */
+    struct total_change {
+      vertex_id_type vid;
+      procid_t owner;
+      bool clear;
+      uint32_t epoch;
+      gather_type delta;
+      void save(oarchive& oarc) const {
+        oarc << vid << owner << clear << epoch << delta;
+      }
+      void load(iarchive& iarc) {
+        iarc >> vid >> owner >> clear >> epoch >> delta;
+      }
+    };
+    typedef std::vector<total_change> total_change_list;
+
     /// Engine threads.
     fiber_group thrgroup;
 
@@ -370,6 +475,12 @@ namespace graphlab {
     bool started;
 
     bool track_task_time;
+
+    /// Samples the cost of tasks. Enabled by the profile_rate option
+    task_profiler profiler;
+    double profile_rate;
+    std::string profile_file;
+
     /// A pointer to the distributed consensus object
     fiber_async_consensus* consensus;
 
@@ -384,6 +495,40 @@ namespace graphlab {
       size_t fiber_handle;
     };
     std::vector<vertex_fiber_cm_handle*> cm_handles;
+    /// engine options. Batching of the distributed lock messages
+    size_t lock_batch;
+    size_t lock_batch_window;
+
+    /// engine options. Tolerances on the residuals reported by the vertices
+    double residual_l1;
+    double residual_linf;
+    /// The last residual reported by each vertex
+    residual_tracker residuals;
+    /// On machine 0, the last residual summary received from each machine
+    std::vector<residual_tracker::summary> machine_residuals;
+    mutex machine_residuals_lock;
+    /// On machine 0, true once convergence has been announced
+    bool residuals_converged;
+
+    /// engine option. Runs fully local neighborhoods optimistically
+    bool optimistic;
+    size_t optimistic_retries;
+    /**
+     * Used only by the optimistic mode. The version of each vertex is odd
+     * while an update of the vertex may be writing to its data or its
+     * adjacent edges, and is incremented on entering and leaving the
+     * update. An optimistic update commits only if the versions of its
+     * neighbors are unchanged since the gather.
+     */
+    std::vector<uint32_t> vertex_version;
+    /// The vertices which may be updated optimistically: those whose
+    /// neighborhood has no mirrors
+    dense_bitset occ_eligible;
+    /// The vertices adjacent to a vertex in occ_eligible. Their locked
+    /// updates must exclude the optimistic updates of their neighbors.
+    dense_bitset occ_adjacent;
+    atomic<uint64_t> optimistic_commits;
+    atomic<uint64_t> optimistic_aborts;
 
     dense_bitset program_running;
     dense_bitset hasnext;
@@ -438,7 +583,8 @@ namespace graphlab {
     async_consistent_engine(distributed_control &dc,
                             graph_type& graph,
                             const graphlab_options& opts = graphlab_options()) :
-        rmi(dc, this), graph(graph), scheduler_ptr(NULL),
+        rmi(dc, this), graph(graph),
+        gather_cache_size(memory_info::GATHER_CACHE), scheduler_ptr(NULL),
         aggregator(dc, graph, new context_type(*this, graph)), started(false),
         engine_start_time(timer::approx_time_seconds()), force_stop(false) {
       rmi.barrier();
@@ -446,13 +592,23 @@ namespace graphlab {
       nfibers = 10000;
       stacksize = 16384;
       use_cache = false;
+      use_total = false;
       factorized_consistency = true;
+      optimistic = false;
+      optimistic_retries = 3;
+      lock_batch = 0;
+      lock_batch_window = 100;
       track_task_time = false;
+      profile_rate = 0;
+      residual_l1 = 0;
+      residual_linf = 0;
+      residuals_converged = false;
       timed_termination = (size_t)(-1);
       termination_reason = execution_status::UNSET;
       set_options(opts);
       init();
       total_completion_time.resize(fiber_control::get_instance().num_workers());
+      profiler.init(fiber_control::get_instance().num_workers(), profile_rate);
       init();
       rmi.barrier();
     }
@@ -484,6 +640,25 @@ namespace graphlab {
           opts.get_engine_args().get_option("factorized", factorized_consistency);
           if (rmi.procid() == 0)
             logstream(LOG_EMPH) << "Engine Option: factorized = " << factorized_consistency << std::endl;
+        } else if (opt == "optimistic") {
+          opts.get_engine_args().get_option("optimistic", optimistic);
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: optimistic = " << optimistic << std::endl;
+        } else if (opt == "optimistic_retries") {
+          opts.get_engine_args().get_option("optimistic_retries", optimistic_retries);
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: optimistic_retries = " << optimistic_retries << std::endl;
+        } else if (opt == "lock_batch") {
+          opts.get_engine_args().get_option("lock_batch", lock_batch);
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: lock_batch = " << lock_batch << std::endl;
+        } else if (opt == "lock_batch_window") {
+          opts.get_engine_args().get_option("lock_batch_window", lock_batch_window);
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: lock_batch_window = " << lock_batch_window << std::endl;
+          if (lock_batch_window == 0) {
+            logstream(LOG_FATAL) << "lock_batch_window must be positive" << std::endl;
+          }
         } else if (opt == "nfibers") {
           opts.get_engine_args().get_option("nfibers", nfibers);
           if (rmi.procid() == 0)
@@ -492,7 +667,26 @@ namespace graphlab {
           opts.get_engine_args().get_option("track_task_time", track_task_time);
           if (rmi.procid() == 0)
             logstream(LOG_EMPH) << "Engine Option: track_task_time = " << track_task_time<< std::endl;
-        }else if (opt == "stacksize") {
+        } else if (opt == "profile_rate") {
+          opts.get_engine_args().get_option("profile_rate", profile_rate);
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: profile_rate = " << profile_rate << std::endl;
+          if (profile_rate < 0 || profile_rate > 1) {
+            logstream(LOG_FATAL) << "profile_rate must be between 0 and 1" << std::endl;
+          }
+        } else if (opt == "profile_file") {
+          opts.get_engine_args().get_option("profile_file", profile_file);
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: profile_file = " << profile_file << std::endl;
+        } else if (opt == "residual_l1") {
+          opts.get_engine_args().get_option("residual_l1", residual_l1);
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: residual_l1 = " << residual_l1 << std::endl;
+        } else if (opt == "residual_linf") {
+          opts.get_engine_args().get_option("residual_linf", residual_linf);
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: residual_linf = " << residual_linf << std::endl;
+        } else if (opt == "stacksize") {
           opts.get_engine_args().get_option("stacksize", stacksize);
           if (rmi.procid() == 0)
             logstream(LOG_EMPH) << "Engine Option: stacksize= " << stacksize << std::endl;
@@ -504,6 +698,13 @@ namespace graphlab {
           logstream(LOG_FATAL) << "Unexpected Engine Option: " << opt << std::endl;
         }
       }
+      if (optimistic && factorized_consistency) {
+        if (rmi.procid() == 0)
+          logstream(LOG_WARNING) << "optimistic requires factorized=false. "
+                                 << "Ignoring." << std::endl;
+        optimistic = false;
+      }
+      use_total = use_cache && !factorized_consistency;
       opts_copy = opts;
       // set a default scheduler if none
       if (opts_copy.get_scheduler_type() == "") {
@@ -520,7 +721,7 @@ namespace graphlab {
       if (factorized_consistency == false) {
         cmlocks = new distributed_chandy_misra<graph_type>(rmi.dc(), graph,
                                                     boost::bind(&engine_type::lock_ready, this, _1));
-                                                    
+        cmlocks->set_batching(lock_batch, lock_batch_window);
       }
       else {
         cmlocks = NULL;
@@ -549,14 +750,73 @@ namespace graphlab {
         gather_cache.resize(graph.num_local_vertices(), gather_type());
         has_cache.resize(graph.num_local_vertices());
         has_cache.clear();
+        cache_epoch.resize(graph.num_local_vertices(), 0);
+        gather_total.resize(graph.num_local_vertices(), gather_type());
+        has_total.resize(graph.num_local_vertices());
+        has_total.clear();
+        gather_epoch.resize(graph.num_local_vertices(), 0);
+        cachelocks.resize(graph.num_local_vertices());
+        gather_cache_size.set(
+            (gather_cache.capacity() + gather_total.capacity()) *
+            sizeof(gather_type) +
+            (cache_epoch.capacity() + gather_epoch.capacity()) *
+            sizeof(uint32_t) +
+            cachelocks.capacity() * sizeof(simple_spinlock) +
+            (has_cache.size() + has_total.size()) / 8);
       }
       if (!factorized_consistency) {
         cm_handles.resize(graph.num_local_vertices());
       }
+      if (optimistic) init_optimistic();
+      residuals.init(fiber_control::get_instance().num_workers(),
+                     graph.num_local_vertices(), residual_l1, residual_linf);
       rmi.barrier();
     }
 
 
+    /**
+     * \internal
+     * Finds the vertices which can be updated optimistically. Those are
+     * the vertices which, like all their neighbors, have no mirrors: all
+     * the data their updates touch is on this machine, and none of it is
+     * touched by updates on other machines.
+     */
+    void init_optimistic() {
+      const size_t nverts = graph.num_local_vertices();
+      vertex_version.assign(nverts, 0);
+      occ_eligible.resize(nverts);
+      occ_eligible.clear();
+      occ_adjacent.resize(nverts);
+      occ_adjacent.clear();
+      for (lvid_type lvid = 0; lvid < nverts; ++lvid) {
+        local_vertex_type local_vertex(graph.l_vertex(lvid));
+        bool eligible = local_vertex.num_mirrors() == 0;
+        foreach(local_edge_type local_edge, local_vertex.in_edges()) {
+          if (!eligible) break;
+          eligible = local_edge.source().num_mirrors() == 0;
+        }
+        foreach(local_edge_type local_edge, local_vertex.out_edges()) {
+          if (!eligible) break;
+          eligible = local_edge.target().num_mirrors() == 0;
+        }
+        if (!eligible) continue;
+        occ_eligible.set_bit_unsync(lvid);
+        foreach(local_edge_type local_edge, local_vertex.in_edges()) {
+          occ_adjacent.set_bit_unsync(local_edge.source().id());
+        }
+        foreach(local_edge_type local_edge, local_vertex.out_edges()) {
+          occ_adjacent.set_bit_unsync(local_edge.target().id());
+        }
+      }
+      size_t neligible = occ_eligible.popcount();
+      rmi.all_reduce(neligible);
+      if (rmi.procid() == 0) {
+        logstream(LOG_INFO) << neligible << " vertices may be updated "
+                            << "optimistically" << std::endl;
+      }
+    }
+
+
 
   public:
     ~async_consistent_engine() {
@@ -573,6 +833,19 @@ namespace graphlab {
       return programs_executed.value;
     }
 
+    /// The number of updates this machine committed optimistically
+    size_t num_optimistic_commits() const {
+      return optimistic_commits.value;
+    }
+
+    /**
+     * The number of optimistic attempts this machine aborted. With
+     * optimistic_retries=0 each of them fell back to the locks.
+     */
+    size_t num_optimistic_aborts() const {
+      return optimistic_aborts.value;
+    }
+
 
 
 
@@ -690,6 +963,71 @@ namespace graphlab {
     }
 
 
+    /**
+     * \brief Sets the residual of a vertex.
+     *
+     * This function is called by the \ref graphlab::context.
+     *
+     * @param [in] vertex the vertex being updated
+     * @param [in] residual the residual of the vertex
+     */
+    void internal_report_residual(const vertex_type& vertex,
+                                  double residual) {
+      residuals.report(vertex.local_id(), residual);
+    }
+
+    /**
+     * \internal
+     * Sends the summary of the local residuals to machine 0. Called
+     * periodically by one fiber on each machine.
+     */
+    void send_residual_summary() {
+      const residual_tracker::summary local = residuals.get_summary();
+      if (rmi.procid() == 0) {
+        rpc_residual_summary(0, local);
+      } else {
+        rmi.remote_call(0, &async_consistent_engine::rpc_residual_summary,
+                        rmi.procid(), local);
+      }
+    }
+
+    /**
+     * \internal
+     * Called on machine 0 with the residual summary of a machine. Stops
+     * all machines once the latest summaries of all machines together
+     * meet the tolerances.
+     */
+    void rpc_residual_summary(procid_t proc,
+                              const residual_tracker::summary& local) {
+      residual_tracker::summary total;
+      machine_residuals_lock.lock();
+      if (!started || proc >= machine_residuals.size()) {
+        machine_residuals_lock.unlock();
+        return;
+      }
+      machine_residuals[proc] = local;
+      for (size_t i = 0; i < machine_residuals.size(); ++i) {
+        total += machine_residuals[i];
+      }
+      const bool stop = !residuals_converged &&
+          residuals.converged(total, graph.num_vertices());
+      if (stop) residuals_converged = true;
+      machine_residuals_lock.unlock();
+      if (stop) {
+        logstream(LOG_EMPH) << "Converged with residual L1: " << total.l1
+                            << " Linf: " << total.linf() << std::endl;
+        for (procid_t i = 0;i < rmi.numprocs(); ++i) {
+          rmi.remote_call(i, &async_consistent_engine::rpc_residual_converged);
+        }
+      }
+    }
+
+    void rpc_residual_converged() {
+      force_stop = true;
+      termination_reason = execution_status::CONVERGED;
+    }
+
+
 
     /**
      * \brief Post a to a previous gather for a give vertex.
@@ -703,16 +1041,35 @@ namespace graphlab {
                              const gather_type& delta) {
       if(use_cache) {
         const lvid_type lvid = vertex.local_id();
-        vertexlocks[lvid].lock();
+        bool forward = false;
+        uint32_t epoch = 0;
+        cachelocks[lvid].lock();
         if( has_cache.get(lvid) ) {
           gather_cache[lvid] += delta;
+          forward = use_total;
+          epoch = cache_epoch[lvid];
         } else {
           // You cannot add a delta to an empty cache.  A complete
           // gather must have been run.
           // gather_cache[lvid] = delta;
           // has_cache.set_bit(lvid);
         }
-        vertexlocks[lvid].unlock();
+        cachelocks[lvid].unlock();
+        // keep the total on the master up to date
+        if (forward) {
+          const procid_t owner = graph.l_get_vertex_record(lvid).owner;
+          if (owner == rmi.procid()) {
+            master_post_delta(vertex.id(), epoch, delta);
+          } else {
+            total_change change;
+            change.vid = vertex.id();
+            change.owner = owner;
+            change.clear = false;
+            change.epoch = epoch;
+            change.delta = delta;
+            forward_total_change(change);
+          }
+        }
       }
     }
 
@@ -727,12 +1084,139 @@ namespace graphlab {
     void internal_clear_gather_cache(const vertex_type& vertex) {
       const lvid_type lvid = vertex.local_id();
       if(use_cache && has_cache.get(lvid)) {
-        vertexlocks[lvid].lock();
+        cachelocks[lvid].lock();
         gather_cache[lvid] = gather_type();
         has_cache.clear_bit(lvid);
-        vertexlocks[lvid].unlock();
+        cachelocks[lvid].unlock();
+        if (!use_total) return;
+        // the total on the master is no longer complete
+        const procid_t owner = graph.l_get_vertex_record(lvid).owner;
+        if (owner == rmi.procid()) {
+          master_clear_gather_total(vertex.id());
+        } else {
+          total_change change;
+          change.vid = vertex.id();
+          change.owner = owner;
+          change.clear = true;
+          change.epoch = 0;
+          forward_total_change(change);
+        }
+      }
+
+    }
+
+    /**
+     * \internal
+     * Sends a change to the total of a vertex to its master on another
+     * machine. Within scatter_collecting the change is instead added to
+     * the list of the scatter, to be sent before the locks are released.
+     */
+    void forward_total_change(const total_change& change) {
+      if (fiber_control::in_fiber() && fiber_control::get_tls() != NULL) {
+        static_cast<total_change_list*>(fiber_control::get_tls())
+            ->push_back(change);
+      } else {
+        rmi.remote_call(change.owner, &engine_type::rpc_total_changes,
+                        total_change_list(1, change));
+      }
+    }
+
+    /**
+     * \internal
+     * Applies changes to the totals of vertices on their master.
+     */
+    void rpc_total_changes(const total_change_list& changes) {
+      foreach(const total_change& change, changes) {
+        if (change.clear) master_clear_gather_total(change.vid);
+        else master_post_delta(change.vid, change.epoch, change.delta);
       }
+    }
 
+    /**
+     * \internal
+     * Sends changes to the totals to their masters, and waits until they
+     * are applied. Must be called from a fiber.
+     */
+    void send_total_changes(const total_change_list& changes) {
+      if (changes.empty()) return;
+      std::vector<total_change_list> by_owner(rmi.numprocs());
+      foreach(const total_change& change, changes) {
+        by_owner[change.owner].push_back(change);
+      }
+      std::vector<request_future<void> > futures;
+      for (procid_t p = 0; p < by_owner.size(); ++p) {
+        if (by_owner[p].empty()) continue;
+        futures.push_back(
+            object_fiber_remote_request(rmi, p,
+                                        &engine_type::rpc_total_changes,
+                                        by_owner[p]));
+      }
+      for (size_t i = 0; i < futures.size(); ++i) futures[i]();
+    }
+
+    /**
+     * \internal
+     * Called on the master when a delta is posted to the gather cache of
+     * a vertex on any machine. The delta is added to the total if it was
+     * posted to a cache returned to the current gather of the vertex.
+     */
+    void master_post_delta(vertex_id_type vid, uint32_t epoch,
+                           const gather_type& delta) {
+      const lvid_type lvid = graph.local_vid(vid);
+      cachelocks[lvid].lock();
+      if (epoch == gather_epoch[lvid]) gather_total[lvid] += delta;
+      cachelocks[lvid].unlock();
+    }
+
+    /**
+     * \internal
+     * Called on the master when the gather cache of a vertex is cleared
+     * on any machine.
+     */
+    void master_clear_gather_total(vertex_id_type vid) {
+      const lvid_type lvid = graph.local_vid(vid);
+      cachelocks[lvid].lock();
+      has_total.clear_bit(lvid);
+      gather_total[lvid] = gather_type();
+      // fail gathers in progress and discard deltas in flight
+      ++gather_epoch[lvid];
+      cachelocks[lvid].unlock();
+    }
+
+    /**
+     * \internal
+     * On the master, returns the total gather of a vertex in ret if it
+     * is complete. Otherwise begins a new gather epoch, which is returned
+     * in epoch, and returns false.
+     */
+    bool begin_gather(lvid_type lvid, conditional_gather_type& ret,
+                      uint32_t& epoch) {
+      cachelocks[lvid].lock();
+      const bool complete = has_total.get(lvid);
+      if (complete) {
+        ret.set(gather_total[lvid]);
+      } else {
+        epoch = ++gather_epoch[lvid];
+        gather_total[lvid] = gather_type();
+      }
+      cachelocks[lvid].unlock();
+      return complete;
+    }
+
+    /**
+     * \internal
+     * On the master, completes the total gather of a vertex with the
+     * result of the gather of the given epoch, unless the caches were
+     * cleared in the meantime.
+     */
+    void end_gather(lvid_type lvid, uint32_t epoch,
+                    const conditional_gather_type& result) {
+      cachelocks[lvid].lock();
+      if (epoch == gather_epoch[lvid]) {
+        gather_total[lvid] += result.value;
+        has_total.set_bit(lvid);
+      }
+      cachelocks[lvid].unlock();
     }
 
   public:
@@ -760,12 +1244,13 @@ namespace graphlab {
       // allocate a vector with all the local owned vertices
       // and schedule all of them.
       std::vector<vertex_id_type> vtxs;
-      vtxs.reserve(graph.num_local_own_vertices());
-      for(lvid_type lvid = 0;
-          lvid < graph.get_local_graph().num_vertices();
-          ++lvid) {
-        if (graph.l_vertex(lvid).owner() == rmi.procid() &&
-            vset.l_contains(lvid)) {
+      const size_t nscan =
+          vset.scan_size(graph.get_local_graph().num_vertices());
+      vtxs.reserve(std::min(nscan, graph.num_local_own_vertices()));
+      for(size_t i = 0; i < nscan; ++i) {
+        const lvid_type lvid = vset.scan_lvid(i);
+        if (lvid != lvid_type(-1) &&
+            graph.l_vertex(lvid).owner() == rmi.procid()) {
           vtxs.push_back(lvid);
         }
       }
@@ -872,9 +1357,24 @@ namespace graphlab {
 
 
     conditional_gather_type perform_gather(vertex_id_type vid,
-                               vertex_program_type& vprog_) {
+                               vertex_program_type& vprog_,
+                               uint32_t epoch) {
       vertex_program_type vprog = vprog_;
-      lvid_type lvid = graph.local_vid(vid);
+      return gather_local(graph.local_vid(vid), vprog, epoch, true);
+    }
+
+    /**
+     * \internal
+     * Gathers over the local edges of a vertex, using the gather cache
+     * if it is available. If store_cache is false, a gather which is
+     * computed is not written to the cache and the cache epoch is left
+     * unchanged: the caller stores it with store_gather_cache once the
+     * gather is known to be valid.
+     */
+    conditional_gather_type gather_local(lvid_type lvid,
+                                         vertex_program_type& vprog,
+                                         uint32_t epoch,
+                                         bool store_cache) {
       local_vertex_type local_vertex(graph.l_vertex(lvid));
       vertex_type vertex(local_vertex);
       context_type context(*this, graph);
@@ -882,9 +1382,15 @@ namespace graphlab {
       conditional_gather_type accum;
 
       //check against the cache
-      if( use_cache && has_cache.get(lvid) ) {
+      if (use_cache) {
+        cachelocks[lvid].lock();
+        if (store_cache) cache_epoch[lvid] = epoch;
+        if (has_cache.get(lvid)) {
           accum.set(gather_cache[lvid]);
+          cachelocks[lvid].unlock();
           return accum;
+        }
+        cachelocks[lvid].unlock();
       }
       // do in edges
       if(gather_dir == IN_EDGES || gather_dir == ALL_EDGES) {
@@ -910,15 +1416,33 @@ namespace graphlab {
           vertexlocks[b].unlock();
         }
       } 
-      if (use_cache) {
+      if (use_cache && store_cache) {
+        cachelocks[lvid].lock();
         gather_cache[lvid] = accum.value; has_cache.set_bit(lvid);
+        cachelocks[lvid].unlock();
       }
       return accum;
     }
 
+    /**
+     * \internal
+     * Stores a validated gather of a vertex in the gather cache unless
+     * the cache already holds one, which may have received deltas since.
+     */
+    void store_gather_cache(lvid_type lvid, uint32_t epoch,
+                            const conditional_gather_type& result) {
+      cachelocks[lvid].lock();
+      cache_epoch[lvid] = epoch;
+      if (!has_cache.get(lvid)) {
+        gather_cache[lvid] = result.value; has_cache.set_bit(lvid);
+      }
+      cachelocks[lvid].unlock();
+    }
+
 
     void perform_scatter_local(lvid_type lvid,
-                               vertex_program_type& vprog) {
+                               vertex_program_type& vprog,
+                               bool release_locks = true) {
       local_vertex_type local_vertex(graph.l_vertex(lvid));
       vertex_type vertex(local_vertex);
       context_type context(*this, graph);
@@ -947,21 +1471,45 @@ namespace graphlab {
       } 
 
       // release locks
-      if (!factorized_consistency) {
+      if (!factorized_consistency && release_locks) {
         cmlocks->philosopher_stops_eating_per_replica(lvid);
       }
     }
 
 
-    void perform_scatter(vertex_id_type vid,
-                    vertex_program_type& vprog_,
-                    const vertex_data_type& newdata) {
+    /**
+     * \internal
+     * Runs the scatter of a vertex on this machine without releasing its
+     * locks. The changes it makes to the totals on other machines are
+     * returned instead of being sent.
+     */
+    total_change_list scatter_collecting(lvid_type lvid,
+                                         vertex_program_type& vprog) {
+      total_change_list changes;
+      void* prev = fiber_control::get_tls();
+      fiber_control::set_tls(&changes);
+      perform_scatter_local(lvid, vprog, false);
+      fiber_control::set_tls(prev);
+      return changes;
+    }
+
+    /**
+     * \internal
+     * Runs the scatter of a vertex on a mirror. With use_total the locks
+     * are released by the master once the returned changes to the totals
+     * are applied.
+     */
+    total_change_list perform_scatter(vertex_id_type vid,
+                                      vertex_program_type& vprog_,
+                                      const vertex_data_type& newdata) {
       vertex_program_type vprog = vprog_;
       lvid_type lvid = graph.local_vid(vid);
       vertexlocks[lvid].lock();
       graph.l_vertex(lvid).data() = newdata;
       vertexlocks[lvid].unlock();
+      if (use_total) return scatter_collecting(lvid, vprog);
       perform_scatter_local(lvid, vprog);
+      return total_change_list();
     }
 
 
@@ -1001,6 +1549,140 @@ namespace graphlab {
     }
 
 
+    /// Reads the version of a vertex
+    uint32_t get_version(lvid_type lvid) const {
+      return *(reinterpret_cast<const volatile uint32_t*>(&vertex_version[lvid]));
+    }
+
+
+    /**
+     * \internal
+     * Called by a locked update of a vertex in occ_adjacent once its
+     * distributed locks are acquired. Marks the vertex as being updated,
+     * then waits for the optimistic updates of its neighbors which may
+     * have already validated to finish. Those which have not yet validated
+     * will see the mark and retry.
+     */
+    void exclude_optimistic_neighbors(lvid_type lvid) {
+      __sync_fetch_and_add(&vertex_version[lvid], 1);
+      local_vertex_type local_vertex(graph.l_vertex(lvid));
+      foreach(local_edge_type local_edge, local_vertex.in_edges()) {
+        const lvid_type other = local_edge.source().id();
+        if (!occ_eligible.get(other) || other == lvid) continue;
+        while (get_version(other) & 1) fiber_control::yield();
+      }
+      foreach(local_edge_type local_edge, local_vertex.out_edges()) {
+        const lvid_type other = local_edge.target().id();
+        if (!occ_eligible.get(other) || other == lvid) continue;
+        while (get_version(other) & 1) fiber_control::yield();
+      }
+    }
+
+
+    /**
+     * \internal
+     * Runs the update of a vertex in occ_eligible without the distributed
+     * locks. The versions of the neighbors are recorded and the gather
+     * runs without locks. The vertex is then marked as being updated,
+     * and the update commits, running the apply and the scatter, only if
+     * the versions of the neighbors have not changed. Otherwise the mark
+     * is removed and the update is retried. Returns false if the update
+     * did not commit in optimistic_retries + 1 attempts.
+     */
+    bool optimistic_update(const lvid_type lvid,
+                           const message_type& msg,
+                           bool profiled,
+                           task_profiler::task_record& prof) {
+      local_vertex_type local_vertex(graph.l_vertex(lvid));
+      vertex_type vertex(local_vertex);
+      context_type context(*this, graph);
+      vertex_program_type vprog = vertex_program_type();
+      vprog.init(context, vertex, msg);
+      std::vector<std::pair<lvid_type, uint32_t> > versions;
+      for (size_t attempt = 0; attempt <= optimistic_retries; ++attempt) {
+        if (attempt > 0) {
+          optimistic_aborts.inc();
+          fiber_control::yield();
+        }
+        // record the versions of the neighbors. Give up at once if one
+        // of them is being updated
+        versions.clear();
+        bool busy = false;
+        foreach(local_edge_type local_edge, local_vertex.in_edges()) {
+          const lvid_type other = local_edge.source().id();
+          versions.push_back(std::make_pair(other, get_version(other)));
+          busy |= (versions.back().second & 1) && other != lvid;
+        }
+        foreach(local_edge_type local_edge, local_vertex.out_edges()) {
+          const lvid_type other = local_edge.target().id();
+          versions.push_back(std::make_pair(other, get_version(other)));
+          busy |= (versions.back().second & 1) && other != lvid;
+        }
+        if (busy) continue;
+        // the gather is not cached and the total is not completed until
+        // the update is validated. An aborted attempt leaves has_total
+        // unset, so its epoch is never completed
+        conditional_gather_type gather_result;
+        uint32_t epoch = 0;
+        const bool have_total =
+            use_total && begin_gather(lvid, gather_result, epoch);
+        if (!have_total) {
+          gather_result = gather_local(lvid, vprog, epoch, false);
+        }
+        if (profiled) prof.end_phase(task_profiler::GATHER);
+
+        // validate
+        __sync_fetch_and_add(&vertex_version[lvid], 1);
+        bool valid = true;
+        for (size_t i = 0; i < versions.size() && valid; ++i) {
+          valid = versions[i].first == lvid ||
+              get_version(versions[i].first) == versions[i].second;
+        }
+        if (!valid) {
+          __sync_fetch_and_sub(&vertex_version[lvid], 1);
+          continue;
+        }
+
+        // commit
+        if (use_cache && !have_total) {
+          store_gather_cache(lvid, epoch, gather_result);
+          if (use_total) end_gather(lvid, epoch, gather_result);
+        }
+        vertexlocks[lvid].lock();
+        vprog.apply(context, vertex, gather_result.value);
+        vertexlocks[lvid].unlock();
+        if (profiled) prof.end_phase(task_profiler::APPLY);
+        perform_scatter_local(lvid, vprog, false);
+        if (profiled) prof.end_phase(task_profiler::SCATTER);
+        __sync_fetch_and_add(&vertex_version[lvid], 1);
+        optimistic_commits.inc();
+        return true;
+      }
+      optimistic_aborts.inc();
+      return false;
+    }
+
+
+    /**
+     * \internal
+     * Called at the end of an update.
+     */
+    void finish_task(const lvid_type lvid,
+                     bool profiled,
+                     const task_profiler::task_record& prof,
+                     timer* task_time) {
+      release_exclusive_access_to_vertex(lvid);
+      // the fiber may have migrated to another worker since it began
+      if (profiled) profiler.add(fiber_control::get_worker_id(), prof);
+      if (track_task_time) {
+        total_completion_time[fiber_control::get_worker_id()] += 
+            task_time->current_time();
+        task_time->~timer();
+      }
+      programs_executed.inc(); 
+    }
+
+
     /**
      * \internal
      * Called when the scheduler returns a vertex to run.
@@ -1012,7 +1694,7 @@ namespace graphlab {
       const typename graph_type::vertex_record& rec = graph.l_get_vertex_record(lvid);
       vertex_id_type vid = rec.gvid;
       char task_time_data[sizeof(timer)];
-      timer* task_time;
+      timer* task_time = NULL;
       if (track_task_time) {
         // placement new to create the timer
         task_time = reinterpret_cast<timer*>(task_time_data);
@@ -1027,9 +1709,24 @@ namespace graphlab {
       
       if (!get_exclusive_access_to_vertex(lvid, msg)) return;
 
+      const size_t workerid = fiber_control::get_worker_id();
+      const bool profiled = profiler.sample(workerid);
+      task_profiler::task_record prof;
+      if (profiled) prof.begin(rec.num_in_edges + rec.num_out_edges);
+
+      /**************************************************************************/
+      /*                           Optimistic Update                            */
+      /**************************************************************************/
+      if (optimistic && occ_eligible.get(lvid) &&
+          optimistic_update(lvid, msg, profiled, prof)) {
+        finish_task(lvid, profiled, prof, task_time);
+        return;
+      }
+
       /**************************************************************************/
       /*                             Acquire Locks                              */
       /**************************************************************************/
+      const bool exclude_optimistic = optimistic && occ_adjacent.get(lvid);
       if (!factorized_consistency) {
         // begin lock acquisition
         cm_handles[lvid] = new vertex_fiber_cm_handle;
@@ -1043,6 +1740,8 @@ namespace graphlab {
         }
         cm_handles[lvid]->lock.unlock();
       }
+      if (exclude_optimistic) exclude_optimistic_neighbors(lvid);
+      if (profiled) prof.end_phase(task_profiler::LOCK_WAIT);
 
       /**************************************************************************/
       /*                             Begin Program                              */
@@ -1060,21 +1759,29 @@ namespace graphlab {
       /**************************************************************************/
       /*                              Gather Phase                              */
       /**************************************************************************/
+      // with the total, the mirrors are not contacted
       conditional_gather_type gather_result;
-      std::vector<request_future<conditional_gather_type> > gather_futures;
-      foreach(procid_t mirror, local_vertex.mirrors()) {
-        gather_futures.push_back(
-            object_fiber_remote_request(rmi, 
-                                        mirror, 
-                                        &async_consistent_engine::perform_gather, 
-                                        vid,
-                                        vprog));
-      }
-      gather_result += perform_gather(vid, vprog);
+      uint32_t epoch = 0;
+      if (!use_total || !begin_gather(lvid, gather_result, epoch)) {
+        std::vector<request_future<conditional_gather_type> > gather_futures;
+        foreach(procid_t mirror, local_vertex.mirrors()) {
+          gather_futures.push_back(
+              object_fiber_remote_request(rmi, 
+                                          mirror, 
+                                          &async_consistent_engine::perform_gather, 
+                                          vid,
+                                          vprog,
+                                          epoch));
+        }
+        gather_result += perform_gather(vid, vprog, epoch);
+        if (profiled) prof.end_phase(task_profiler::GATHER);
 
-      for(size_t i = 0;i < gather_futures.size(); ++i) {
-        gather_result += gather_futures[i]();
+        for(size_t i = 0;i < gather_futures.size(); ++i) {
+          gather_result += gather_futures[i]();
+        }
+        if (use_total) end_gather(lvid, epoch, gather_result);
       }
+      if (profiled) prof.end_phase(task_profiler::GATHER_WAIT);
 
      /**************************************************************************/
      /*                              apply phase                               */
@@ -1082,6 +1789,7 @@ namespace graphlab {
      vertexlocks[lvid].lock();
      vprog.apply(context, vertex, gather_result.value);      
      vertexlocks[lvid].unlock();
+     if (profiled) prof.end_phase(task_profiler::APPLY);
 
 
      /**************************************************************************/
@@ -1098,7 +1806,7 @@ namespace graphlab {
                        local_vertex.data());
      }*/
 
-     std::vector<request_future<void> > scatter_futures;
+     std::vector<request_future<total_change_list> > scatter_futures;
      foreach(procid_t mirror, local_vertex.mirrors()) {
        scatter_futures.push_back(
            object_fiber_remote_request(rmi, 
@@ -1108,26 +1816,34 @@ namespace graphlab {
                                        vprog,
                                        local_vertex.data()));
      }
-     perform_scatter_local(lvid, vprog);
-     for(size_t i = 0;i < scatter_futures.size(); ++i) 
-       scatter_futures[i]();
+     total_change_list changes;
+     if (use_total) changes = scatter_collecting(lvid, vprog);
+     else perform_scatter_local(lvid, vprog);
+     if (profiled) prof.end_phase(task_profiler::SCATTER);
+     for(size_t i = 0;i < scatter_futures.size(); ++i) {
+       const total_change_list mirror_changes = scatter_futures[i]();
+       changes.insert(changes.end(), mirror_changes.begin(),
+                      mirror_changes.end());
+     }
+     if (profiled) prof.end_phase(task_profiler::SCATTER_WAIT);
 
       /************************************************************************/
       /*                           Release Locks                              */
       /************************************************************************/
-      // the scatter is used to release the chandy misra
+      // the scatter is used to release the chandy misra, unless the
+      // changes to the totals must first reach the masters of the
+      // neighbors: a neighbor may only run once it can see them
+      if (use_total) {
+        send_total_changes(changes);
+        cmlocks->philosopher_stops_eating(lvid);
+      }
       // here I cleanup
+      if (exclude_optimistic) __sync_fetch_and_add(&vertex_version[lvid], 1);
       if (!factorized_consistency) {
         delete cm_handles[lvid];
         cm_handles[lvid] = NULL;
       }
-      release_exclusive_access_to_vertex(lvid);
-      if (track_task_time) {
-        total_completion_time[fiber_control::get_worker_id()] += 
-            task_time->current_time();
-        task_time->~timer();
-      }
-      programs_executed.inc(); 
+      finish_task(lvid, profiled, prof, task_time);
     }
 
 
@@ -1146,6 +1862,7 @@ namespace graphlab {
       while(1) {
         if (timer::approx_time_seconds() != last_aggregator_check && !endgame_mode) {
           last_aggregator_check = timer::approx_time_seconds();
+          if (threadid == 0 && residuals.enabled()) send_residual_summary();
           std::string key = aggregator.tick_asynchronous();
           if (key != "") {
             for (size_t i = 0;i < aggregation_lock.size(); ++i) {
@@ -1231,9 +1948,21 @@ namespace graphlab {
       force_stop = false;
       endgame_mode = false;
       programs_executed = 0;
+      optimistic_commits = 0;
+      optimistic_aborts = 0;
+      profiler.reset();
+      residuals.reset();
+      machine_residuals_lock.lock();
+      machine_residuals.assign(rmi.numprocs(), residual_tracker::summary());
+      residuals_converged = false;
+      machine_residuals_lock.unlock();
       launch_timer.start();
 
       termination_reason = execution_status::RUNNING;
+      const size_t lock_messages_at_start =
+          factorized_consistency ? 0 : cmlocks->num_remote_messages();
+      const size_t lock_calls_at_start =
+          factorized_consistency ? 0 : cmlocks->num_remote_calls();
       if (rmi.procid() == 0) {
         logstream(LOG_INFO) << "Total Allocated Bytes: " << allocatedmem << std::endl;
       }
@@ -1246,6 +1975,14 @@ namespace graphlab {
       }
       thrgroup.join();
       aggregator.stop();
+      const fiber_stack_pool& stack_pool =
+          fiber_control::get_instance().get_stack_pool();
+      if (stack_pool.tracking_usage()) {
+        logstream(LOG_INFO) << "Peak Fiber Stack Usage: "
+                            << stack_pool.peak_usage(stacksize) << " of "
+                            << fiber_stack_pool::round_stacksize(stacksize)
+                            << " bytes" << std::endl;
+      }
       // if termination reason was not changed, then it must be depletion
       if (termination_reason == execution_status::RUNNING) {
         termination_reason = execution_status::TASK_DEPLETION;
@@ -1266,6 +2003,31 @@ namespace graphlab {
       rmi.all_reduce(numadds);
       rmi.cout() << "Schedule Adds: " << numadds << std::endl;
 
+      if (!factorized_consistency) {
+        size_t nlockmsgs = cmlocks->num_remote_messages() - lock_messages_at_start;
+        size_t nlockcalls = cmlocks->num_remote_calls() - lock_calls_at_start;
+        rmi.all_reduce(nlockmsgs);
+        rmi.all_reduce(nlockcalls);
+        rmi.cout() << "Lock Messages: " << nlockmsgs << " in "
+                   << nlockcalls << " calls" << std::endl;
+      }
+
+      if (optimistic) {
+        size_t ncommits = optimistic_commits.value;
+        size_t naborts = optimistic_aborts.value;
+        rmi.all_reduce(ncommits);
+        rmi.all_reduce(naborts);
+        rmi.cout() << "Optimistic Commits: " << ncommits << std::endl;
+        rmi.cout() << "Optimistic Aborts: " << naborts << std::endl;
+      }
+
+      if (residuals.enabled()) {
+        residual_tracker::summary total = residuals.get_summary();
+        rmi.all_reduce(total);
+        rmi.cout() << "Residual L1: " << total.l1
+                   << " Linf: " << total.linf() << std::endl;
+      }
+
       if (track_task_time) {
         double total_task_time = 0;
         for (size_t i = 0;i < total_completion_time.size(); ++i) {
@@ -1276,6 +2038,22 @@ namespace graphlab {
                    << total_task_time / programs_executed.value << std::endl;
       }
 
+      if (profiler.enabled()) {
+        task_profiler::histogram hist = profiler.get_histogram();
+        rmi.all_reduce(hist);
+        if (rmi.procid() == 0) {
+          task_profiler::publish(hist);
+          if (!profile_file.empty()) {
+            std::ofstream fout(profile_file.c_str());
+            task_profiler::write_histogram(hist, fout);
+            if (!fout.good()) {
+              logstream(LOG_ERROR) << "Unable to write task profile to "
+                                   << profile_file << std::endl;
+            }
+          }
+        }
+      }
+
 
       ASSERT_TRUE(scheduler_ptr->empty());
       started = false;
@@ -24,10 +24,13 @@
 #ifndef GRAPHLAB_DISTRIBUTED_CHANDY_MISRA_HPP
 #define GRAPHLAB_DISTRIBUTED_CHANDY_MISRA_HPP
 #include <vector>
+#include <boost/bind.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
 #include <graphlab/rpc/distributed_event_log.hpp>
 #include <graphlab/logger/assertions.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/serialization/is_pod.hpp>
 #include <graphlab/graph/graph_basic_types.hpp>
 #include <graphlab/macros_def.hpp>
 namespace graphlab {
@@ -86,6 +89,51 @@ class distributed_chandy_misra {
   };
   std::vector<philosopher> philosopherset;
   atomic<size_t> clean_fork_count;
+
+  /*
+   * The lock protocol messages between the replicas of a vertex. With
+   * batching enabled (max_batch > 0) the messages to a machine are
+   * buffered and sent together in one rpc_lock_batch call, once max_batch
+   * of them are buffered or at the latest after batch_window microseconds.
+   * A buffer is kept per destination and per sequentialization key, so
+   * the messages of a vertex are delivered in the order they were sent.
+   * SET_EATING is never held back: the owner follows it with requests
+   * which expect the mirrors to be eating (see send_set_eating_to_mirrors).
+   */
+  enum {
+    MSG_HUNGRY = 0,
+    MSG_SIGNAL_READY = 1,
+    MSG_SET_EATING = 2,
+    MSG_STOPS_EATING = 3,
+    MSG_CANCELLATION_REQUEST = 4,
+    MSG_CANCELLATION_ACCEPT = 5
+  };
+
+  struct lock_message : public IS_POD_TYPE {
+    vertex_id_type gvid;
+    unsigned char type;
+    bool lockid;
+  };
+
+  /// The number of sequentialization keys the batches are spread over
+  enum { NUM_BATCH_KEYS = 16 };
+
+  struct message_batch {
+    simple_spinlock lock;
+    std::vector<lock_message> messages;
+  };
+  /// indexed by destination * NUM_BATCH_KEYS + key
+  std::vector<message_batch> batches;
+  size_t max_batch;
+  size_t batch_window;
+
+  thread batch_flusher;
+  mutex flusher_lock;
+  conditional flusher_cond;
+  bool stop_flusher;
+
+  atomic<size_t> remote_messages;
+  atomic<size_t> remote_calls;
     
   /*
    * Possible values for the philosopher state
@@ -158,6 +206,137 @@ class distributed_chandy_misra {
     }
   }
   
+/****************************************************************************
+ * Sends a lock message to another machine, directly or through the
+ * batch of the destination.
+ ***************************************************************************/
+  void send_lock_message(procid_t target, vertex_id_type gvid,
+                         unsigned char type, bool lockid) {
+    remote_messages.inc();
+    if (max_batch > 0) {
+      batch_lock_message(target, gvid, type, lockid);
+      return;
+    }
+    remote_calls.inc();
+    unsigned char pkey = rmi.dc().set_sequentialization_key(gvid % 254 + 1);
+    switch(type) {
+     case MSG_HUNGRY:
+      rmi.remote_call(target, &dcm_type::rpc_make_philosopher_hungry,
+                      gvid, lockid);
+      break;
+     case MSG_SIGNAL_READY:
+      rmi.remote_call(target, &dcm_type::rpc_signal_ready, gvid, lockid);
+      break;
+     case MSG_SET_EATING:
+      rmi.remote_call(target, &dcm_type::rpc_set_eating, gvid, lockid);
+      break;
+     case MSG_STOPS_EATING:
+      rmi.remote_call(target, &dcm_type::rpc_philosopher_stops_eating, gvid);
+      break;
+     case MSG_CANCELLATION_REQUEST:
+      rmi.remote_call(target, &dcm_type::rpc_cancellation_request,
+                      gvid, rmi.procid(), lockid);
+      break;
+     case MSG_CANCELLATION_ACCEPT:
+      rmi.remote_call(target, &dcm_type::rpc_cancellation_accept,
+                      gvid, lockid);
+      break;
+    }
+    rmi.dc().set_sequentialization_key(pkey);
+  }
+
+  /// Sends a lock message to all the mirrors of a vertex
+  void send_lock_message_to_mirrors(local_vertex_type& lvertex,
+                                    unsigned char type, bool lockid) {
+    foreach(procid_t mirror, lvertex.mirrors()) {
+      send_lock_message(mirror, lvertex.global_id(), type, lockid);
+    }
+  }
+
+  /**
+   * Sends SET_EATING to all the mirrors of a vertex with batching
+   * enabled. Once the owner eats, the engine sends gather and scatter
+   * requests to the mirrors, which release the mirrors through
+   * philosopher_stops_eating_per_replica, so SET_EATING must not wait in
+   * a batch. The earlier messages of the vertex are sent first, on the
+   * same sequentialization key, to keep them in order.
+   */
+  void send_set_eating_to_mirrors(local_vertex_type& lvertex, bool lockid) {
+    const vertex_id_type gvid = lvertex.global_id();
+    const size_t key = gvid % NUM_BATCH_KEYS;
+    unsigned char pkey = rmi.dc().set_sequentialization_key(key + 1);
+    foreach(procid_t mirror, lvertex.mirrors()) {
+      message_batch& batch = batches[mirror * NUM_BATCH_KEYS + key];
+      remote_messages.inc();
+      remote_calls.inc();
+      batch.lock.lock();
+      if (!batch.messages.empty()) send_batch(mirror, key, batch);
+      rmi.remote_call(mirror, &dcm_type::rpc_set_eating, gvid, lockid);
+      batch.lock.unlock();
+    }
+    rmi.dc().set_sequentialization_key(pkey);
+  }
+
+  void batch_lock_message(procid_t target, vertex_id_type gvid,
+                          unsigned char type, bool lockid) {
+    const size_t key = gvid % NUM_BATCH_KEYS;
+    message_batch& batch = batches[target * NUM_BATCH_KEYS + key];
+    lock_message msg;
+    msg.gvid = gvid;
+    msg.type = type;
+    msg.lockid = lockid;
+    batch.lock.lock();
+    batch.messages.push_back(msg);
+    if (batch.messages.size() >= max_batch) send_batch(target, key, batch);
+    batch.lock.unlock();
+  }
+
+  /// Sends the buffered messages. The batch must be locked.
+  void send_batch(procid_t target, size_t key, message_batch& batch) {
+    remote_calls.inc();
+    unsigned char pkey = rmi.dc().set_sequentialization_key(key + 1);
+    rmi.remote_call(target, &dcm_type::rpc_lock_batch,
+                    rmi.procid(), batch.messages);
+    rmi.dc().set_sequentialization_key(pkey);
+    batch.messages.clear();
+  }
+
+  void rpc_lock_batch(procid_t source, const std::vector<lock_message>& msgs) {
+    foreach(const lock_message& msg, msgs) {
+      switch(msg.type) {
+       case MSG_HUNGRY:
+        rpc_make_philosopher_hungry(msg.gvid, msg.lockid);
+        break;
+       case MSG_SIGNAL_READY:
+        rpc_signal_ready(msg.gvid, msg.lockid);
+        break;
+       case MSG_SET_EATING:
+        rpc_set_eating(msg.gvid, msg.lockid);
+        break;
+       case MSG_STOPS_EATING:
+        rpc_philosopher_stops_eating(msg.gvid);
+        break;
+       case MSG_CANCELLATION_REQUEST:
+        rpc_cancellation_request(msg.gvid, source, msg.lockid);
+        break;
+       case MSG_CANCELLATION_ACCEPT:
+        rpc_cancellation_accept(msg.gvid, msg.lockid);
+        break;
+      }
+    }
+  }
+
+  void batch_flush_loop() {
+    flusher_lock.lock();
+    while (!stop_flusher) {
+      flusher_cond.timedwait_ns(flusher_lock, batch_window * 1000);
+      flusher_lock.unlock();
+      flush();
+      flusher_lock.lock();
+    }
+    flusher_lock.unlock();
+  }
+
 /****************************************************************************
  * Tries to move a requested fork
  *
@@ -270,12 +449,7 @@ class distributed_chandy_misra {
         philosopherset[lvid].lock.unlock();
         
         if (requestor != rmi.procid()) {
-          unsigned char pkey = rmi.dc().set_sequentialization_key(gvid % 254 + 1);
-          rmi.remote_call(requestor,
-                          &dcm_type::rpc_cancellation_accept,
-                          gvid,
-                          lockid);
-          rmi.dc().set_sequentialization_key(pkey);
+          send_lock_message(requestor, gvid, MSG_CANCELLATION_ACCEPT, lockid);
         }
         else {
           cancellation_accept_unlocked(lvid, lockid);
@@ -312,14 +486,8 @@ class distributed_chandy_misra {
       cancellation_request_unlocked(lvid, rmi.procid(), lockid);
     }
     else {
-      unsigned char pkey = rmi.dc().set_sequentialization_key(lvertex.global_id() % 254 + 1);
-      rmi.remote_call(lvertex.owner(),
-                    &dcm_type::rpc_cancellation_request,
-                    lvertex.global_id(),
-                    rmi.procid(), 
-                    lockid);
-      rmi.dc().set_sequentialization_key(pkey);
-
+      send_lock_message(lvertex.owner(), lvertex.global_id(),
+                        MSG_CANCELLATION_REQUEST, lockid);
     }
   }
 
@@ -523,12 +691,9 @@ class distributed_chandy_misra {
       signal_ready_unlocked(p_id, philosopherset[p_id].lockid);
     }
     else {
-      unsigned char pkey = rmi.dc().set_sequentialization_key(lvertex.global_id() % 254 + 1);
       if (hors_doeuvre_callback != NULL) hors_doeuvre_callback(p_id);
-      rmi.remote_call(lvertex.owner(),
-                      &dcm_type::rpc_signal_ready,
-                      lvertex.global_id(), philosopherset[p_id].lockid);
-      rmi.dc().set_sequentialization_key(pkey);
+      send_lock_message(lvertex.owner(), lvertex.global_id(),
+                        MSG_SIGNAL_READY, philosopherset[p_id].lockid);
     }
   }
 
@@ -571,11 +736,18 @@ class distributed_chandy_misra {
       philosopherset[lvid].lock.unlock();
       // broadcast EATING
       local_vertex_type lvertex(graph.l_vertex(lvid));
-      unsigned char pkey = rmi.dc().set_sequentialization_key(lvertex.global_id() % 254 + 1);
-      rmi.remote_call(lvertex.mirrors().begin(), lvertex.mirrors().end(),
-                      &dcm_type::rpc_set_eating, lvertex.global_id(), lockid);
-      set_eating(lvid, lockid);
-      rmi.dc().set_sequentialization_key(pkey);
+      if (max_batch > 0) {
+        send_set_eating_to_mirrors(lvertex, lockid);
+        set_eating(lvid, lockid);
+      } else {
+        remote_messages.inc(lvertex.num_mirrors());
+        remote_calls.inc(lvertex.num_mirrors());
+        unsigned char pkey = rmi.dc().set_sequentialization_key(lvertex.global_id() % 254 + 1);
+        rmi.remote_call(lvertex.mirrors().begin(), lvertex.mirrors().end(),
+                        &dcm_type::rpc_set_eating, lvertex.global_id(), lockid);
+        set_eating(lvid, lockid);
+        rmi.dc().set_sequentialization_key(pkey);
+      }
     }
     else {
       philosopherset[lvid].lock.unlock();
@@ -751,7 +923,9 @@ class distributed_chandy_misra {
                           rmi(dc, this),
                           graph(graph),
                           callback(callback),
-                          hors_doeuvre_callback(hors_doeuvre_callback){
+                          hors_doeuvre_callback(hors_doeuvre_callback),
+                          max_batch(0), batch_window(0),
+                          stop_flusher(false) {
     forkset.resize(graph.num_local_edges(), 0);
     philosopherset.resize(graph.num_local_vertices());
     compute_initial_fork_arrangement();
@@ -759,6 +933,55 @@ class distributed_chandy_misra {
     rmi.barrier();
   }
 
+  ~distributed_chandy_misra() {
+    if (max_batch > 0) {
+      flusher_lock.lock();
+      stop_flusher = true;
+      flusher_cond.signal();
+      flusher_lock.unlock();
+      batch_flusher.join();
+      flush();
+    }
+  }
+
+  /**
+   * Enables batching of the lock messages to each machine. A batch is
+   * sent when it holds max_batch messages, or by a background thread
+   * every window microseconds. max_batch = 0 sends each message on its
+   * own. Must be called at most once, while no locks are requested.
+   */
+  void set_batching(size_t max_batch, size_t window) {
+    ASSERT_EQ(this->max_batch, 0);
+    if (max_batch == 0) return;
+    ASSERT_GT(window, 0);
+    batches.resize(rmi.numprocs() * NUM_BATCH_KEYS);
+    batch_window = window;
+    this->max_batch = max_batch;
+    batch_flusher.launch(boost::bind(&dcm_type::batch_flush_loop, this));
+  }
+
+  /// Sends all the buffered lock messages
+  void flush() {
+    for (size_t i = 0; i < batches.size(); ++i) {
+      if (batches[i].messages.empty()) continue;
+      batches[i].lock.lock();
+      if (!batches[i].messages.empty()) {
+        send_batch(i / NUM_BATCH_KEYS, i % NUM_BATCH_KEYS, batches[i]);
+      }
+      batches[i].lock.unlock();
+    }
+  }
+
+  /// The number of lock messages sent to other machines
+  size_t num_remote_messages() const {
+    return remote_messages.value;
+  }
+
+  /// The number of remote calls carrying the lock messages
+  size_t num_remote_calls() const {
+    return remote_calls.value;
+  }
+
   size_t num_clean_forks() const {
     return clean_fork_count.value;
   }
@@ -784,10 +1007,16 @@ class distributed_chandy_misra {
   
     philosopherset[p_id].lock.unlock();
     
-    unsigned char pkey = rmi.dc().set_sequentialization_key(lvertex.global_id() % 254 + 1);
-    rmi.remote_call(lvertex.mirrors().begin(), lvertex.mirrors().end(),
-                    &dcm_type::rpc_make_philosopher_hungry, lvertex.global_id(), newlockid);
-    rmi.dc().set_sequentialization_key(pkey);
+    if (max_batch > 0) {
+      send_lock_message_to_mirrors(lvertex, MSG_HUNGRY, newlockid);
+    } else {
+      remote_messages.inc(lvertex.num_mirrors());
+      remote_calls.inc(lvertex.num_mirrors());
+      unsigned char pkey = rmi.dc().set_sequentialization_key(lvertex.global_id() % 254 + 1);
+      rmi.remote_call(lvertex.mirrors().begin(), lvertex.mirrors().end(),
+                      &dcm_type::rpc_make_philosopher_hungry, lvertex.global_id(), newlockid);
+      rmi.dc().set_sequentialization_key(pkey);
+    }
     local_philosopher_grabs_forks(p_id);
   }
   
@@ -826,10 +1055,16 @@ class distributed_chandy_misra {
 //    ASSERT_EQ(philosopherset[p_id].state, (int)EATING);
     philosopherset[p_id].counter = 0;
     philosopherset[p_id].lock.unlock();
-    unsigned char pkey = rmi.dc().set_sequentialization_key(lvertex.global_id() % 254 + 1);
-    rmi.remote_call(lvertex.mirrors().begin(), lvertex.mirrors().end(),
-                    &dcm_type::rpc_philosopher_stops_eating, lvertex.global_id());
-    rmi.dc().set_sequentialization_key(pkey);
+    if (max_batch > 0) {
+      send_lock_message_to_mirrors(lvertex, MSG_STOPS_EATING, false);
+    } else {
+      remote_messages.inc(lvertex.num_mirrors());
+      remote_calls.inc(lvertex.num_mirrors());
+      unsigned char pkey = rmi.dc().set_sequentialization_key(lvertex.global_id() % 254 + 1);
+      rmi.remote_call(lvertex.mirrors().begin(), lvertex.mirrors().end(),
+                      &dcm_type::rpc_philosopher_stops_eating, lvertex.global_id());
+      rmi.dc().set_sequentialization_key(pkey);
+    }
     local_philosopher_stops_eating(p_id);
   }
 
@@ -46,7 +46,10 @@ namespace graphlab {
       FORCED_ABORT,     /**< the engine was stopped by calling force
                                 abort */
       
-      EXCEPTION        /**< the engine was stopped by an exception */
+      EXCEPTION,       /**< the engine was stopped by an exception */
+
+      CONVERGED        /**< the residuals reported by the vertex
+                              programs met the engine tolerances */
     }; // end of enum
     
     // Convenience function.
@@ -58,6 +61,7 @@ namespace graphlab {
         case TIMEOUT: return "timeout";
         case FORCED_ABORT: return "forced abort";
         case EXCEPTION: return "exception";
+        case CONVERGED: return "converged";
         default: return "unknown";
       };
     } // end of to_string
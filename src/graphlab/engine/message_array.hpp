@@ -28,6 +28,7 @@
 #include <vector>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/atomic.hpp>
+#include <graphlab/util/memory_info.hpp>
 #include <graphlab/scheduler/get_message_priority.hpp>
 namespace graphlab {
 
@@ -72,6 +73,8 @@ namespace graphlab {
     simple_spinlock lock_array[65536];
     size_t joincounter[65536];
     size_t addcounter[65536];
+    /// accounted to memory_info::MESSAGE_ARRAYS
+    memory_info::tracked_size tracked;
 
     /** Not assignable */
     void operator=(const message_array& other) { }
@@ -79,14 +82,21 @@ namespace graphlab {
     static size_t get_lock_idx(size_t i) {
       return i % 65536;
     }
+
+    void update_tracked_size() {
+      tracked.set(sizeof(message_array) +
+                  message_vector.capacity() * sizeof(message_box));
+    }
   public:
     /** Initialize the per vertex task set */
     message_array(size_t num_vertices = 0) :
-              message_vector(num_vertices) { 
+              message_vector(num_vertices),
+              tracked(memory_info::MESSAGE_ARRAYS) { 
       for (size_t i = 0; i < 65536; ++i) {
         joincounter[i] = 0; 
         addcounter[i] = 0;
       }
+      update_tracked_size();
     }
 
     /**
@@ -94,6 +104,7 @@ namespace graphlab {
      */
     void resize(size_t num_vertices) {
       message_vector.resize(num_vertices);
+      update_tracked_size();
     }
 
     /** Add a message to the set returning false if a message is already
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <algorithm>
+#include <graphlab/engine/residual_tracker.hpp>
+#include <graphlab/logger/assertions.hpp>
+
+namespace graphlab {
+
+  void residual_tracker::init(size_t nworkers, size_t nvertices,
+                              double l1_tolerance, double linf_tolerance) {
+    ASSERT_GE(l1_tolerance, 0);
+    ASSERT_GE(linf_tolerance, 0);
+    this->l1_tolerance = l1_tolerance;
+    this->linf_tolerance = linf_tolerance;
+    workers.clear();
+    std::vector<float>().swap(residuals);
+    if (enabled()) {
+      workers.resize(nworkers);
+      residuals.resize(nvertices, -1);
+    }
+    shared = summary();
+  }
+
+  void residual_tracker::reset() {
+    std::fill(residuals.begin(), residuals.end(), -1);
+    for (size_t i = 0; i < workers.size(); ++i) {
+      workers[i].totals = summary();
+    }
+    shared = summary();
+  }
+
+  residual_tracker::summary residual_tracker::get_summary() const {
+    summary ret;
+    std::vector<size_t> seqs(workers.size());
+    bool consistent = false;
+    // no reports are made to the shared slot during the reads
+    shared_lock.lock();
+    for (size_t attempt = 0; attempt < MAX_SUMMARY_ATTEMPTS; ++attempt) {
+      bool idle = true;
+      for (size_t i = 0; i < workers.size(); ++i) {
+        seqs[i] = workers[i].seq;
+        idle = idle && (seqs[i] & 1) == 0;
+      }
+      if (!idle) continue;
+      __sync_synchronize();
+      ret = shared;
+      for (size_t i = 0; i < workers.size(); ++i) ret += workers[i].totals;
+      __sync_synchronize();
+      for (size_t i = 0; i < workers.size() && idle; ++i) {
+        idle = workers[i].seq == seqs[i];
+      }
+      if (idle) {
+        consistent = true;
+        break;
+      }
+    }
+    shared_lock.unlock();
+    ret.consistent = consistent;
+    return ret;
+  }
+
+  void residual_tracker::write_histogram(const summary& s,
+                                         std::ostream& out) {
+    out << "max_residual\tvertices\n";
+    for (size_t b = 0; b < s.buckets.size(); ++b) {
+      if (s.buckets[b] == 0) continue;
+      out << bucket_limit(b) << "\t" << s.buckets[b] << "\n";
+    }
+  }
+
+} // namespace graphlab
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_RESIDUAL_TRACKER_HPP
+#define GRAPHLAB_RESIDUAL_TRACKER_HPP
+
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <boost/cstdint.hpp>
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/fiber_control.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+
+namespace graphlab {
+
+  /**
+   * \internal
+   * Tracks the residuals reported by vertex programs through
+   * icontext::report_residual, so that the engines can stop once the
+   * computation has converged without a separate pass over the
+   * vertices.
+   *
+   * The tracker keeps the last residual reported by each local vertex,
+   * and a running total of their sum (the L1 norm) and a histogram of
+   * them over the log2 of the residual. A report replaces the previous
+   * residual of the vertex in the totals, so the totals always describe
+   * the latest residual of every vertex which has reported one. The
+   * largest residual (the L-infinity norm) is bounded from above by
+   * the histogram to within a factor of 2.
+   *
+   * Each worker accumulates the changes to the totals it makes without
+   * locking, under a sequence number which get_summary uses to detect
+   * reports made while it reads the totals. The residual of a vertex must
+   * only be reported by the fiber updating it, as the engines do when it
+   * is reported from apply. Reports from outside the fibers go to a
+   * shared, locked slot.
+   */
+  class residual_tracker {
+  public:
+    /**
+     * The number of residual buckets. Bucket 0 holds residuals below
+     * 2^MIN_EXPONENT, including 0, and bucket b > 0 holds residuals in
+     * [2^(b-1+MIN_EXPONENT), 2^(b+MIN_EXPONENT)). The last bucket is
+     * unbounded.
+     */
+    static const size_t NUM_BUCKETS = 128;
+    static const int MIN_EXPONENT = -80;
+
+    /// The number of times get_summary reads the totals of the workers
+    static const size_t MAX_SUMMARY_ATTEMPTS = 100;
+
+    /// Returns the residual bucket of a residual
+    static size_t residual_bucket(double residual) {
+      if (!(residual >= std::ldexp(1.0, MIN_EXPONENT))) return 0;
+      int e;
+      std::frexp(residual, &e);
+      // residual is in [2^(e-1), 2^e)
+      return std::min<size_t>(e - MIN_EXPONENT, NUM_BUCKETS - 1);
+    }
+
+    /// Returns the least upper bound of the residuals in a bucket
+    static double bucket_limit(size_t b) {
+      return b + 1 < NUM_BUCKETS ? std::ldexp(1.0, int(b) + MIN_EXPONENT)
+                                 : HUGE_VAL;
+    }
+
+    /**
+     * The residuals of a set of vertices. Summaries of disjoint sets of
+     * vertices are combined with operator+=, so a summary of the whole
+     * graph is obtained with an all_reduce of the summaries of the
+     * machines.
+     */
+    struct summary {
+      /// The sum of the residuals
+      double l1;
+      /// The number of vertices with a residual
+      boost::int64_t count;
+      /// The number of residuals in each residual bucket
+      std::vector<boost::int64_t> buckets;
+      /**
+       * False if residuals were reported while the summary was taken,
+       * which may then misstate them
+       */
+      bool consistent;
+
+      summary(): l1(0), count(0), buckets(NUM_BUCKETS, 0),
+                 consistent(true) { }
+
+      summary& operator+=(const summary& other) {
+        l1 += other.l1;
+        count += other.count;
+        consistent = consistent && other.consistent;
+        for (size_t i = 0; i < buckets.size(); ++i) {
+          buckets[i] += other.buckets[i];
+        }
+        return *this;
+      }
+
+      /**
+       * An upper bound on the largest residual, at most twice the
+       * largest residual if it is at least 2^MIN_EXPONENT.
+       */
+      double linf() const {
+        for (size_t b = buckets.size(); b > 0; --b) {
+          if (buckets[b - 1] > 0) return bucket_limit(b - 1);
+        }
+        return 0;
+      }
+
+      void save(oarchive& oarc) const {
+        oarc << l1 << count << buckets << consistent;
+      }
+      void load(iarchive& iarc) {
+        iarc >> l1 >> count >> buckets >> consistent;
+      }
+    };
+
+    residual_tracker(): l1_tolerance(0), linf_tolerance(0) { }
+
+    /**
+     * Enables the tracker for nworkers workers and nvertices local
+     * vertices. The computation has converged when the sum of the
+     * residuals is at most l1_tolerance, or the largest residual is
+     * below linf_tolerance. A tolerance of 0 disables the test, and the
+     * tracker is disabled if both are 0.
+     */
+    void init(size_t nworkers, size_t nvertices,
+              double l1_tolerance, double linf_tolerance);
+
+    /// True if residuals are tracked
+    bool enabled() const {
+      return l1_tolerance > 0 || linf_tolerance > 0;
+    }
+
+    /// Sets the residual of a local vertex
+    void report(lvid_type lvid, double residual) {
+      if (!enabled()) return;
+      // NaN is treated as the largest residual, which never converges
+      const float r = residual == residual ?
+          std::min<double>(std::fabs(residual), FLT_MAX) : FLT_MAX;
+      const float old = residuals[lvid];
+      residuals[lvid] = r;
+      const size_t workerid = fiber_control::get_worker_id();
+      if (workerid < workers.size()) {
+        worker_totals& w = workers[workerid];
+        // odd while the totals are being changed
+        ++w.seq;
+        __sync_synchronize();
+        update(w.totals, old, r);
+        __sync_synchronize();
+        ++w.seq;
+      } else {
+        shared_lock.lock();
+        update(shared, old, r);
+        shared_lock.unlock();
+      }
+    }
+
+    /// Forgets the residuals of all vertices
+    void reset();
+
+    /**
+     * Returns the summary of the residuals of the local vertices. The
+     * reports of a vertex may be made on different workers, which are
+     * read one after the other, so a report made during the reads could
+     * be seen without the earlier report it replaces. The reads are
+     * repeated until no report is made during them, at most
+     * MAX_SUMMARY_ATTEMPTS times. If none succeeds, the summary is marked
+     * as not consistent.
+     */
+    summary get_summary() const;
+
+    /**
+     * Returns true if a summary of the residuals of a graph of
+     * nvertices vertices meets one of the tolerances. Every vertex must
+     * have reported a residual, and the summary must be consistent.
+     */
+    bool converged(const summary& s, size_t nvertices) const {
+      if (!enabled() || !s.consistent ||
+          s.count < boost::int64_t(nvertices)) return false;
+      return (l1_tolerance > 0 && s.l1 <= l1_tolerance) ||
+          (linf_tolerance > 0 && s.linf() <= linf_tolerance);
+    }
+
+    /**
+     * Writes a summary as a tab separated table with one line per
+     * non-empty residual bucket, giving the upper bound of the bucket
+     * and the number of residuals in it.
+     */
+    static void write_histogram(const summary& s, std::ostream& out);
+
+  private:
+    // replaces the residual old of a vertex with r in s. The new
+    // residual is added first, so the totals only overestimate the
+    // residuals while they are being changed
+    static void update(summary& s, float old, float r) {
+      s.l1 += r;
+      ++s.buckets[residual_bucket(r)];
+      if (old < 0) {
+        ++s.count;
+      } else {
+        s.l1 -= old;
+        --s.buckets[residual_bucket(old)];
+      }
+    }
+
+    // the changes made to the summary by a worker
+    struct worker_totals {
+      // incremented before and after each change to the totals
+      volatile size_t seq;
+      summary totals;
+      worker_totals(): seq(0) { }
+      // keep the totals of different workers on different lines
+      char padding[64];
+    };
+
+    double l1_tolerance;
+    double linf_tolerance;
+    // the last residual of each local vertex, -1 if none was reported
+    std::vector<float> residuals;
+    std::vector<worker_totals> workers;
+    mutable mutex shared_lock;
+    summary shared;
+  };
+
+} // namespace graphlab
+
+#endif
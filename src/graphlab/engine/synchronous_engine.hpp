@@ -35,6 +35,7 @@
 #include <graphlab/vertex_program/context.hpp>
 
 #include <graphlab/engine/execution_status.hpp>
+#include <graphlab/engine/residual_tracker.hpp>
 #include <graphlab/options/graphlab_options.hpp>
 
 
@@ -199,6 +200,17 @@ namespace graphlab {
    * for the snapshot. The path including folder and file prefix in
    * which the snapshots should be saved.
    *
+   * \li <b>residual_l1</b>: (default: 0) If positive, the engine
+   * terminates after the iteration in which the sum of the residuals
+   * reported through \ref icontext::report_residual falls to this
+   * value, once every vertex has reported a residual.
+   *
+   * \li <b>residual_linf</b>: (default: 0) If positive, the engine
+   * terminates after the iteration in which the largest reported
+   * residual falls to this value, once every vertex has reported a
+   * residual. The largest residual is bounded from a histogram of the
+   * residuals and may be overestimated by up to a factor of 2.
+   *
    * \see graphlab::omni_engine
    * \see graphlab::async_consistent_engine
    * \see graphlab::semi_synchronous_engine
@@ -409,6 +421,17 @@ namespace graphlab {
      */
     bool force_abort;
 
+    /**
+     * \brief The tolerances on the sum and on the largest of the
+     * residuals reported by the vertex programs. 0 disables the test.
+     */
+    double residual_l1, residual_linf;
+
+    /**
+     * \brief The last residual reported by each vertex program.
+     */
+    residual_tracker residuals;
+
     /**
      * \brief The vertex locks protect access to vertex specific
      * data-structures including
@@ -485,11 +508,106 @@ namespace graphlab {
      */
     dense_bitset has_cache;
 
+    /**
+     * \brief The memory accounted to memory_info::MESSAGE_ARRAYS and
+     * memory_info::GATHER_CACHE (the gather accumulators and caches).
+     */
+    memory_info::tracked_size messages_size, gather_size;
+
+    /**
+     * \brief A set of local vertices that threads add to concurrently and
+     * then scan in blocks.
+     *
+     * Besides the bitset, the set keeps the list of the vertices added
+     * since it was last cleared as long as they are at most 1/64 of the
+     * local vertices. Scanning and clearing a set that small take time
+     * proportional to its size instead of to the number of local
+     * vertices. A sparse set is scanned in the order the vertices were
+     * added.
+     */
+    class active_set {
+    public:
+      /// The number of scan positions handed out at a time
+      static const size_t BLOCK_SIZE = 8 * sizeof(size_t);
+
+      void resize(size_t nverts) {
+        bits.resize(nverts);
+        bits.clear();
+        added.resize(nverts / BLOCK_SIZE + 1);
+        nadded = 0;
+      }
+
+      /// Atomically adds lvid returning true if it was already in the set
+      bool set_bit(lvid_type lvid) {
+        if (bits.set_bit(lvid)) return true;
+        const size_t i = nadded.inc_ret_last();
+        if (i < added.size()) added[i] = lvid;
+        return false;
+      }
+
+      bool get(lvid_type lvid) const { return bits.get(lvid); }
+
+      /// True if the set is small enough to be scanned through its list
+      bool sparse() const { return nadded.value <= added.size(); }
+
+      void clear() {
+        if (sparse()) {
+          for (size_t i = 0; i < nadded.value; ++i) bits.clear_bit(added[i]);
+        } else {
+          bits.clear();
+        }
+        nadded = 0;
+      }
+
+      void fill() {
+        bits.fill();
+        nadded = added.size() + 1;
+      }
+
+      /**
+       * The number of positions to scan: the size of a sparse set and
+       * nverts (the number of local vertices) otherwise. No vertex may
+       * be added while the set is scanned.
+       */
+      size_t scan_size(size_t nverts) const {
+        return sparse() ? nadded.value : nverts;
+      }
+
+      /**
+       * Stores in block the vertices at the scan positions
+       * [start, start + BLOCK_SIZE) and returns their number. start must
+       * be a multiple of BLOCK_SIZE.
+       */
+      size_t scan_block(size_t start, size_t nverts, lvid_type* block) const {
+        size_t n = 0;
+        if (sparse()) {
+          const size_t end = std::min<size_t>(start + BLOCK_SIZE, size_t(nadded.value));
+          for (size_t i = start; i < end; ++i) block[n++] = added[i];
+          return n;
+        }
+        size_t word = bits.containing_word(start);
+        if (word == 0) return 0;
+        fixed_dense_bitset<BLOCK_SIZE> local_bitset;
+        local_bitset.initialize_from_mem(&word, sizeof(size_t));
+        foreach(size_t offset, local_bitset) {
+          const size_t lvid = start + offset;
+          if (lvid >= nverts) break;
+          block[n++] = lvid;
+        }
+        return n;
+      }
+
+    private:
+      mutable dense_bitset bits;
+      std::vector<lvid_type> added;
+      atomic<size_t> nadded;
+    };
+
     /**
      * \brief A bit (for master vertices) indicating if that vertex is active
      * (received a message on this iteration).
      */
-    dense_bitset active_superstep;
+    active_set active_superstep;
 
     /**
      * \brief  The number of local vertices (masters) that are active on this
@@ -501,7 +619,7 @@ namespace graphlab {
      * \brief A bit indicating (for all vertices) whether to
      * participate in the current minor-step (gather or scatter).
      */
-    dense_bitset active_minorstep;
+    active_set active_minorstep;
 
     /**
      * \brief A counter measuring the number of applys that have been completed
@@ -764,6 +882,17 @@ namespace graphlab {
      */
     void internal_clear_gather_cache(const vertex_type& vertex);
 
+    /**
+     * \brief Sets the residual of a vertex.
+     *
+     * This function is called by the \ref graphlab::context.
+     *
+     * @param [in] vertex the vertex being updated
+     * @param [in] residual the residual of the vertex
+     */
+    void internal_report_residual(const vertex_type& vertex,
+                                  double residual);
+
 
     // Program Steps ==========================================================
 
@@ -1007,11 +1136,15 @@ namespace graphlab {
     threads(2*1024*1024 /* 2MB stack per fiber*/),
     thread_barrier(opts.get_ncpus()),
     max_iterations(-1), snapshot_interval(-1), iteration_counter(0),
-    timeout(0), sched_allv(false),
-    vprog_exchange(dc),
-    vdata_exchange(dc),
-    gather_exchange(dc),
-    message_exchange(dc),
+    timeout(0), sched_allv(false), residual_l1(0), residual_linf(0),
+    messages_size(memory_info::MESSAGE_ARRAYS),
+    gather_size(memory_info::GATHER_CACHE),
+    // the exchanged values are keyed by vertex id: send them compactly,
+    // and keep them serialized to read them straight into their storage
+    vprog_exchange(dc, DEFAULT_BUFFERED_EXCHANGE_SIZE, true, true),
+    vdata_exchange(dc, DEFAULT_BUFFERED_EXCHANGE_SIZE, true, true),
+    gather_exchange(dc, DEFAULT_BUFFERED_EXCHANGE_SIZE, true, true),
+    message_exchange(dc, DEFAULT_BUFFERED_EXCHANGE_SIZE, true, true),
     aggregator(dc, graph, new context_type(*this, graph)) {
     // Process any additional options
     std::vector<std::string> keys = opts.get_engine_args().get_option_keys();
@@ -1048,6 +1181,16 @@ namespace graphlab {
         if (rmi.procid() == 0)
           logstream(LOG_EMPH) << "Engine Option: sched_allv = "
             << sched_allv << std::endl;
+      } else if (opt == "residual_l1") {
+        opts.get_engine_args().get_option("residual_l1", residual_l1);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: residual_l1 = "
+            << residual_l1 << std::endl;
+      } else if (opt == "residual_linf") {
+        opts.get_engine_args().get_option("residual_linf", residual_linf);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: residual_linf = "
+            << residual_linf << std::endl;
       } else {
         logstream(LOG_FATAL) << "Unexpected Engine Option: " << opt << std::endl;
       }
@@ -1105,6 +1248,14 @@ namespace graphlab {
     // Allocate bitset to track active vertices on each bitset.
     active_superstep.resize(graph.num_local_vertices());
     active_minorstep.resize(graph.num_local_vertices());
+    residuals.init(fiber_control::get_instance().num_workers(),
+                   graph.num_local_vertices(), residual_l1, residual_linf);
+
+    messages_size.set(messages.capacity() * sizeof(message_type) +
+                      has_message.size() / 8);
+    gather_size.set((gather_accum.capacity() + gather_cache.capacity()) *
+                    sizeof(gather_type) +
+                    (has_gather_accum.size() + has_cache.size()) / 8);
 
     // Print memory usage after initialization
     memory_info::log_usage("After Engine Initialization");
@@ -1162,8 +1313,10 @@ namespace graphlab {
              const message_type& message, const std::string& order) {
     if (vlocks.size() != graph.num_local_vertices())
       resize();
-    for(lvid_type lvid = 0; lvid < graph.num_local_vertices(); ++lvid) {
-      if(graph.l_is_master(lvid) && vset.l_contains(lvid)) {
+    const size_t nscan = vset.scan_size(graph.num_local_vertices());
+    for(size_t i = 0; i < nscan; ++i) {
+      const lvid_type lvid = vset.scan_lvid(i);
+      if(lvid != lvid_type(-1) && graph.l_is_master(lvid)) {
         internal_signal(vertex_type(graph.l_vertex(lvid)), message);
       }
     }
@@ -1243,6 +1396,13 @@ namespace graphlab {
   } // end of clear_gather_cache
 
 
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  internal_report_residual(const vertex_type& vertex, double residual) {
+    residuals.report(vertex.local_id(), residual);
+  } // end of internal_report_residual
+
+
 
 
   template<typename VertexProgram>
@@ -1272,6 +1432,7 @@ namespace graphlab {
     if (vlocks.size() != graph.num_local_vertices())
       resize();
     completed_applys = 0;
+    residuals.reset();
     rmi.barrier();
 
     // Initialization code ==================================================
@@ -1418,6 +1579,24 @@ namespace graphlab {
       if (snapshot_interval > 0 && iteration_counter % snapshot_interval == 0) {
         graph.save_binary(snapshot_path);
       }
+
+      // Check the residuals reported by the applys -------------------------
+      if (residuals.enabled()) {
+        residual_tracker::summary total = residuals.get_summary();
+        rmi.all_reduce(total);
+        if (rmi.procid() == 0 && print_this_round)
+          logstream(LOG_EMPH)
+            << "\tResidual L1: " << total.l1
+            << " Linf: " << total.linf() << std::endl;
+        if (residuals.converged(total, graph.num_vertices())) {
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH)
+              << "Converged with residual L1: " << total.l1
+              << " Linf: " << total.linf() << std::endl;
+          termination_reason = execution_status::CONVERGED;
+          break;
+        }
+      }
     }
 
     if (rmi.procid() == 0) {
@@ -1568,23 +1747,19 @@ namespace graphlab {
     const bool caching_enabled = !gather_cache.empty();
     timer ti;
 
-    fixed_dense_bitset<8 * sizeof(size_t)> local_bitset; // a word-size = 64 bit
+    lvid_type lvid_block[active_set::BLOCK_SIZE];
 
+    const size_t scan_size = active_minorstep.scan_size(graph.num_local_vertices());
     while (1) {
-      // increment by a word at a time
-      lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = active_minorstep.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
+      // increment by a block at a time
+      const size_t block_start =
+                  shared_lvid_counter.inc_ret_last(active_set::BLOCK_SIZE);
+      if (block_start >= scan_size) break;
+      const size_t block_size = active_minorstep.scan_block(
+          block_start, graph.num_local_vertices(), lvid_block);
 
-      foreach(size_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset;
-        if (lvid >= graph.num_local_vertices()) break;
+      for (size_t i = 0; i < block_size; ++i) {
+        const lvid_type lvid = lvid_block[i];
 
         bool accum_is_set = false;
         gather_type accum = gather_type();
@@ -1671,21 +1846,17 @@ namespace graphlab {
     size_t vcount = 0;
     timer ti;
 
-    fixed_dense_bitset<8 * sizeof(size_t)> local_bitset;  // allocate a word size = 64bits
+    lvid_type lvid_block[active_set::BLOCK_SIZE];
+    const size_t scan_size = active_superstep.scan_size(graph.num_local_vertices());
     while (1) {
-      // increment by a word at a time
-      lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = active_superstep.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-      foreach(size_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset;
-        if (lvid >= graph.num_local_vertices()) break;
+      // increment by a block at a time
+      const size_t block_start =
+                  shared_lvid_counter.inc_ret_last(active_set::BLOCK_SIZE);
+      if (block_start >= scan_size) break;
+      const size_t block_size = active_superstep.scan_block(
+          block_start, graph.num_local_vertices(), lvid_block);
+      for (size_t i = 0; i < block_size; ++i) {
+        const lvid_type lvid = lvid_block[i];
 
         // Only master vertices can be active in a super-step
         ASSERT_TRUE(graph.l_is_master(lvid));
@@ -1740,21 +1911,17 @@ namespace graphlab {
   execute_scatters(const size_t thread_id) {
     context_type context(*this, graph);
     timer ti;
-    fixed_dense_bitset<8 * sizeof(size_t)> local_bitset; // allocate a word size = 64 bits
+    lvid_type lvid_block[active_set::BLOCK_SIZE];
+    const size_t scan_size = active_minorstep.scan_size(graph.num_local_vertices());
     while (1) {
-      // increment by a word at a time
-      lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = active_minorstep.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-      foreach(size_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset;
-        if (lvid >= graph.num_local_vertices()) break;
+      // increment by a block at a time
+      const size_t block_start =
+                  shared_lvid_counter.inc_ret_last(active_set::BLOCK_SIZE);
+      if (block_start >= scan_size) break;
+      const size_t block_size = active_minorstep.scan_block(
+          block_start, graph.num_local_vertices(), lvid_block);
+      for (size_t i = 0; i < block_size; ++i) {
+        const lvid_type lvid = lvid_block[i];
 
         const vertex_program_type& vprog = vertex_programs[lvid];
         local_vertex_type local_vertex = graph.l_vertex(lvid);
@@ -1813,11 +1980,13 @@ namespace graphlab {
     typename vprog_exchange_type::recv_buffer_type recv_buffer;
     while(vprog_exchange.recv(recv_buffer)) {
       for (size_t i = 0;i < recv_buffer.size(); ++i) {
-        typename vprog_exchange_type::buffer_type& buffer = recv_buffer[i].buffer;
-        foreach(const vid_prog_pair_type& pair, buffer) {
-          const lvid_type lvid = graph.local_vid(pair.first);
+        typename vprog_exchange_type::value_reader reader(recv_buffer[i]);
+        while(!reader.done()) {
+          vertex_id_type vid; reader.archive() >> vid;
+          const lvid_type lvid = graph.local_vid(vid);
           //      ASSERT_FALSE(graph.l_is_master(lvid));
-          vertex_programs[lvid] = pair.second;
+          reader.archive() >> vertex_programs[lvid];
+          reader.next();
           active_minorstep.set_bit(lvid);
         }
       }
@@ -1846,11 +2015,13 @@ namespace graphlab {
     typename vdata_exchange_type::recv_buffer_type recv_buffer;
     while(vdata_exchange.recv(recv_buffer)) {
       for (size_t i = 0;i < recv_buffer.size(); ++i) {
-        typename vdata_exchange_type::buffer_type& buffer = recv_buffer[i].buffer;
-        foreach(const vid_vdata_pair_type& pair, buffer) {
-          const lvid_type lvid = graph.local_vid(pair.first);
+        typename vdata_exchange_type::value_reader reader(recv_buffer[i]);
+        while(!reader.done()) {
+          vertex_id_type vid; reader.archive() >> vid;
+          const lvid_type lvid = graph.local_vid(vid);
           ASSERT_FALSE(graph.l_is_master(lvid));
-          graph.l_vertex(lvid).data() = pair.second;
+          reader.archive() >> graph.l_vertex(lvid).data();
+          reader.next();
         }
       }
     }
@@ -1881,20 +2052,24 @@ namespace graphlab {
   recv_gathers() {
     typename gather_exchange_type::recv_buffer_type recv_buffer;
     while(gather_exchange.recv(recv_buffer)) {
+      gather_type accum;
       for (size_t i = 0;i < recv_buffer.size(); ++i) {
-        typename gather_exchange_type::buffer_type& buffer = recv_buffer[i].buffer;
-        foreach(const vid_gather_pair_type& pair, buffer) {
-          const lvid_type lvid = graph.local_vid(pair.first);
-          const gather_type& accum = pair.second;
+        typename gather_exchange_type::value_reader reader(recv_buffer[i]);
+        while(!reader.done()) {
+          vertex_id_type vid; reader.archive() >> vid;
+          const lvid_type lvid = graph.local_vid(vid);
           ASSERT_TRUE(graph.l_is_master(lvid));
           vlocks[lvid].lock();
           if( has_gather_accum.get(lvid) ) {
+            reader.archive() >> accum;
             gather_accum[lvid] += accum;
           } else {
-            gather_accum[lvid] = accum;
+            // deserialize straight into the accumulator
+            reader.archive() >> gather_accum[lvid];
             has_gather_accum.set_bit(lvid);
           }
           vlocks[lvid].unlock();
+          reader.next();
         }
       }
     }
@@ -1918,19 +2093,23 @@ namespace graphlab {
   recv_messages() {
     typename message_exchange_type::recv_buffer_type recv_buffer;
     while(message_exchange.recv(recv_buffer)) {
+      message_type message;
       for (size_t i = 0;i < recv_buffer.size(); ++i) {
-        typename message_exchange_type::buffer_type& buffer = recv_buffer[i].buffer;
-        foreach(const vid_message_pair_type& pair, buffer) {
-          const lvid_type lvid = graph.local_vid(pair.first);
+        typename message_exchange_type::value_reader reader(recv_buffer[i]);
+        while(!reader.done()) {
+          vertex_id_type vid; reader.archive() >> vid;
+          const lvid_type lvid = graph.local_vid(vid);
           ASSERT_TRUE(graph.l_is_master(lvid));
           vlocks[lvid].lock();
           if( has_message.get(lvid) ) {
-            messages[lvid] += pair.second;
+            reader.archive() >> message;
+            messages[lvid] += message;
           } else {
-            messages[lvid] = pair.second;
+            reader.archive() >> messages[lvid];
             has_message.set_bit(lvid);
           }
           vlocks[lvid].unlock();
+          reader.next();
         }
       }
     }
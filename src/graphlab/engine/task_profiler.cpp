@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <cmath>
+#include <sstream>
+#include <graphlab/engine/task_profiler.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/ui/metrics_server.hpp>
+#include <graphlab/logger/assertions.hpp>
+
+namespace graphlab {
+
+  const char* task_profiler::phase_name(size_t p) {
+    static const char* names[NUM_PHASES] = {
+      "lock_wait", "gather", "gather_wait", "apply", "scatter", "scatter_wait"
+    };
+    ASSERT_LT(p, size_t(NUM_PHASES));
+    return names[p];
+  }
+
+  void task_profiler::init(size_t nworkers, double sample_rate) {
+    ASSERT_GE(sample_rate, 0);
+    ASSERT_LE(sample_rate, 1);
+    period = sample_rate > 0 ?
+        std::max<size_t>(size_t(std::floor(1.0 / sample_rate + 0.5)), 1) : 0;
+    workers.clear();
+    workers.resize(nworkers);
+  }
+
+  void task_profiler::reset() {
+    for (size_t i = 0; i < workers.size(); ++i) {
+      workers[i].hist = histogram();
+      workers[i].countdown = 1;
+    }
+  }
+
+  task_profiler::histogram task_profiler::get_histogram() const {
+    histogram ret;
+    for (size_t i = 0; i < workers.size(); ++i) ret += workers[i].hist;
+    return ret;
+  }
+
+  // the smallest degree in a degree bucket
+  static size_t bucket_min_degree(size_t b) {
+    return b == 0 ? 0 : size_t(1) << (b - 1);
+  }
+
+  void task_profiler::write_histogram(const histogram& hist,
+                                      std::ostream& out) {
+    out << "min_degree\ttasks";
+    for (size_t p = 0; p < NUM_PHASES; ++p) out << "\t" << phase_name(p);
+    out << "\tcontext_switches\n";
+    for (size_t b = 0; b < hist.buckets.size(); ++b) {
+      const bucket_stats& s = hist.buckets[b];
+      if (s.ntasks == 0) continue;
+      out << bucket_min_degree(b) << "\t" << s.ntasks;
+      for (size_t p = 0; p < NUM_PHASES; ++p) out << "\t" << s.seconds[p];
+      out << "\t" << s.context_switches << "\n";
+    }
+  }
+
+  std::string task_profiler::histogram_json(const histogram& hist) {
+    std::stringstream strm;
+    strm << "{\n"
+         << "  \"units\": \"seconds\",\n"
+         << "  \"phases\": [";
+    for (size_t p = 0; p < NUM_PHASES; ++p) {
+      strm << (p ? ", " : "") << "\"" << phase_name(p) << "\"";
+    }
+    strm << "],\n"
+         << "  \"buckets\": [";
+    bool first = true;
+    for (size_t b = 0; b < hist.buckets.size(); ++b) {
+      const bucket_stats& s = hist.buckets[b];
+      if (s.ntasks == 0) continue;
+      strm << (first ? "\n" : ",\n")
+           << "    {\"min_degree\": " << bucket_min_degree(b)
+           << ", \"tasks\": " << s.ntasks
+           << ", \"seconds\": [";
+      for (size_t p = 0; p < NUM_PHASES; ++p) {
+        strm << (p ? ", " : "") << s.seconds[p];
+      }
+      strm << "], \"context_switches\": " << s.context_switches << "}";
+      first = false;
+    }
+    strm << "\n  ]\n"
+         << "}\n";
+    return strm.str();
+  }
+
+
+  // the histogram shown on the metrics server
+  static mutex& published_lock() {
+    static mutex lock;
+    return lock;
+  }
+
+  static std::string& published_json() {
+    static std::string json = "{}\n";
+    return json;
+  }
+
+  static std::pair<std::string, std::string>
+  task_profile_json(std::map<std::string, std::string>& vars) {
+    published_lock().lock();
+    std::string ret = published_json();
+    published_lock().unlock();
+    return std::make_pair(std::string("text/plain"), ret);
+  }
+
+  void task_profiler::publish(const histogram& hist) {
+    const std::string json = histogram_json(hist);
+    published_lock().lock();
+    static bool registered = false;
+    if (!registered) {
+      add_metric_server_callback("task_profile.json", task_profile_json);
+      registered = true;
+    }
+    published_json() = json;
+    published_lock().unlock();
+  }
+
+} // namespace graphlab
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_TASK_PROFILER_HPP
+#define GRAPHLAB_TASK_PROFILER_HPP
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/parallel/fiber_control.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+
+namespace graphlab {
+
+  /**
+   * \internal
+   * A sampling profiler of the cost of the tasks run by the
+   * async_consistent_engine. Every k-th task on each worker is timed,
+   * split into the phases below, and accumulated in a histogram over
+   * the log2 of the degree of the vertex. This separates the cost of
+   * high degree vertices from lock contention (LOCK_WAIT) and from
+   * waiting on the mirrors over the network (GATHER_WAIT and
+   * SCATTER_WAIT). The number of fiber context switches during each
+   * task is also recorded.
+   *
+   * Each worker accumulates into its own histogram without locking.
+   * Since the fibers of a worker never run concurrently, the profiler
+   * may be used from any number of fibers.
+   */
+  class task_profiler {
+  public:
+    /// The phases of a task
+    enum phase {
+      LOCK_WAIT,     ///< acquiring the distributed locks
+      GATHER,        ///< the local gather, and issuing the mirror gathers
+      GATHER_WAIT,   ///< waiting for the mirror gathers
+      APPLY,         ///< the apply
+      SCATTER,       ///< the local scatter, and issuing the mirror scatters
+      SCATTER_WAIT,  ///< waiting for the mirror scatters
+      NUM_PHASES
+    };
+
+    /// Returns the name of a phase
+    static const char* phase_name(size_t p);
+
+    /**
+     * The number of degree buckets. Bucket 0 holds degree 0 and bucket
+     * b > 0 holds degrees in [2^(b-1), 2^b).
+     */
+    static const size_t NUM_DEGREE_BUCKETS = 48;
+
+    /// Returns the degree bucket of a degree
+    static size_t degree_bucket(size_t degree) {
+      size_t b = 0;
+      while (degree > 0 && b + 1 < NUM_DEGREE_BUCKETS) {
+        degree >>= 1;
+        ++b;
+      }
+      return b;
+    }
+
+    /// The accumulated cost of the sampled tasks of a degree bucket
+    struct bucket_stats {
+      double ntasks;
+      double seconds[NUM_PHASES];
+      double context_switches;
+
+      bucket_stats(): ntasks(0), context_switches(0) {
+        for (size_t i = 0; i < NUM_PHASES; ++i) seconds[i] = 0;
+      }
+      bucket_stats& operator+=(const bucket_stats& other) {
+        ntasks += other.ntasks;
+        for (size_t i = 0; i < NUM_PHASES; ++i) seconds[i] += other.seconds[i];
+        context_switches += other.context_switches;
+        return *this;
+      }
+      void save(oarchive& oarc) const {
+        oarc << ntasks;
+        for (size_t i = 0; i < NUM_PHASES; ++i) oarc << seconds[i];
+        oarc << context_switches;
+      }
+      void load(iarchive& iarc) {
+        iarc >> ntasks;
+        for (size_t i = 0; i < NUM_PHASES; ++i) iarc >> seconds[i];
+        iarc >> context_switches;
+      }
+    };
+
+    /// A histogram of task costs over the degree buckets
+    struct histogram {
+      std::vector<bucket_stats> buckets;
+      histogram(): buckets(NUM_DEGREE_BUCKETS) { }
+      histogram& operator+=(const histogram& other) {
+        for (size_t i = 0; i < buckets.size(); ++i) {
+          buckets[i] += other.buckets[i];
+        }
+        return *this;
+      }
+      void save(oarchive& oarc) const { oarc << buckets; }
+      void load(iarchive& iarc) { iarc >> buckets; }
+    };
+
+    /**
+     * The measurement of a single task. Lives on the stack of the fiber
+     * running the task.
+     */
+    class task_record {
+    public:
+      /// Starts timing a task on a vertex of the given degree
+      void begin(size_t degree) {
+        bucket = degree_bucket(degree);
+        for (size_t i = 0; i < NUM_PHASES; ++i) seconds[i] = 0;
+        start_switches = fiber_control::get_context_switches();
+        last = timer::sec_of_day();
+      }
+      /// Accounts the time since the end of the last phase to phase p
+      void end_phase(phase p) {
+        const double now = timer::sec_of_day();
+        seconds[p] += now - last;
+        last = now;
+      }
+    private:
+      friend class task_profiler;
+      size_t bucket;
+      size_t start_switches;
+      // the time the last phase ended
+      double last;
+      double seconds[NUM_PHASES];
+    };
+
+    task_profiler(): period(0) { }
+
+    /**
+     * Enables the profiler for nworkers workers, sampling a fraction
+     * sample_rate of the tasks. A rate of 0 disables it.
+     */
+    void init(size_t nworkers, double sample_rate);
+
+    /// True if tasks are sampled
+    bool enabled() const { return period > 0; }
+
+    /// Returns true if the next task run on the worker is to be sampled
+    bool sample(size_t workerid) {
+      if (period == 0) return false;
+      worker_state& w = workers[workerid];
+      if (--w.countdown > 0) return false;
+      w.countdown = period;
+      return true;
+    }
+
+    /// Adds a finished task to the histogram of the worker
+    void add(size_t workerid, const task_record& rec) {
+      bucket_stats& b = workers[workerid].hist.buckets[rec.bucket];
+      b.ntasks += 1;
+      for (size_t i = 0; i < NUM_PHASES; ++i) b.seconds[i] += rec.seconds[i];
+      b.context_switches +=
+          fiber_control::get_context_switches() - rec.start_switches;
+    }
+
+    /// Clears the histograms
+    void reset();
+
+    /// Returns the sum of the histograms of all workers
+    histogram get_histogram() const;
+
+    /**
+     * Writes a histogram as a tab separated table with one line per
+     * non-empty degree bucket, giving the number of sampled tasks, the
+     * total seconds spent in each phase and the total number of context
+     * switches.
+     */
+    static void write_histogram(const histogram& hist, std::ostream& out);
+
+    /// Returns a histogram as a JSON document
+    static std::string histogram_json(const histogram& hist);
+
+    /**
+     * Makes a histogram available on the metrics server as
+     * task_profile.json, replacing the previously published one.
+     */
+    static void publish(const histogram& hist);
+
+  private:
+    struct worker_state {
+      histogram hist;
+      size_t countdown;
+      // keep the countdowns of different workers on different lines
+      char padding[64];
+      worker_state(): countdown(1) { }
+    };
+    std::vector<worker_state> workers;
+    size_t period;
+  };
+
+} // namespace graphlab
+
+#endif
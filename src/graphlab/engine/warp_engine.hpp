@@ -971,12 +971,13 @@ namespace warp {
       // allocate a vector with all the local owned vertices
       // and schedule all of them.
       std::vector<vertex_id_type> vtxs;
-      vtxs.reserve(graph.num_local_own_vertices());
-      for(lvid_type lvid = 0;
-          lvid < graph.get_local_graph().num_vertices();
-          ++lvid) {
-        if (graph.l_vertex(lvid).owner() == rmi.procid() &&
-            vset.l_contains(lvid)) {
+      const size_t nscan =
+          vset.scan_size(graph.get_local_graph().num_vertices());
+      vtxs.reserve(std::min(nscan, graph.num_local_own_vertices()));
+      for(size_t i = 0; i < nscan; ++i) {
+        const lvid_type lvid = vset.scan_lvid(i);
+        if (lvid != lvid_type(-1) &&
+            graph.l_vertex(lvid).owner() == rmi.procid()) {
           vtxs.push_back(lvid);
         }
       }
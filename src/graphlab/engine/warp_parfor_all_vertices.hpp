@@ -52,9 +52,12 @@ struct parfor_all_vertices_impl{
                            vertex_set& vset): graph(graph),fn(fn),vset(vset),ctr(0) { }
 
   void run_fiber() {
+    const size_t nscan = vset.scan_size(graph.num_local_vertices());
     while (1) {
-      size_t lvid = ctr.inc_ret_last();
-      if (lvid >= graph.num_local_vertices() || !vset.l_contains(lvid)) break;
+      size_t i = ctr.inc_ret_last();
+      if (i >= nscan) break;
+      const lvid_type lvid = vset.scan_lvid(i);
+      if (lvid == lvid_type(-1)) continue;
       typename GraphType::local_vertex_type l_vertex = graph.l_vertex(lvid);
       if (l_vertex.owned()) {
         typename GraphType::vertex_type vertex(l_vertex);
@@ -86,9 +86,13 @@
 #include <graphlab/graph/graph_hash.hpp>
 
 #include <graphlab/util/hopscotch_map.hpp>
+#include <graphlab/util/swiss_map.hpp>
+#include <graphlab/util/dense_id_map.hpp>
 
 #include <graphlab/util/fs_util.hpp>
+#include <graphlab/util/memory_info.hpp>
 #include <graphlab/util/hdfs.hpp>
+#include <graphlab/util/prefetch_stream.hpp>
 
 
 #include <graphlab/graph/builtin_parsers.hpp>
@@ -608,6 +612,19 @@ namespace graphlab {
      *                when there are a large number of machines) at a small
      *                partitioning penalty. Defaults to 0. Set to 1 to
      *                enable.
+     * \li \c dense_vids Set to 1 if the vertex ids are (roughly) the dense
+     *                range [0, N). The map from vertex ids to local vertex
+     *                ids is then an array indexed by the vertex id rather
+     *                than a hash table, which makes the translation a
+     *                single load. Each machine stores an entry for every id
+     *                between the smallest and the largest one it has seen.
+     *                With random or oblivious ingress these span most of
+     *                [0, N) on every machine, so the P machines together
+     *                hold about P * N * sizeof(lvid_type) bytes of map
+     *                instead of the number of replicas. A warning is
+     *                logged when the array is much larger than the number
+     *                of local vertices. This should not be used with
+     *                sparse ids. Defaults to 0.
      * \li \c bufsize The batch size used by the batch ingress method.
      *                Defaults to 50,000. Increasing this number will
      *                decrease partitioning time with a penalty to partitioning
@@ -621,6 +638,9 @@ namespace graphlab {
     distributed_graph(distributed_control& dc,
                       const graphlab_options& opts = graphlab_options()) :
       rpc(dc, this), finalized(false), vid2lvid(),
+      structure_size(memory_info::GRAPH_STRUCTURE),
+      vdata_size(memory_info::VERTEX_DATA),
+      edata_size(memory_info::EDGE_DATA),
       nverts(0), nedges(0), local_own_nverts(0), nreplicas(0),
       ingress_ptr(NULL), 
 #ifdef _OPENMP
@@ -659,6 +679,13 @@ namespace graphlab {
           if (!parallel_ingress && rpc.procid() == 0)
             logstream(LOG_EMPH) << "Disable parallel ingress. Graph will be streamed through one node."
               << std::endl;
+        } else if (opt == "dense_vids") {
+          bool dense_vids = false;
+          opts.get_graph_args().get_option("dense_vids", dense_vids);
+          vid2lvid.set_dense(dense_vids);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: dense_vids = "
+              << dense_vids << std::endl;
         }
         /**
          * These options below are deprecated.
@@ -711,6 +738,15 @@ namespace graphlab {
       logstream(LOG_INFO) << "Distributed graph: enter finalize" << std::endl;
       ingress_ptr->finalize();
       lock_manager.resize(num_local_vertices());
+      update_tracked_memory();
+      if (vid2lvid.is_dense() &&
+          vid2lvid.span() > 8 * std::max<size_t>(num_local_vertices(), 1)) {
+        logstream(LOG_WARNING)
+          << "dense_vids: the vertex id array spans " << vid2lvid.span()
+          << " ids (" << vid2lvid.span() * sizeof(lvid_type) << " bytes)"
+          << " for " << num_local_vertices() << " local vertices."
+          << " Consider dense_vids=0." << std::endl;
+      }
       rpc.barrier(); 
 
       finalized = true;
@@ -987,16 +1023,17 @@ namespace graphlab {
 #ifdef _OPENMP
         #pragma omp for
 #endif
-        for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-          if (lvid2record[i].owner == rpc.procid() &&
-              vset.l_contains((lvid_type)i)) {
+        for (int i = 0; i < (int)vset.scan_size(local_graph.num_vertices()); ++i) {
+          const lvid_type lvid = vset.scan_lvid(i);
+          if (lvid != lvid_type(-1) &&
+              lvid2record[lvid].owner == rpc.procid()) {
             if (!result_set) {
-              const vertex_type vtx(l_vertex(i));
+              const vertex_type vtx(l_vertex(lvid));
               result = mapfunction(vtx);
               result_set = true;
             }
             else if (result_set){
-              const vertex_type vtx(l_vertex(i));
+              const vertex_type vtx(l_vertex(lvid));
               const ReductionType tmp = mapfunction(vtx);
               result += tmp;
             }
@@ -1115,10 +1152,11 @@ namespace graphlab {
 #ifdef _OPENMP
         #pragma omp for
 #endif
-        for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-          if (vset.l_contains((lvid_type)i)) {
+        for (int i = 0; i < (int)vset.scan_size(local_graph.num_vertices()); ++i) {
+          const lvid_type lvid = vset.scan_lvid(i);
+          if (lvid != lvid_type(-1)) {
             if (edir == IN_EDGES || edir == ALL_EDGES) {
-              foreach(const local_edge_type& e, l_vertex(i).in_edges()) {
+              foreach(const local_edge_type& e, l_vertex(lvid).in_edges()) {
                 if (!result_set) {
                   edge_type edge(e);
                   result = mapfunction(edge);
@@ -1132,7 +1170,7 @@ namespace graphlab {
               }
             }
             if (edir == OUT_EDGES || edir == ALL_EDGES) {
-              foreach(const local_edge_type& e, l_vertex(i).out_edges()) {
+              foreach(const local_edge_type& e, l_vertex(lvid).out_edges()) {
                 if (!result_set) {
                   edge_type edge(e);
                   result = mapfunction(edge);
@@ -1262,10 +1300,11 @@ namespace graphlab {
 #ifdef _OPENMP
         #pragma omp for
 #endif
-        for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-          if (lvid2record[i].owner == rpc.procid() &&
-              vset.l_contains((lvid_type)i)) {
-            const vertex_type vtx(l_vertex(i));
+        for (int i = 0; i < (int)vset.scan_size(local_graph.num_vertices()); ++i) {
+          const lvid_type lvid = vset.scan_lvid(i);
+          if (lvid != lvid_type(-1) &&
+              lvid2record[lvid].owner == rpc.procid()) {
+            const vertex_type vtx(l_vertex(lvid));
             foldfunction(vtx, result);
           }
         }
@@ -1381,16 +1420,17 @@ namespace graphlab {
 #ifdef _OPENMP
         #pragma omp for
 #endif
-        for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-          if (vset.l_contains((lvid_type)i)) {
+        for (int i = 0; i < (int)vset.scan_size(local_graph.num_vertices()); ++i) {
+          const lvid_type lvid = vset.scan_lvid(i);
+          if (lvid != lvid_type(-1)) {
             if (edir == IN_EDGES || edir == ALL_EDGES) {
-              foreach(const local_edge_type& e, l_vertex(i).in_edges()) {
+              foreach(const local_edge_type& e, l_vertex(lvid).in_edges()) {
                   edge_type edge(e);
                   foldfunction(edge, result);
               }
             }
             if (edir == OUT_EDGES || edir == ALL_EDGES) {
-              foreach(const local_edge_type& e, l_vertex(i).out_edges()) {
+              foreach(const local_edge_type& e, l_vertex(lvid).out_edges()) {
                 edge_type edge(e);
                 foldfunction(edge, result);
               }
@@ -1484,10 +1524,11 @@ namespace graphlab {
 #ifdef _OPENMP
       #pragma omp parallel for
 #endif
-      for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-        if (lvid2record[i].owner == rpc.procid() &&
-            vset.l_contains((lvid_type)i)) {
-          vertex_type vtx(l_vertex(i));
+      for (int i = 0; i < (int)vset.scan_size(local_graph.num_vertices()); ++i) {
+        const lvid_type lvid = vset.scan_lvid(i);
+        if (lvid != lvid_type(-1) &&
+            lvid2record[lvid].owner == rpc.procid()) {
+          vertex_type vtx(l_vertex(lvid));
           transform_functor(vtx);
         }
       }
@@ -1566,16 +1607,17 @@ namespace graphlab {
 #ifdef _OPENMP
       #pragma omp parallel for
 #endif
-      for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-        if (vset.l_contains((lvid_type)i)) {
+      for (int i = 0; i < (int)vset.scan_size(local_graph.num_vertices()); ++i) {
+        const lvid_type lvid = vset.scan_lvid(i);
+        if (lvid != lvid_type(-1)) {
           if (edir == IN_EDGES || edir == ALL_EDGES) {
-            foreach(const local_edge_type& e, l_vertex(i).in_edges()) {
+            foreach(const local_edge_type& e, l_vertex(lvid).in_edges()) {
               edge_type edge(e);
               transform_functor(edge);
             }
           }
           if (edir == OUT_EDGES || edir == ALL_EDGES) {
-            foreach(const local_edge_type& e, l_vertex(i).out_edges()) {
+            foreach(const local_edge_type& e, l_vertex(lvid).out_edges()) {
               edge_type edge(e);
               transform_functor(edge);
             }
@@ -1660,6 +1702,7 @@ namespace graphlab {
           >> lvid2record
           >> local_graph;
       finalized = true;
+      update_tracked_memory();
       // check the graph condition
     } // end of load
 
@@ -1693,6 +1736,7 @@ namespace graphlab {
       local_graph.clear();
       finalized=false;
       nverts = nedges = local_own_nverts = nreplicas = 0;
+      update_tracked_memory();
     }
 
 
@@ -2161,6 +2205,35 @@ namespace graphlab {
 
 
 
+    /**
+     *  \brief Loads the lines of a split of a file with the user
+     *  defined line parser. The file is read ahead by a background
+     *  thread, and deleted when the split is loaded.
+     */
+    void load_from_split(const file_split& split, random_access_file* file,
+                         line_parser_type& line_parser) {
+      logstream(LOG_EMPH) << "Loading graph from file: " << split.filename
+                          << " bytes [" << split.begin << ", " << split.end
+                          << ")" << std::endl;
+      // is it a gzip file ?
+      const bool gzip = boost::ends_with(split.filename, ".gz");
+      // open the stream
+      prefetch_device in_file(file, split.begin, split.end);
+      // attach gzip if the file is gzip
+      boost::iostreams::filtering_stream<boost::iostreams::input> fin;
+      // Using gzip filter
+      if (gzip) fin.push(boost::iostreams::gzip_decompressor());
+      fin.push(in_file);
+      const bool success = load_from_stream(split.filename, fin, line_parser);
+      if(!success) {
+        logstream(LOG_FATAL)
+          << "\n\tError parsing file: " << split.filename << std::endl;
+      }
+      fin.pop();
+      if (gzip) fin.pop();
+    } // end of load from split
+
+
     /**
      *  \brief Load a graph from a collection of files in stored on
      *  the filesystem using the user defined line parser. Like
@@ -2190,30 +2263,22 @@ namespace graphlab {
         logstream(LOG_WARNING) << "No files found matching " << original_path << std::endl;
       }
 
+      std::vector<size_t> sizes(graph_files.size());
+      for(size_t i = 0; i < graph_files.size(); ++i) {
+        sizes[i] = boost::filesystem::file_size(graph_files[i]);
+      }
+      // large files are split in byte ranges loaded in parallel
+      std::vector<file_split> splits;
+      split_files(graph_files, sizes, DEFAULT_SPLIT_SIZE, splits);
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-      for(size_t i = 0; i < graph_files.size(); ++i) {
+      for(size_t i = 0; i < splits.size(); ++i) {
         if ((parallel_ingress && (i % rpc.numprocs() == rpc.procid()))
             || (!parallel_ingress && (rpc.procid() == 0))) {
-          logstream(LOG_EMPH) << "Loading graph from file: " << graph_files[i] << std::endl;
-          // is it a gzip file ?
-          const bool gzip = boost::ends_with(graph_files[i], ".gz");
-          // open the stream
-          std::ifstream in_file(graph_files[i].c_str(),
-                                std::ios_base::in | std::ios_base::binary);
-          // attach gzip if the file is gzip
-          boost::iostreams::filtering_stream<boost::iostreams::input> fin;
-          // Using gzip filter
-          if (gzip) fin.push(boost::iostreams::gzip_decompressor());
-          fin.push(in_file);
-          const bool success = load_from_stream(graph_files[i], fin, line_parser);
-          if(!success) {
-            logstream(LOG_FATAL)
-              << "\n\tError parsing file: " << graph_files[i] << std::endl;
-          }
-          fin.pop();
-          if (gzip) fin.pop();
+          load_from_split(splits[i],
+                          new posix_random_access_file(splits[i].filename),
+                          line_parser);
         }
       }
       rpc.full_barrier();
@@ -2243,27 +2308,22 @@ namespace graphlab {
       if (graph_files.size() == 0) {
         logstream(LOG_WARNING) << "No files found matching " << prefix << std::endl;
       }
+      std::vector<size_t> sizes(graph_files.size());
+      for(size_t i = 0; i < graph_files.size(); ++i) {
+        sizes[i] = hdfs.file_size(graph_files[i]);
+      }
+      // large files are split in byte ranges loaded in parallel
+      std::vector<file_split> splits;
+      split_files(graph_files, sizes, DEFAULT_SPLIT_SIZE, splits);
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-      for(size_t i = 0; i < graph_files.size(); ++i) {
+      for(size_t i = 0; i < splits.size(); ++i) {
         if ((parallel_ingress && (i % rpc.numprocs() == rpc.procid())) ||
             (!parallel_ingress && (rpc.procid() == 0))) {
-          logstream(LOG_EMPH) << "Loading graph from file: " << graph_files[i] << std::endl;
-          // is it a gzip file ?
-          const bool gzip = boost::ends_with(graph_files[i], ".gz");
-          // open the stream
-          graphlab::hdfs::fstream in_file(hdfs, graph_files[i]);
-          boost::iostreams::filtering_stream<boost::iostreams::input> fin;
-          if(gzip) fin.push(boost::iostreams::gzip_decompressor());
-          fin.push(in_file);
-          const bool success = load_from_stream(graph_files[i], fin, line_parser);
-          if(!success) {
-            logstream(LOG_FATAL)
-              << "\n\tError parsing file: " << graph_files[i] << std::endl;
-          }
-          fin.pop();
-          if (gzip) fin.pop();
+          load_from_split(splits[i],
+                          new graphlab::hdfs::hdfs_file(hdfs, splits[i].filename),
+                          line_parser);
         }
       }
       rpc.full_barrier();
@@ -2473,6 +2533,27 @@ namespace graphlab {
      // foreach master bit which is set, set its corresponding mirror
      // synchronize master to mirrors
      vertex_set ret(empty_set());
+     if (cur.is_sparse()) {
+       // collect the neighbors of a small set as a list
+       std::vector<lvid_type> nbrs;
+       foreach(lvid_type lvid, cur.lvids) {
+         if (edir == IN_EDGES || edir == ALL_EDGES) {
+           foreach(local_edge_type e, l_vertex(lvid).in_edges()) {
+             nbrs.push_back(e.source().id());
+           }
+         }
+         if (edir == OUT_EDGES || edir == ALL_EDGES) {
+           foreach(local_edge_type e, l_vertex(lvid).out_edges()) {
+             nbrs.push_back(e.target().id());
+           }
+         }
+       }
+       ret.set_sparse(nbrs, num_local_vertices());
+       ret.sort_sparse();
+       ret.synchronize_mirrors_to_master_or(*this, vset_exchange);
+       ret.synchronize_master_to_mirrors(*this, vset_exchange);
+       return ret;
+     }
      ret.make_explicit(*this);
 
      foreach(size_t lvid, cur.get_lvid_bitset(*this)) {
@@ -2538,11 +2619,12 @@ namespace graphlab {
 #ifdef _OPENMP
         #pragma omp for
 #endif
-     for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-       if (lvid2record[i].owner == rpc.procid() &&
-           vset.l_contains((lvid_type)i)) {
-         const vertex_type vtx(l_vertex(i));
-         if (select_functor(vtx)) ret.set_lvid(i);
+     for (int i = 0; i < (int)vset.scan_size(local_graph.num_vertices()); ++i) {
+       const lvid_type lvid = vset.scan_lvid(i);
+       if (lvid != lvid_type(-1) &&
+           lvid2record[lvid].owner == rpc.procid()) {
+         const vertex_type vtx(l_vertex(lvid));
+         if (select_functor(vtx)) ret.set_lvid(lvid);
        }
      }
      ret.synchronize_master_to_mirrors(*this, vset_exchange);
@@ -2567,9 +2649,10 @@ namespace graphlab {
     */
    size_t vertex_set_size(const vertex_set& vset) {
      size_t count = 0;
-     for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-        count += (lvid2record[i].owner == rpc.procid() &&
-                  vset.l_contains((lvid_type)i));
+     for (size_t i = 0; i < vset.scan_size(local_graph.num_vertices()); ++i) {
+        const lvid_type lvid = vset.scan_lvid(i);
+        count += (lvid != lvid_type(-1) &&
+                  lvid2record[lvid].owner == rpc.procid());
      }
      rpc.all_reduce(count);
      return count;
@@ -2585,7 +2668,8 @@ namespace graphlab {
    bool vertex_set_empty(const vertex_set& vset) {
      if (vset.lazy) return !vset.is_complete_set;
 
-     size_t count = vset.get_lvid_bitset(*this).empty();
+     size_t count = vset.is_sparse() ? vset.lvids.empty()
+                                     : vset.get_lvid_bitset(*this).empty();
      rpc.all_reduce(count);
      return count == rpc.numprocs();
    }
@@ -2684,7 +2768,7 @@ namespace graphlab {
     lvid_type local_vid (const vertex_id_type vid) const {
       // typename boost::unordered_map<vertex_id_type, lvid_type>::
       //   const_iterator iter = vid2lvid.find(vid);
-      typename hopscotch_map_type::const_iterator iter = vid2lvid.find(vid);
+      typename vid2lvid_map_type::const_iterator iter = vid2lvid.find(vid);
       return iter->second;
     } // end of local_vertex_id
 
@@ -2768,7 +2852,7 @@ namespace graphlab {
     const vertex_record& get_vertex_record(vertex_id_type vid) const {
       // typename boost::unordered_map<vertex_id_type, lvid_type>::
       //   const_iterator iter = vid2lvid.find(vid);
-      typename hopscotch_map_type::const_iterator iter = vid2lvid.find(vid);
+      typename vid2lvid_map_type::const_iterator iter = vid2lvid.find(vid);
       ASSERT_TRUE(iter != vid2lvid.end());
       return lvid2record[iter->second];
     }
@@ -2853,12 +2937,13 @@ namespace graphlab {
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-      for(lvid_type lvid = 0; lvid < lvid2record.size(); ++lvid) {
+      for(int i = 0; i < (int)vset.scan_size(lvid2record.size()); ++i) {
         typename buffered_exchange<pair_type>::buffer_type recv_buffer;
-        const vertex_record& record = lvid2record[lvid];
+        const lvid_type lvid = vset.scan_lvid(i);
         // if this machine is the owner of a record then send the
         // vertex data to all mirrors
-        if(record.owner == rpc.procid() && vset.l_contains(lvid)) {
+        if(lvid != lvid_type(-1) && lvid2record[lvid].owner == rpc.procid()) {
+          const vertex_record& record = lvid2record[lvid];
           foreach(size_t proc, record.mirrors()) {
             const pair_type pair(record.gvid, local_graph.vertex_data(lvid));
 #ifdef _OPENMP
@@ -3124,6 +3209,22 @@ namespace graphlab {
 
   private:
 
+    /** Accounts the local graph to the memory_info categories. The vertex
+        and edge data are counted by their fixed size. */
+    void update_tracked_memory() {
+      const size_t vdata_bytes =
+          local_graph.num_vertices() * sizeof(vertex_data_type);
+      const size_t edata_bytes =
+          local_graph.num_edges() * sizeof(edge_data_type);
+      const size_t local_bytes = local_graph.estimate_sizeof();
+      vdata_size.set(vdata_bytes);
+      edata_size.set(edata_bytes);
+      structure_size.set(
+          local_bytes - std::min(local_bytes, vdata_bytes + edata_bytes) +
+          lvid2record.capacity() * sizeof(vertex_record) +
+          vid2lvid.estimate_sizeof());
+    }
+
     // PRIVATE DATA MEMBERS ===================================================>
     /** The rpc interface for this class */
     mutable dc_dist_object<distributed_graph> rpc;
@@ -3145,11 +3246,24 @@ namespace graphlab {
     std::vector<vertex_record>  lvid2record;
 
     // boost::unordered_map<vertex_id_type, lvid_type> vid2lvid;
-    /** The map from global vertex ids back to local vertex ids */
-    typedef hopscotch_map<vertex_id_type, lvid_type> hopscotch_map_type;
-    typedef hopscotch_map_type vid2lvid_map_type;
+    /** The map from global vertex ids back to local vertex ids.
+        With the dense_vids graph option it is an array indexed by the
+        vertex id. Otherwise the ids are hashed: USE_SWISS_VID2LVID selects
+        graphlab::swiss_map, which probes with SIMD, and
+        graphlab::hopscotch_map is used if it is not defined. */
+#ifdef USE_SWISS_VID2LVID
+    typedef swiss_map<vertex_id_type, lvid_type> vid2lvid_hash_type;
+#else
+    typedef hopscotch_map<vertex_id_type, lvid_type> vid2lvid_hash_type;
+#endif
+    typedef dense_id_map<vertex_id_type, lvid_type, vid2lvid_hash_type>
+        vid2lvid_map_type;
+
+    vid2lvid_map_type vid2lvid;
 
-    hopscotch_map_type vid2lvid;
+    /** The memory of the local graph accounted to the
+        memory_info categories */
+    memory_info::tracked_size structure_size, vdata_size, edata_size;
 
 
     /** The global number of vertices and edges */
@@ -268,6 +268,7 @@ namespace graphlab {
       std::vector<edge_id_type> dest_permute;
       std::vector<edge_id_type> src_counting_prefix_sum;
       std::vector<edge_id_type> dest_counting_prefix_sum;
+      edge_buffer.flatten();
 
 #ifdef DEBUG_GRAPH
       logstream(LOG_DEBUG) << "Graph2 finalize: Sort by source vertex" << std::endl;
@@ -493,12 +494,7 @@ namespace graphlab {
      */
     const lvid_type maxlvid() const {
       if (edge_buffer.size()) {
-        lvid_type max(0);
-        foreach(lvid_type i, edge_buffer.source_arr)
-         max = std::max(max, i);
-        foreach(lvid_type i, edge_buffer.target_arr)
-         max = std::max(max, i);
-        return max;
+        return edge_buffer.max_lvid();
       } else {
         return lvid_type(-1);
       }
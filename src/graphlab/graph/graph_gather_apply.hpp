@@ -337,6 +337,8 @@ namespace graphlab {
       void graph_gather_apply<Graph,GatherType>::exec(const vertex_set& vset) {
         if (vset.lazy && !vset.is_complete_set)
           return;
+        // the vertices are scanned a word of the bitset at a time
+        if (vset.is_sparse()) vset.make_explicit(graph);
 
         gather_accum.clear();
         // Allocate vertex locks and vertex programs
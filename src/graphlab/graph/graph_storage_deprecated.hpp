@@ -317,6 +317,7 @@ namespace graphlab {
       * fail if there are any duplicate edges.
       */
     void finalize(local_edge_buffer<VertexData, EdgeData> &edges) {
+      edges.flatten();
 #ifdef DEBUG_GRAPH
       logstream(LOG_DEBUG) << "Graph2 finalize starts." << std::endl;
 #endif
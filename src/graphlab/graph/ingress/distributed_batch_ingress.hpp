@@ -176,7 +176,7 @@ namespace graphlab {
         lvid_type lvid_target(-1);
         // typedef typename boost::unordered_map<vertex_id_type, lvid_type>::iterator 
           // vid2lvid_iter;
-        typedef typename hopscotch_map<vertex_id_type, lvid_type>::iterator
+        typedef typename graph_type::vid2lvid_map_type::iterator
           vid2lvid_iter;
         vid2lvid_iter iter;
 
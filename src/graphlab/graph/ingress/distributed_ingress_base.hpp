@@ -29,7 +29,9 @@
 #include <graphlab/graph/graph_gather_apply.hpp>
 #include <graphlab/util/memory_info.hpp>
 #include <graphlab/util/hopscotch_map.hpp>
+#include <graphlab/util/bloom_filter.hpp>
 #include <graphlab/rpc/buffered_exchange.hpp>
+#include <graphlab/serialization/delta_encoding.hpp>
 #include <graphlab/macros_def.hpp>
 namespace graphlab {
 
@@ -114,11 +116,17 @@ namespace graphlab {
   public:
     distributed_ingress_base(distributed_control& dc, graph_type& graph) :
       rpc(dc, this), graph(graph), 
+      // ingress traffic is dominated by vertex ids: send them compactly.
+      // Nothing is received until finalize, so keep what arrives
+      // serialized (and compact) until then.
 #ifdef _OPENMP
-      vertex_exchange(dc, omp_get_max_threads()), 
-      edge_exchange(dc, omp_get_max_threads()),
+      vertex_exchange(dc, omp_get_max_threads(),
+                      DEFAULT_BUFFERED_EXCHANGE_SIZE, true, true),
+      edge_exchange(dc, omp_get_max_threads(),
+                    DEFAULT_BUFFERED_EXCHANGE_SIZE, true, true),
 #else
-      vertex_exchange(dc), edge_exchange(dc),
+      vertex_exchange(dc, 1, DEFAULT_BUFFERED_EXCHANGE_SIZE, true, true),
+      edge_exchange(dc, 1, DEFAULT_BUFFERED_EXCHANGE_SIZE, true, true),
 #endif
       edge_decision(dc) {
       rpc.barrier();
@@ -199,7 +207,7 @@ namespace graphlab {
         logstream(LOG_EMPH) << "Finalizing Graph..." << std::endl;
       }
 
-      typedef typename hopscotch_map<vertex_id_type, lvid_type>::value_type
+      typedef typename graph_type::vid2lvid_map_type::value_type
         vid2lvid_pair_type;
 
       typedef typename buffered_exchange<edge_buffer_record>::buffer_type 
@@ -212,8 +220,9 @@ namespace graphlab {
        * \internal
        * Buffer storage for new vertices to the local graph.
        */
-      typedef typename graph_type::hopscotch_map_type vid2lvid_map_type;
+      typedef typename graph_type::vid2lvid_map_type vid2lvid_map_type;
       vid2lvid_map_type vid2lvid_buffer;
+      vid2lvid_buffer.set_dense(graph.vid2lvid.is_dense());
 
       /**
        * \internal
@@ -380,28 +389,54 @@ namespace graphlab {
       /*                                                                        */
       /**************************************************************************/
       {
+        typedef sorted_id_batch<vertex_id_type> vid_batch_type;
 #ifdef _OPENMP
-        buffered_exchange<vertex_id_type> vid_buffer(rpc.dc(), omp_get_max_threads());
+        buffered_exchange<vid_batch_type> vid_buffer(rpc.dc(), omp_get_max_threads());
 #else
-        buffered_exchange<vertex_id_type> vid_buffer(rpc.dc());
+        buffered_exchange<vid_batch_type> vid_buffer(rpc.dc());
 #endif
 
+        // send not owned vids to their master in sorted, delta encoded
+        // batches
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp parallel
 #endif
-        // send not owned vids to their master
-        for (lvid_type i = lvid_start; i < graph.lvid2record.size(); ++i) {
-          procid_t master = graph.lvid2record[i].owner;
-          if (master != rpc.procid())
+        {
+          std::vector<vid_batch_type> batches(rpc.numprocs());
 #ifdef _OPENMP
-            vid_buffer.send(master, graph.lvid2record[i].gvid, omp_get_thread_num());
+          const size_t thread_id = omp_get_thread_num();
+#pragma omp for
 #else
-            vid_buffer.send(master, graph.lvid2record[i].gvid);
+          const size_t thread_id = 0;
 #endif
+          for (lvid_type i = lvid_start; i < graph.lvid2record.size(); ++i) {
+            procid_t master = graph.lvid2record[i].owner;
+            if (master != rpc.procid())
+              batches[master].ids.push_back(graph.lvid2record[i].gvid);
+          }
+          for (procid_t p = 0; p < rpc.numprocs(); ++p) {
+            if (batches[p].ids.empty()) continue;
+            std::sort(batches[p].ids.begin(), batches[p].ids.end());
+            vid_buffer.send(p, batches[p], thread_id);
+            batches[p].ids.clear();
+          }
         }
         vid_buffer.flush();
         rpc.barrier();
 
+        // A filter of the vids this machine has. The master of a low
+        // degree vertex often holds none of its edges, so many of the vids
+        // received are not local, and the filter answers those without
+        // probing the two vid2lvid maps. Dense vid2lvid maps are probed
+        // as cheaply as the filter.
+        const bool use_filter = !graph.vid2lvid.is_dense();
+        blocked_bloom_filter local_vids;
+        if (use_filter) {
+          local_vids.resize(graph.lvid2record.size());
+          foreach(const vertex_record& vrec, graph.lvid2record)
+            local_vids.insert(vrec.gvid);
+        }
+
         // receive all vids owned by me
         mutex flying_vids_lock;
         boost::unordered_map<vertex_id_type, mirror_type> flying_vids;
@@ -409,12 +444,16 @@ namespace graphlab {
 #pragma omp parallel
 #endif
         {
-          typename buffered_exchange<vertex_id_type>::buffer_type buffer;
+          typename buffered_exchange<vid_batch_type>::buffer_type buffer;
           procid_t recvid;
           while(vid_buffer.recv(recvid, buffer)) {
-            foreach(const vertex_id_type vid, buffer) {
-              if (graph.vid2lvid.find(vid) == graph.vid2lvid.end()) {
-                if (vid2lvid_buffer.find(vid) == vid2lvid_buffer.end()) {
+            foreach(const vid_batch_type& batch, buffer)
+            foreach(const vertex_id_type vid, batch.ids) {
+              const bool maybe_local = !use_filter || local_vids.may_contain(vid);
+              if (!maybe_local ||
+                  graph.vid2lvid.find(vid) == graph.vid2lvid.end()) {
+                if (!maybe_local ||
+                    vid2lvid_buffer.find(vid) == vid2lvid_buffer.end()) {
                   flying_vids_lock.lock();
                   mirror_type& mirrors = flying_vids[vid];
                   flying_vids_lock.unlock();
@@ -25,53 +25,86 @@
 #define GRAPHLAB_LOCAL_EDGE_BUFFER
 
 #include <vector>
+#include <algorithm>
 #include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/util/region_allocator.hpp>
 
 namespace graphlab {    
 
     template<typename VertexData, typename EdgeData>
     // Edge class for temporary storage. Will be finalized into the CSR+CSC form.
+    // Edges are added to region allocated chunked arrays, which grow without
+    // copying, and are moved into the flat arrays by flatten() when the
+    // graph is finalized.
     class local_edge_buffer {
     public:
       std::vector<EdgeData> data;
       std::vector<lvid_type> source_arr;
       std::vector<lvid_type> target_arr;
+    private:
+      chunked_array<EdgeData> new_data;
+      chunked_array<lvid_type> new_source;
+      chunked_array<lvid_type> new_target;
     public:
-      local_edge_buffer() {}
-      void reserve_edge_space(size_t n) {
-        data.reserve(n);
-        source_arr.reserve(n);
-        target_arr.reserve(n);
-      }
+      local_edge_buffer() :
+        new_data(memory_info::EDGE_DATA),
+        new_source(memory_info::GRAPH_STRUCTURE),
+        new_target(memory_info::GRAPH_STRUCTURE) { }
+      // \brief The chunked storage needs no reservation. Kept for
+      // compatibility.
+      void reserve_edge_space(size_t n) { }
       // \brief Add an edge to the temporary storage.
       void add_edge(lvid_type source, lvid_type target, EdgeData _data) {
-        data.push_back(_data);
-        source_arr.push_back(source);
-        target_arr.push_back(target);
+        new_data.push_back(_data);
+        new_source.push_back(source);
+        new_target.push_back(target);
       }
       // \brief Add edges in block to the temporary storage.
       void add_block_edges(const std::vector<lvid_type>& src_arr, 
                            const std::vector<lvid_type>& dst_arr, 
                            const std::vector<EdgeData>& edata_arr) {
-        data.insert(data.end(), edata_arr.begin(), edata_arr.end());
-        source_arr.insert(source_arr.end(), src_arr.begin(), src_arr.end());
-        target_arr.insert(target_arr.end(), dst_arr.begin(), dst_arr.end());
+        new_data.append(edata_arr.begin(), edata_arr.end());
+        new_source.append(src_arr.begin(), src_arr.end());
+        new_target.append(dst_arr.begin(), dst_arr.end());
+      }
+      // \brief Move the added edges into data, source_arr and target_arr,
+      // releasing the chunked storage as it is copied.
+      void flatten() {
+        new_source.move_to(source_arr);
+        new_target.move_to(target_arr);
+        new_data.move_to(data);
       }
       // \brief Remove all contents in the storage. 
       void clear() {
         std::vector<EdgeData>().swap(data);
         std::vector<lvid_type>().swap(source_arr);
         std::vector<lvid_type>().swap(target_arr);
+        new_data.clear();
+        new_source.clear();
+        new_target.clear();
       }
       // \brief Return the size of the storage.
       size_t size() const {
-        return source_arr.size();
+        return source_arr.size() + new_source.size();
+      }
+      // \brief Return the largest vertex id in the storage.
+      lvid_type max_lvid() const {
+        lvid_type max(0);
+        for (size_t i = 0; i < source_arr.size(); ++i) {
+          max = std::max(max, std::max(source_arr[i], target_arr[i]));
+        }
+        for (size_t i = 0; i < new_source.size(); ++i) {
+          max = std::max(max, std::max(new_source[i], new_target[i]));
+        }
+        return max;
       }
       // \brief Return the estimated memory footprint used.
       size_t estimate_sizeof() const {
         return data.capacity()*sizeof(EdgeData) + 
           source_arr.capacity()*sizeof(lvid_type)*2 + 
-          sizeof(data) + sizeof(source_arr)*2 + sizeof(local_edge_buffer);
+          sizeof(data) + sizeof(source_arr)*2 + sizeof(local_edge_buffer) +
+          new_data.estimate_sizeof() + new_source.estimate_sizeof() +
+          new_target.estimate_sizeof();
       }
     }; // end of class local_edge_buffer.
 } // end of namespace
@@ -25,6 +25,9 @@
 #ifndef GRAPHLAB_GRAPH_VERTEX_SET_HPP
 #define GRAPHLAB_GRAPH_VERTEX_SET_HPP
 
+#include <vector>
+#include <algorithm>
+#include <iterator>
 #include <graphlab/util/dense_bitset.hpp>
 #include <graphlab/graph/graph_basic_types.hpp>
 #include <graphlab/rpc/buffered_exchange.hpp>
@@ -67,12 +70,17 @@ namespace graphlab {
  * The size of the vertex set can only be queried through the graph using
  * \ref distributed_graph::vertex_set_size();
  *
+ * Internally a set is either a bitset over the local vertices, or a sorted
+ * list of local vertex ids if it holds few vertices, so that operations
+ * on small sets such as the late frontiers of a BFS cost time proportional
+ * to the size of the set rather than to the number of vertices. The
+ * representation is chosen when the set is synchronized with the mirrors.
  */
 class vertex_set {
   public:
     /**
-     * Used only if \ref lazy is false.
-     * If \ref lazy is false, this must be the same size as the graph's
+     * Used only if \ref lazy and \ref sparse are false.
+     * If it is used, this must be the same size as the graph's
      * graphlab::distributed_graph::num_local_vertices().
      * The invariant is that the bit value of each mirror vertex must be the
      * same value as the bit value on their corresponding master vertices.
@@ -92,6 +100,29 @@ class vertex_set {
      */
     mutable bool lazy;
 
+    /**
+     * If set (which implies \ref lazy is false), the set is described by
+     * \ref lvids and localvset is empty.
+     */
+    mutable bool sparse;
+
+    /**
+     * Used only if \ref sparse is set. The local vertex ids in the set,
+     * sorted.
+     */
+    mutable std::vector<lvid_type> lvids;
+
+    /**
+     * Used only if \ref sparse is set. The number of local vertices.
+     */
+    mutable size_t nlocal;
+
+    /**
+     * Explicit sets holding at most 1 / SPARSE_FRACTION of the local
+     * vertices are stored as a list.
+     */
+    static const size_t SPARSE_FRACTION = 64;
+
 
     /**
      * \internal
@@ -99,7 +130,7 @@ class vertex_set {
      */
     template <typename DGraphType>
     const dense_bitset& get_lvid_bitset(const DGraphType& dgraph) const {
-      if (lazy) make_explicit(dgraph);
+      if (lazy || sparse) make_explicit(dgraph);
       return localvset;
     }
 
@@ -113,6 +144,7 @@ class vertex_set {
      */
     inline void set_lvid_unsync(lvid_type lvid) {
       ASSERT_FALSE(lazy);
+      ASSERT_FALSE(sparse);
       localvset.set_bit_unsync(lvid);
     }
 
@@ -126,6 +158,7 @@ class vertex_set {
      */
     inline void set_lvid(lvid_type lvid) {
       ASSERT_FALSE(lazy);
+      ASSERT_FALSE(sparse);
       localvset.set_bit(lvid);
     }
 
@@ -145,9 +178,65 @@ class vertex_set {
           localvset.clear();
         }
         lazy = false;
+      } else if (sparse) {
+        make_dense();
+      }
+    }
+
+    /**
+     * \internal
+     * Converts a sparse set to a bitset.
+     */
+    void make_dense() const {
+      localvset.resize(nlocal);
+      localvset.clear();
+      foreach(lvid_type lvid, lvids) localvset.set_bit_unsync(lvid);
+      std::vector<lvid_type>().swap(lvids);
+      sparse = false;
+    }
+
+    /**
+     * \internal
+     * Makes the set the sorted list of local vertex ids in sorted_lvids,
+     * out of nverts local vertices. sorted_lvids is emptied.
+     */
+    void set_sparse(std::vector<lvid_type>& sorted_lvids, size_t nverts) {
+      lvids.swap(sorted_lvids);
+      std::vector<lvid_type>().swap(sorted_lvids);
+      localvset.resize(0);
+      nlocal = nverts;
+      lazy = false;
+      sparse = true;
+    }
+
+    /**
+     * \internal
+     * Picks the representation of an explicit set by its density.
+     */
+    void adapt_representation() const {
+      if (lazy) return;
+      if (sparse) {
+        if (lvids.size() * SPARSE_FRACTION > nlocal) make_dense();
+      } else if (localvset.popcount() * SPARSE_FRACTION <= localvset.size()) {
+        nlocal = localvset.size();
+        lvids.clear();
+        foreach(size_t lvid, localvset) lvids.push_back(lvid);
+        localvset.resize(0);
+        sparse = true;
       }
     }
 
+    /// Sorts the lvids of a sparse set and removes duplicates
+    void sort_sparse() {
+      std::sort(lvids.begin(), lvids.end());
+      lvids.erase(std::unique(lvids.begin(), lvids.end()), lvids.end());
+    }
+
+    /// The number of local vertices of an explicit set
+    size_t num_local() const {
+      return sparse ? nlocal : localvset.size();
+    }
+
     /**
      * \internal
      * Copies the master state to each mirror.
@@ -160,17 +249,33 @@ class vertex_set {
         make_explicit(dgraph);
         return;
       }
-      foreach(size_t lvid, localvset) {
-        typename DGraphType::local_vertex_type lvtx = dgraph.l_vertex(lvid);
-        if (lvtx.owned()) {
-          // send to mirrors
-          vertex_id_type gvid = lvtx.global_id();
-          foreach(size_t proc, lvtx.mirrors()) {
-            exchange.send(proc, gvid);
+      if (sparse) {
+        size_t nowned = 0;
+        for (size_t i = 0; i < lvids.size(); ++i) {
+          typename DGraphType::local_vertex_type lvtx = dgraph.l_vertex(lvids[i]);
+          if (lvtx.owned()) {
+            // send to mirrors
+            vertex_id_type gvid = lvtx.global_id();
+            foreach(size_t proc, lvtx.mirrors()) {
+              exchange.send(proc, gvid);
+            }
+            lvids[nowned++] = lvids[i];
           }
         }
-        else {
-          localvset.clear_bit_unsync(lvid);
+        lvids.resize(nowned);
+      } else {
+        foreach(size_t lvid, localvset) {
+          typename DGraphType::local_vertex_type lvtx = dgraph.l_vertex(lvid);
+          if (lvtx.owned()) {
+            // send to mirrors
+            vertex_id_type gvid = lvtx.global_id();
+            foreach(size_t proc, lvtx.mirrors()) {
+              exchange.send(proc, gvid);
+            }
+          }
+          else {
+            localvset.clear_bit_unsync(lvid);
+          }
         }
       }
       exchange.flush();
@@ -180,11 +285,15 @@ class vertex_set {
 
       while(exchange.recv(sending_proc, recv_buffer)) {
         foreach(vertex_id_type gvid, recv_buffer) {
-          localvset.set_bit_unsync(dgraph.vertex(gvid).local_id());
+          const lvid_type lvid = dgraph.vertex(gvid).local_id();
+          if (sparse) lvids.push_back(lvid);
+          else localvset.set_bit_unsync(lvid);
         }
         recv_buffer.clear();
       }
       exchange.barrier();
+      if (sparse) sort_sparse();
+      adapt_representation();
     }
 
 
@@ -199,12 +308,23 @@ class vertex_set {
         make_explicit(dgraph);
         return;
       }
-      foreach(size_t lvid, localvset) {
-        typename DGraphType::local_vertex_type lvtx = dgraph.l_vertex(lvid);
-        if (!lvtx.owned()) {
-          // send to master
-          vertex_id_type gvid = lvtx.global_id();
-          exchange.send(lvtx.owner(), gvid);
+      if (sparse) {
+        foreach(lvid_type lvid, lvids) {
+          typename DGraphType::local_vertex_type lvtx = dgraph.l_vertex(lvid);
+          if (!lvtx.owned()) {
+            // send to master
+            vertex_id_type gvid = lvtx.global_id();
+            exchange.send(lvtx.owner(), gvid);
+          }
+        }
+      } else {
+        foreach(size_t lvid, localvset) {
+          typename DGraphType::local_vertex_type lvtx = dgraph.l_vertex(lvid);
+          if (!lvtx.owned()) {
+            // send to master
+            vertex_id_type gvid = lvtx.global_id();
+            exchange.send(lvtx.owner(), gvid);
+          }
         }
       }
       exchange.flush();
@@ -214,11 +334,15 @@ class vertex_set {
 
       while(exchange.recv(sending_proc, recv_buffer)) {
         foreach(vertex_id_type gvid, recv_buffer) {
-          localvset.set_bit_unsync(dgraph.vertex(gvid).local_id());
+          const lvid_type lvid = dgraph.vertex(gvid).local_id();
+          if (sparse) lvids.push_back(lvid);
+          else localvset.set_bit_unsync(lvid);
         }
         recv_buffer.clear();
       }
       exchange.barrier();
+      if (sparse) sort_sparse();
+      adapt_representation();
     }
 
     template <typename VertexType, typename EdgeType>
@@ -226,26 +350,31 @@ class vertex_set {
 
   public:
     /// default constructor which constructs an empty set.
-    vertex_set():is_complete_set(false), lazy(true){}
+    vertex_set():is_complete_set(false), lazy(true), sparse(false), nlocal(0){}
 
 
     /** Constructs a completely empty, or a completely full vertex set
      * \param complete If set to true, creates a set of all vertices.
      *                 If set to false, creates an empty set.
      */
-    explicit vertex_set(bool complete):is_complete_set(complete),lazy(true){}
+    explicit vertex_set(bool complete):is_complete_set(complete),lazy(true),
+                                       sparse(false), nlocal(0){}
 
     /// copy constructor
     inline vertex_set(const vertex_set& other):
         localvset(other.localvset),
         is_complete_set(other.is_complete_set),
-        lazy(other.lazy) {}
+        lazy(other.lazy), sparse(other.sparse),
+        lvids(other.lvids), nlocal(other.nlocal) {}
 
     /// copyable
     inline vertex_set& operator=(const vertex_set& other) {
       localvset = other.localvset;
       is_complete_set = other.is_complete_set;
       lazy = other.lazy;
+      sparse = other.sparse;
+      lvids = other.lvids;
+      nlocal = other.nlocal;
       return *this;
     }
 
@@ -255,6 +384,7 @@ class vertex_set {
      */
     inline bool l_contains(lvid_type lvid) const {
       if (lazy) return is_complete_set;
+      if (sparse) return std::binary_search(lvids.begin(), lvids.end(), lvid);
       if (lvid < localvset.size()) {
         return localvset.get(lvid);
       }
@@ -263,6 +393,36 @@ class vertex_set {
       }
     }
 
+    /**
+     * \internal
+     * The number of positions to scan to visit the local vertices in the
+     * set: the size of a sparse set, 0 for the empty set and nverts (the
+     * number of local vertices) otherwise. Visiting the set with
+     * scan_lvid() takes time proportional to the size of sparse sets.
+     */
+    inline size_t scan_size(size_t nverts) const {
+      if (lazy) return is_complete_set ? nverts : 0;
+      return sparse ? lvids.size() : nverts;
+    }
+
+    /**
+     * \internal
+     * The local vertex at position i of a scan, or lvid_type(-1) if
+     * the local vertex i is not in the set.
+     */
+    inline lvid_type scan_lvid(size_t i) const {
+      if (sparse) return lvids[i];
+      return l_contains(i) ? lvid_type(i) : lvid_type(-1);
+    }
+
+    /**
+     * \internal
+     * Returns true if the set is stored as a list of local vertex ids
+     */
+    inline bool is_sparse() const {
+      return sparse;
+    }
+
     /**
      * \brief Takes the set intersection of two vertex sets.
      *
@@ -337,6 +497,16 @@ class vertex_set {
         if (other.is_complete_set) /* no op */;
         else (*this) = vertex_set(false);
       }
+      else if (sparse || other.sparse) {
+        // the intersection is no larger than the sparse operand
+        std::vector<lvid_type> result;
+        const vertex_set& list = sparse ? *this : other;
+        const vertex_set& filter = sparse ? other : *this;
+        foreach(lvid_type lvid, list.lvids) {
+          if (filter.l_contains(lvid)) result.push_back(lvid);
+        }
+        set_sparse(result, num_local());
+      }
       else {
         localvset &= other.localvset;
       }
@@ -362,7 +532,19 @@ class vertex_set {
         if (other.is_complete_set) (*this) = vertex_set(true);
         else /* no op */;
       }
+      else if (sparse && other.sparse) {
+        std::vector<lvid_type> result;
+        std::set_union(lvids.begin(), lvids.end(),
+                       other.lvids.begin(), other.lvids.end(),
+                       std::back_inserter(result));
+        set_sparse(result, num_local());
+        adapt_representation();
+      }
+      else if (other.sparse) {
+        foreach(lvid_type lvid, other.lvids) localvset.set_bit_unsync(lvid);
+      }
       else {
+        if (sparse) make_dense();
         localvset |= other.localvset;
       }
       return *this;
@@ -392,6 +574,16 @@ class vertex_set {
         if (other.is_complete_set) (*this) = vertex_set(false);
         else /* no op */;
       }
+      else if (sparse) {
+        std::vector<lvid_type> result;
+        foreach(lvid_type lvid, lvids) {
+          if (!other.l_contains(lvid)) result.push_back(lvid);
+        }
+        set_sparse(result, nlocal);
+      }
+      else if (other.sparse) {
+        foreach(lvid_type lvid, other.lvids) localvset.clear_bit_unsync(lvid);
+      }
       else {
         localvset -= other.localvset;
       }
@@ -425,6 +617,7 @@ class vertex_set {
         is_complete_set = !is_complete_set;
       }
       else {
+        if (sparse) make_dense();
         localvset.invert();
       }
     }
@@ -21,8 +21,11 @@
  */
 
 
+#include <cstdlib>
+#include <cstring>
 #include <boost/bind.hpp>
 #include <graphlab/util/random.hpp>
+#include <graphlab/util/timer.hpp>
 #include <graphlab/parallel/fiber_control.hpp>
 #include <graphlab/logger/assertions.hpp>
 #include <graphlab/rpc/dc.hpp>
@@ -36,6 +39,11 @@ size_t fiber_control::instance_construct_params_nworkers = 0;
 size_t fiber_control::instance_construct_params_affinity_base = 0;
 pthread_key_t fiber_control::tlskey;
 
+static bool env_flag(const char* name) {
+  const char* val = getenv(name);
+  return val != NULL && val[0] != '\0' && strcmp(val, "0") != 0;
+}
+
 fiber_control::affinity_type fiber_control::all_affinity() {
   affinity_type ret;
   ret.fill();
@@ -47,6 +55,10 @@ fiber_control::fiber_control(size_t nworkers,
     :nworkers(nworkers),
     affinity_base(affinity_base),
     stop_workers(false),
+    stacks(nworkers,
+           env_flag("GRAPHLAB_FIBER_HUGEPAGES"),
+           env_flag("GRAPHLAB_FIBER_STACK_USAGE")),
+    work_stealing(true),
     flsdeleter(NULL) {
   // initialize the thread local storage keys
   if (!tls_created) {
@@ -122,6 +134,9 @@ void fiber_control::active_queue_insert_tail(size_t workerid, fiber_control::fib
       schedule[workerid].active_lock.lock();
       schedule[workerid].active_cond.signal();
       schedule[workerid].active_lock.unlock();
+    } else if (work_stealing && idle_workers.value > 0 &&
+               value->affinity_array.size() > 1) {
+      wake_thief(workerid, value);
     }
   }
 }
@@ -168,7 +183,9 @@ fiber_control::fiber* fiber_control::active_queue_remove(size_t workerid) {
   thread_schedule& curts = schedule[workerid];
   ret = try_pop_queue(*curts.priority_queue, curts.popped_priority_queue);
   if (ret == NULL) {
+    curts.affinity_consumer_lock.lock();
     ret = try_pop_queue(*curts.affinity_queue , curts.popped_affinity_queue);
+    curts.affinity_consumer_lock.unlock();
   }
   if (ret) {
     // printf("%ld: Running %ld\n", get_worker_id(), ret->id);
@@ -176,6 +193,79 @@ fiber_control::fiber* fiber_control::active_queue_remove(size_t workerid) {
   return ret;
 }
 
+fiber_control::fiber* fiber_control::try_steal(size_t thief) {
+  if (!work_stealing || nworkers == 1) return NULL;
+  // the affinity bitset cannot name the thief
+  if (thief >= 8 * sizeof(affinity_type)) return NULL;
+  // rotate the first victim
+  size_t start = schedule[thief].next_victim++;
+  for (size_t i = 0; i < nworkers; ++i) {
+    size_t victim = (start + i) % nworkers;
+    if (victim == thief) continue;
+    thread_schedule& vs = schedule[victim];
+    if (vs.popped_affinity_queue == NULL && vs.affinity_queue->empty()) continue;
+    if (!vs.affinity_consumer_lock.try_lock()) continue;
+    fiber* ret = steal_from(vs, thief);
+    vs.affinity_consumer_lock.unlock();
+    if (ret != NULL) {
+      ++schedule[thief].nsteals;
+      return ret;
+    }
+  }
+  return NULL;
+}
+
+fiber_control::fiber* fiber_control::steal_from(thread_schedule& victim,
+                                                size_t thief) {
+  // the number of queued fibers examined for one which may run on the thief
+  const size_t MAX_STEAL_SCAN = 16;
+  inplace_lf_queue2<fiber>& lfqueue = *victim.affinity_queue;
+  if (victim.popped_affinity_queue == NULL) {
+    victim.popped_affinity_queue = lfqueue.dequeue_all();
+  }
+  fiber* prev = NULL;
+  fiber* cur = victim.popped_affinity_queue;
+  for (size_t n = 0; cur != NULL && n < MAX_STEAL_SCAN; ++n) {
+    fiber* next;
+    do {
+      next = cur->next;
+      asm volatile("pause\n": : :"memory");
+    } while(next == NULL);
+    if (cur->affinity.get(thief)) {
+      // unlink cur from the popped list
+      if (prev != NULL) prev->next = next;
+      else if (next == lfqueue.end_of_dequeue_list()) {
+        victim.popped_affinity_queue = NULL;
+      } else {
+        victim.popped_affinity_queue = next;
+      }
+      return cur;
+    }
+    if (next == lfqueue.end_of_dequeue_list()) break;
+    prev = cur;
+    cur = next;
+  }
+  return NULL;
+}
+
+void fiber_control::wake_thief(size_t workerid, fiber* fib) {
+  // This runs on fiber stacks. Creating the per thread generator of
+  // graphlab::random takes about 5KB of stack, which overflows the
+  // default 8KB fiber stack, so the first worker tried is picked by
+  // fiber id instead.
+  const std::vector<unsigned char>& choices = fib->affinity_array;
+  size_t start = fib->id % choices.size();
+  for (size_t i = 0; i < choices.size(); ++i) {
+    size_t w = choices[(start + i) % choices.size()];
+    if (w != workerid && schedule[w].waiting) {
+      schedule[w].active_lock.lock();
+      schedule[w].active_cond.signal();
+      schedule[w].active_lock.unlock();
+      return;
+    }
+  }
+}
+
 void fiber_control::exit() {
   distributed_control* dc = distributed_control::get_instance();
   if (dc) dc->flush();
@@ -216,6 +306,7 @@ void fiber_control::worker_init(size_t workerid) {
   while(!stop_workers) {
     // get a fiber to run
     fiber* next_fib = t->parent->active_queue_remove(workerid);
+    if (next_fib == NULL) next_fib = try_steal(workerid);
     if (next_fib != NULL) {
       // if there is a fiber. yield to it
       schedule[workerid].active_lock.unlock();
@@ -233,7 +324,11 @@ void fiber_control::worker_init(size_t workerid) {
       schedule[workerid].active_lock.lock();
     } else {
       // if there is no fiber. wait.
+      const double idle_start = timer::sec_of_day();
+      idle_workers.inc();
       schedule[workerid].active_cond.wait(schedule[workerid].active_lock);
+      idle_workers.dec();
+      schedule[workerid].idle_time += timer::sec_of_day() - idle_start;
     }
   }
   schedule[workerid].active_lock.unlock();
@@ -269,10 +364,8 @@ size_t fiber_control::launch(boost::function<void(void)> fn,
   // make sure there is always a worker I can work on
   ASSERT_LT(b, nworkers);
 
-  // allocate a stack
   fiber* fib = new fiber;
   fib->parent = this;
-  fib->stack = malloc(stacksize);
   fib->id = fiber_id_counter.inc();
   foreach(size_t b, affinity) {
     if (b < nworkers) fib->affinity_array.push_back((unsigned char)b);
@@ -280,6 +373,10 @@ size_t fiber_control::launch(boost::function<void(void)> fn,
   }
   ASSERT_GT(fib->affinity_array.size(), 0);
   fib->affinity = affinity;
+  // find a place to put the thread, and take a stack from its pool
+  size_t choice = pick_fiber_worker(fib);
+  fib->stack = stacks.allocate(choice, stacksize);
+  fib->stacksize = stacksize;
   //VALGRIND_STACK_REGISTER(fib->stack, (char*)fib->stack + stacksize);
   fib->fls = NULL;
   fib->next = NULL;
@@ -287,6 +384,7 @@ size_t fiber_control::launch(boost::function<void(void)> fn,
   fib->terminate = false;
   fib->descheduled = false;
   fib->scheduleable = true;
+  fib->nswitches = 0;
   // construct the initial context
   trampoline_args* args = new trampoline_args;
   args->fn = fn;
@@ -297,8 +395,6 @@ size_t fiber_control::launch(boost::function<void(void)> fn,
                                                trampoline);
   fibers_active.inc();
 
-  // find a place to put the thread
-  size_t choice = pick_fiber_worker(fib);
   active_queue_insert_tail(choice, fib);
   return reinterpret_cast<size_t>(fib);
 }
@@ -334,6 +430,8 @@ void fiber_control::yield_to(fiber* next_fib) {
   if (next_fib != NULL) {
     // reset the priority flag
     next_fib->priority = false;
+    ++next_fib->nswitches;
+    ++schedule[t->workerid].nswitches;
     // current fiber moves to previous
     // next fiber move to current
     t->prev_fiber = t->cur_fiber;
@@ -404,7 +502,7 @@ void fiber_control::reschedule_fiber(size_t workerid, fiber* fib) {
   } else if (fib->terminate) {
     fib->lock.unlock();
     // previous fiber is dead. destroy it
-    free(fib->stack);
+    stacks.deallocate(workerid, fib->stack, fib->stacksize);
     //VALGRIND_STACK_DEREGISTER(fib->stack);
     // delete the fiber local storage if any
     if (fib->fls && flsdeleter) flsdeleter(fib->fls);
@@ -453,6 +551,30 @@ size_t fiber_control::get_tid() {
 }
 
 
+size_t fiber_control::get_context_switches() {
+  fiber_control::tls* tls = get_tls_ptr();
+  if (tls != NULL && tls->cur_fiber != NULL) return tls->cur_fiber->nswitches;
+  else return 0;
+}
+
+size_t fiber_control::total_context_switches() {
+  size_t ret = 0;
+  for (size_t i = 0; i < schedule.size(); ++i) ret += schedule[i].nswitches;
+  return ret;
+}
+
+size_t fiber_control::total_steals() {
+  size_t ret = 0;
+  for (size_t i = 0; i < schedule.size(); ++i) ret += schedule[i].nsteals;
+  return ret;
+}
+
+double fiber_control::total_idle_time() {
+  double ret = 0;
+  for (size_t i = 0; i < schedule.size(); ++i) ret += schedule[i].idle_time;
+  return ret;
+}
+
 bool fiber_control::in_fiber() {
   return get_tls_ptr() != NULL;
 }
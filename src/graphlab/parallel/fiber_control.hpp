@@ -33,6 +33,7 @@
 #include <graphlab/util/inplace_lf_queue2.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/fiber_stack_pool.hpp>
 namespace graphlab {
 
 /**
@@ -49,6 +50,7 @@ class fiber_control {
     fiber_control* parent;
     boost::context::fcontext_t* context;
     void* stack;
+    size_t stacksize;
     size_t id;
     affinity_type affinity;
     std::vector<unsigned char> affinity_array;
@@ -73,6 +75,7 @@ class fiber_control {
                       // lock must be acquired for this to be modified.
     bool priority;  // flag. If set, rescheduling this fiber
                     // will cause it to be placed at the head of the queue
+    size_t nswitches; // the number of times this fiber was switched to
   };
 
 
@@ -89,14 +92,25 @@ class fiber_control {
 
   // The scheduler is a simple queue. One for each worker
   struct thread_schedule {
-    thread_schedule():waiting(false) { }
+    thread_schedule():waiting(false), nswitches(0), nsteals(0), idle_time(0),
+                      next_victim(0) { }
     mutex active_lock;
     conditional active_cond;
     volatile bool waiting;
     size_t nwaiting;
+    // the number of context switches into fibers on this worker
+    size_t nswitches;
+    // the number of fibers this worker stole from other workers
+    size_t nsteals;
+    // the time in seconds this worker slept waiting for fibers
+    double idle_time;
+    // the first worker this worker tries to steal from next
+    size_t next_victim;
     // a queue of fibers to evaluate before those in the thread_queue
     inplace_lf_queue2<fiber>* affinity_queue;
     fiber* popped_affinity_queue;
+    // held to dequeue from affinity_queue, by the worker or by a thief
+    simple_spinlock affinity_consumer_lock;
 
     inplace_lf_queue2<fiber>* priority_queue;
     fiber* popped_priority_queue;
@@ -105,12 +119,22 @@ class fiber_control {
 
   thread_group workers;
 
+  fiber_stack_pool stacks;
+
+  bool work_stealing;
+  // the number of workers sleeping in worker_init
+  atomic<size_t> idle_workers;
 
   // locks must be acquired outside the call
   void active_queue_insert_head(size_t workerid, fiber* value);
   void active_queue_insert_tail(size_t workerid, fiber* value);
   void active_queue_insert_tail(fiber* value);
   fiber* active_queue_remove(size_t workerid);
+  /// Takes a fiber which may run on the thief from another worker's queue
+  fiber* try_steal(size_t thief);
+  fiber* steal_from(thread_schedule& victim, size_t thief);
+  /// Wakes a sleeping worker which could steal fib from workerid's queue
+  void wake_thief(size_t workerid, fiber* fib);
 
   // a thread local storage for the worker to point to a fiber
   static bool tls_created;
@@ -147,7 +171,7 @@ class fiber_control {
   size_t pick_fiber_worker(fiber* fib);
 
   // delete copy constructor
-  fiber_control(fiber_control&) {};
+  fiber_control(fiber_control&);
   
  public:
 
@@ -191,6 +215,48 @@ class fiber_control {
   inline size_t total_threads_created() {
     return fiber_id_counter.value;
   }
+
+  /**
+   * Returns the total number of context switches into fibers on all
+   * workers. Not synchronized with the workers.
+   */
+  size_t total_context_switches();
+
+  /**
+   * Enables or disables work stealing. Enabled by default.
+   *
+   * A worker which runs out of fibers steals a fiber from the queue of
+   * another worker, provided the affinity of the fiber allows it to run
+   * on the thief. When a fiber which may run on several workers is queued
+   * on a busy worker, a sleeping worker of its affinity is woken to steal
+   * it. Fibers rescheduled at the head of the queue, such as those woken
+   * by schedule_tid(), are not stolen.
+   */
+  void set_work_stealing(bool enabled) {
+    work_stealing = enabled;
+  }
+
+  /**
+   * Returns the total number of fibers stolen by the workers.
+   * Not synchronized with the workers.
+   */
+  size_t total_steals();
+
+  /**
+   * Returns the total time in seconds the workers slept waiting for
+   * fibers. Not synchronized with the workers.
+   */
+  double total_idle_time();
+  /**
+   * Returns the pool the fiber stacks are allocated from. Huge page
+   * backed stacks are enabled by setting the environment variable
+   * GRAPHLAB_FIBER_HUGEPAGES=1, and stack usage tracking by setting
+   * GRAPHLAB_FIBER_STACK_USAGE=1, before the instance is created.
+   */
+  const fiber_stack_pool& get_stack_pool() const {
+    return stacks;
+  }
+
   /**
    * Sets the TLS deletion function. The deletion function will be called
    * on every non-NULL TLS value.
@@ -281,6 +347,15 @@ class fiber_control {
   static size_t get_tid();
 
 
+  /**
+   * Returns the number of times the current fiber has been switched to,
+   * which includes its first start. The difference between two calls
+   * counts the times the fiber yielded or blocked in between.
+   * If called from outside a fiber, returns 0.
+   */
+  static size_t get_context_switches();
+
+
   /**
    * Returns true if the calling thread is in a fiber, false otherwise.
    */
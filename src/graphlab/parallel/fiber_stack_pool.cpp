@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <graphlab/parallel/fiber_stack_pool.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/logger/assertions.hpp>
+
+namespace graphlab {
+
+namespace {
+  const size_t PAGE_SIZE = 4096;
+  const size_t STACK_PAINT = 0x5A5A5A5A5A5A5A5AULL;
+}
+
+std::vector<char*>& fiber_stack_pool::free_list::get(size_t stacksize) {
+  for (size_t i = 0; i < classes.size(); ++i) {
+    if (classes[i].stacksize == stacksize) return classes[i].stacks;
+  }
+  classes.push_back(size_class(stacksize));
+  return classes.back().stacks;
+}
+
+
+fiber_stack_pool::fiber_stack_pool(size_t npools, bool use_hugepages,
+                                   bool track_usage)
+    : pools(npools), use_hugepages(use_hugepages), track_usage(track_usage) { }
+
+
+fiber_stack_pool::~fiber_stack_pool() {
+  for (size_t i = 0; i < slabs.size(); ++i) {
+    munmap(slabs[i].first, slabs[i].second);
+  }
+}
+
+
+size_t fiber_stack_pool::round_stacksize(size_t stacksize) {
+  return std::max<size_t>((stacksize + PAGE_SIZE - 1) / PAGE_SIZE, 1) *
+      PAGE_SIZE;
+}
+
+
+void* fiber_stack_pool::allocate(size_t pool, size_t& stacksize) {
+  ASSERT_LT(pool, pools.size());
+  stacksize = round_stacksize(stacksize);
+  allocated.inc();
+  free_list& fl = pools[pool];
+  fl.lock.lock();
+  std::vector<char*>& stacks = fl.get(stacksize);
+  if (stacks.empty()) {
+    // refill from the spilled stacks, or map a new slab
+    shared.lock.lock();
+    std::vector<char*>& spilled = shared.get(stacksize);
+    const size_t n = std::min(spilled.size(), max_local_stacks() / 2);
+    stacks.insert(stacks.end(), spilled.end() - n, spilled.end());
+    spilled.resize(spilled.size() - n);
+    if (stacks.empty()) new_slab(stacksize, stacks);
+    shared.lock.unlock();
+  }
+  char* ret = stacks.back();
+  stacks.pop_back();
+  fl.lock.unlock();
+  return ret;
+}
+
+
+void fiber_stack_pool::deallocate(size_t pool, void* stack, size_t stacksize) {
+  ASSERT_LT(pool, pools.size());
+  char* s = reinterpret_cast<char*>(stack);
+  if (track_usage) {
+    const size_t used = measure(s, stacksize);
+    peak_lock.lock();
+    size_t i = 0;
+    while (i < peaks.size() && peaks[i].first != stacksize) ++i;
+    if (i == peaks.size()) peaks.push_back(std::make_pair(stacksize, 0));
+    peaks[i].second = std::max(peaks[i].second, used);
+    peak_lock.unlock();
+    // the stack grows downwards from s + stacksize
+    paint(s + stacksize - used, s + stacksize);
+  }
+  free_list& fl = pools[pool];
+  fl.lock.lock();
+  std::vector<char*>& stacks = fl.get(stacksize);
+  stacks.push_back(s);
+  if (stacks.size() > max_local_stacks()) {
+    // spill the older half for the other workers to use
+    const size_t n = stacks.size() / 2;
+    shared.lock.lock();
+    std::vector<char*>& spilled = shared.get(stacksize);
+    spilled.insert(spilled.end(), stacks.begin(), stacks.begin() + n);
+    shared.lock.unlock();
+    stacks.erase(stacks.begin(), stacks.begin() + n);
+  }
+  fl.lock.unlock();
+}
+
+
+size_t fiber_stack_pool::peak_usage(size_t stacksize) const {
+  stacksize = round_stacksize(stacksize);
+  size_t ret = 0;
+  peak_lock.lock();
+  for (size_t i = 0; i < peaks.size(); ++i) {
+    if (peaks[i].first == stacksize) ret = peaks[i].second;
+  }
+  peak_lock.unlock();
+  return ret;
+}
+
+
+void fiber_stack_pool::new_slab(size_t stacksize, std::vector<char*>& stacks) {
+  const size_t bytes = (stacksize + SLAB_SIZE - 1) / SLAB_SIZE * SLAB_SIZE;
+  char* slab = map_slab(bytes);
+  slabs.push_back(std::make_pair(slab, bytes));
+  mapped.inc(bytes);
+  const size_t n = bytes / stacksize;
+  created.inc(n);
+  if (track_usage) paint(slab, slab + n * stacksize);
+  // the lowest stacks are handed out first
+  for (size_t i = n; i > 0; --i) stacks.push_back(slab + (i - 1) * stacksize);
+}
+
+
+char* fiber_stack_pool::map_slab(size_t bytes) {
+  void* ret = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (use_hugepages) {
+    // fails unless huge pages were reserved
+    ret = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+#endif
+  if (ret != MAP_FAILED) return reinterpret_cast<char*>(ret);
+  // transparent huge pages only back aligned ranges, so over-map and
+  // trim to a slab aligned range
+  const size_t extra = use_hugepages ? SLAB_SIZE : 0;
+  ret = mmap(NULL, bytes + extra, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ret == MAP_FAILED) {
+    logstream(LOG_FATAL) << "Unable to map " << bytes << " bytes of fiber "
+                         << "stacks: " << strerror(errno) << std::endl;
+  }
+  char* slab = reinterpret_cast<char*>(ret);
+  if (extra > 0) {
+    char* aligned = reinterpret_cast<char*>(
+        (reinterpret_cast<size_t>(slab) + SLAB_SIZE - 1) / SLAB_SIZE * SLAB_SIZE);
+    if (aligned > slab) munmap(slab, aligned - slab);
+    if (aligned + bytes < slab + bytes + extra) {
+      munmap(aligned + bytes, slab + bytes + extra - (aligned + bytes));
+    }
+    slab = aligned;
+#ifdef MADV_HUGEPAGE
+    madvise(slab, bytes, MADV_HUGEPAGE);
+#endif
+  }
+  return slab;
+}
+
+
+void fiber_stack_pool::paint(char* begin, char* end) {
+  size_t* b = reinterpret_cast<size_t*>(begin);
+  size_t* e = reinterpret_cast<size_t*>(end);
+  std::fill(b, e, STACK_PAINT);
+}
+
+
+size_t fiber_stack_pool::measure(char* stack, size_t stacksize) {
+  // scan up from the bottom for the deepest word the fiber wrote
+  const size_t* b = reinterpret_cast<const size_t*>(stack);
+  const size_t* e = reinterpret_cast<const size_t*>(stack + stacksize);
+  while (b < e && *b == STACK_PAINT) ++b;
+  return reinterpret_cast<const char*>(e) - reinterpret_cast<const char*>(b);
+}
+
+} // namespace graphlab
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_FIBER_STACK_POOL_HPP
+#define GRAPHLAB_FIBER_STACK_POOL_HPP
+
+#include <vector>
+#include <utility>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+
+namespace graphlab {
+
+/**
+ * \internal
+ * A pool of fiber stacks used by fiber_control in place of a malloc and
+ * free per fiber.
+ *
+ * Stacks are carved out of large mmapped slabs and kept on per-worker
+ * free lists, one list per stack size. A stack is taken from the list of
+ * the worker the fiber is placed on and returned to the list of the
+ * worker it terminates on. A worker list which grows beyond
+ * max_local_stacks() spills half of its stacks to a shared list, from
+ * which empty worker lists refill before a new slab is mapped. Slabs
+ * are only unmapped when the pool is destroyed, so the pool holds the
+ * peak number of concurrently live stacks.
+ *
+ * Stacks are not separated by guard pages: a fiber overflowing its stack
+ * corrupts the stack below it, exactly as with malloced stacks.
+ *
+ * Optionally the slabs are backed by huge pages, and the stacks are
+ * painted with a pattern which is scanned when a stack is returned to
+ * find how deep the fiber went. peak_usage() reports the deepest use
+ * seen for each stack size, which helps choosing the stack size.
+ */
+class fiber_stack_pool {
+ public:
+  /// The size of the slabs stacks are carved from
+  static const size_t SLAB_SIZE = 2 * 1024 * 1024;
+
+  /**
+   * Creates a pool with npools worker free lists.
+   * \param use_hugepages Back the slabs by huge pages. Uses reserved huge
+   *                      pages if available, and transparent huge pages
+   *                      otherwise.
+   * \param track_usage   Paint the stacks to measure peak_usage().
+   */
+  fiber_stack_pool(size_t npools, bool use_hugepages, bool track_usage);
+
+  /// Unmaps all slabs. All stacks must have been returned.
+  ~fiber_stack_pool();
+
+  /**
+   * Returns a stack of at least stacksize bytes from the free list of the
+   * given worker. stacksize is rounded up to a whole number of pages.
+   * The stack spans [stack, stack + stacksize).
+   */
+  void* allocate(size_t pool, size_t& stacksize);
+
+  /**
+   * Returns a stack obtained from allocate() to the free list of the
+   * given worker. stacksize is the size allocate() returned.
+   */
+  void deallocate(size_t pool, void* stack, size_t stacksize);
+
+  /**
+   * The deepest use in bytes of any returned stack of the given size,
+   * rounded as by allocate(). 0 if not tracked.
+   */
+  size_t peak_usage(size_t stacksize) const;
+
+  /// True if the stacks are painted to track peak_usage()
+  bool tracking_usage() const { return track_usage; }
+
+  /// The number of calls to allocate()
+  size_t num_allocated() const { return allocated.value; }
+
+  /// The number of stacks carved from slabs
+  size_t num_created() const { return created.value; }
+
+  /// The number of bytes mapped for slabs
+  size_t bytes_mapped() const { return mapped.value; }
+
+  /// Rounds a stack size up to a whole number of pages
+  static size_t round_stacksize(size_t stacksize);
+
+  /// The number of stacks a worker list holds before spilling
+  static size_t max_local_stacks() { return 256; }
+
+ private:
+  struct size_class {
+    size_t stacksize;
+    std::vector<char*> stacks;
+    explicit size_class(size_t stacksize = 0) : stacksize(stacksize) { }
+  };
+
+  struct free_list {
+    simple_spinlock lock;
+    std::vector<size_class> classes;
+    char pad[64];
+    /// the stacks of the given size, creating the size class if missing
+    std::vector<char*>& get(size_t stacksize);
+  };
+
+  std::vector<free_list> pools;
+  /// stacks spilled by the worker lists. Also guards slabs.
+  free_list shared;
+  std::vector<std::pair<char*, size_t> > slabs;
+
+  bool use_hugepages;
+  bool track_usage;
+  /// the peak usage of each stack size. Guarded by peak_lock.
+  std::vector<std::pair<size_t, size_t> > peaks;
+  simple_spinlock peak_lock;
+  atomic<size_t> allocated;
+  atomic<size_t> created;
+  atomic<size_t> mapped;
+
+  /// Maps a slab and carves it into stacks of stacksize bytes
+  void new_slab(size_t stacksize, std::vector<char*>& stacks);
+  char* map_slab(size_t bytes);
+  void paint(char* begin, char* end);
+  /// Returns the number of bytes used at the top of the stack
+  size_t measure(char* stack, size_t stacksize);
+
+  // not copyable
+  fiber_stack_pool(const fiber_stack_pool&);
+  fiber_stack_pool& operator=(const fiber_stack_pool&);
+};
+
+} // namespace graphlab
+
+#endif
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <cstdlib>
+#include <vector>
+#include <pthread.h>
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+#include <graphlab/rpc/archive_buffer_pool.hpp>
+#include <graphlab/rpc/dc_compile_parameters.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/util/memory_info.hpp>
+#include <graphlab/logger/logger.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+namespace {
+
+// The pooled buffer sizes: the send buffers and the receive buffers
+const size_t NUM_SIZE_CLASSES = 2;
+const size_t SIZE_CLASS[NUM_SIZE_CLASSES] = {INITIAL_BUFFER_SIZE,
+                                              RECEIVE_BUFFER_SIZE};
+// Buffers which were realloc'ed past this multiple of the largest class
+// are freed rather than held on to.
+const size_t MAX_POOLED_GROWTH = 4;
+// Buffers cached per thread and per class
+const size_t LOCAL_CACHE_SIZE = 16;
+// Buffers held in the shared depot per class
+const size_t DEPOT_SIZE = 256;
+// The buffers held by the pool are accounted to memory_info::RPC_BUFFERS.
+// Buffers in use are not accounted.
+
+const char* SITE_NAME[NUM_ARCHIVE_BUFFER_SITES] = {
+  "send buffer", "split call", "broadcast", "receive"
+};
+
+inline size_t usable_size(char* buf) {
+#ifdef __APPLE__
+  return malloc_size(buf);
+#else
+  return malloc_usable_size(buf);
+#endif
+}
+
+struct depot_type {
+  simple_spinlock lock;
+  std::vector<char*> buffers;
+};
+depot_type depot[NUM_SIZE_CLASSES];
+
+struct local_cache {
+  std::vector<char*> buffers[NUM_SIZE_CLASSES];
+};
+
+atomic<size_t> reused[NUM_ARCHIVE_BUFFER_SITES];
+atomic<size_t> allocated[NUM_ARCHIVE_BUFFER_SITES];
+
+pthread_key_t local_cache_key;
+pthread_once_t local_cache_key_once = PTHREAD_ONCE_INIT;
+
+// on thread exit, hand the cached buffers to the depot
+void release_local_cache(void* ptr) {
+  local_cache* cache = reinterpret_cast<local_cache*>(ptr);
+  for (size_t c = 0; c < NUM_SIZE_CLASSES; ++c) {
+    for (size_t i = 0; i < cache->buffers[c].size(); ++i) {
+      char* buf = cache->buffers[c][i];
+      depot[c].lock.lock();
+      if (depot[c].buffers.size() < DEPOT_SIZE) {
+        depot[c].buffers.push_back(buf);
+        buf = NULL;
+      }
+      depot[c].lock.unlock();
+      if (buf) {
+        memory_info::track_free(memory_info::RPC_BUFFERS, usable_size(buf));
+        free(buf);
+      }
+    }
+  }
+  delete cache;
+}
+
+void create_local_cache_key() {
+  pthread_key_create(&local_cache_key, release_local_cache);
+}
+
+local_cache& get_local_cache() {
+  pthread_once(&local_cache_key_once, create_local_cache_key);
+  local_cache* cache =
+      reinterpret_cast<local_cache*>(pthread_getspecific(local_cache_key));
+  if (cache == NULL) {
+    cache = new local_cache;
+    for (size_t c = 0; c < NUM_SIZE_CLASSES; ++c) {
+      cache->buffers[c].reserve(LOCAL_CACHE_SIZE);
+    }
+    pthread_setspecific(local_cache_key, cache);
+  }
+  return *cache;
+}
+
+} // anonymous namespace
+
+
+char* archive_buffer_acquire(size_t& len, archive_buffer_site site) {
+  size_t c = 0;
+  while (c < NUM_SIZE_CLASSES && SIZE_CLASS[c] < len) ++c;
+  if (c == NUM_SIZE_CLASSES) {
+    allocated[site].inc();
+    return (char*)malloc(len);
+  }
+  len = SIZE_CLASS[c];
+  std::vector<char*>& local = get_local_cache().buffers[c];
+  if (local.empty()) {
+    // refill half of the local cache from the depot
+    depot[c].lock.lock();
+    while (!depot[c].buffers.empty() && local.size() < LOCAL_CACHE_SIZE / 2) {
+      local.push_back(depot[c].buffers.back());
+      depot[c].buffers.pop_back();
+    }
+    depot[c].lock.unlock();
+  }
+  if (local.empty()) {
+    allocated[site].inc();
+    return (char*)malloc(len);
+  }
+  char* buf = local.back();
+  local.pop_back();
+  reused[site].inc();
+  memory_info::track_free(memory_info::RPC_BUFFERS, usable_size(buf));
+  return buf;
+}
+
+
+void archive_buffer_release(char* buf) {
+  if (buf == NULL) return;
+  const size_t size = usable_size(buf);
+  // the largest class the buffer can serve
+  size_t c = NUM_SIZE_CLASSES;
+  while (c > 0 && SIZE_CLASS[c - 1] > size) --c;
+  if (c == 0 || size > MAX_POOLED_GROWTH * SIZE_CLASS[NUM_SIZE_CLASSES - 1]) {
+    free(buf);
+    return;
+  }
+  --c;
+  std::vector<char*>& local = get_local_cache().buffers[c];
+  if (local.size() >= LOCAL_CACHE_SIZE) {
+    // spill half of the local cache to the depot
+    depot[c].lock.lock();
+    while (local.size() > LOCAL_CACHE_SIZE / 2 &&
+           depot[c].buffers.size() < DEPOT_SIZE) {
+      depot[c].buffers.push_back(local.back());
+      local.pop_back();
+    }
+    depot[c].lock.unlock();
+    if (local.size() >= LOCAL_CACHE_SIZE) {
+      free(buf);
+      return;
+    }
+  }
+  local.push_back(buf);
+  memory_info::track_alloc(memory_info::RPC_BUFFERS, size);
+}
+
+
+size_t archive_buffer_reused(archive_buffer_site site) {
+  return reused[site].value;
+}
+
+size_t archive_buffer_allocated(archive_buffer_site site) {
+  return allocated[site].value;
+}
+
+void log_archive_buffer_stats() {
+  for (size_t i = 0; i < NUM_ARCHIVE_BUFFER_SITES; ++i) {
+    logstream(LOG_INFO) << "Archive buffers (" << SITE_NAME[i] << "): "
+                        << reused[i].value << " reused, "
+                        << allocated[i].value << " allocated" << std::endl;
+  }
+}
+
+} // namespace dc_impl
+} // namespace graphlab
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_RPC_ARCHIVE_BUFFER_POOL_HPP
+#define GRAPHLAB_RPC_ARCHIVE_BUFFER_POOL_HPP
+#include <cstddef>
+
+namespace graphlab {
+namespace dc_impl {
+
+/**
+ * \internal
+ * The places in the RPC layer which allocate message buffers. Used to
+ * attribute the pool statistics.
+ */
+enum archive_buffer_site {
+  SEND_BUFFER_SITE = 0,   ///< thread local send buffers (all calls)
+  SPLIT_CALL_SITE,        ///< split calls (buffered exchanges)
+  BROADCAST_SITE,         ///< temporary broadcast archives
+  RECEIVE_SITE,           ///< socket receive buffers
+  NUM_ARCHIVE_BUFFER_SITES
+};
+
+/**
+ * \internal
+ * Returns a malloc'ed buffer of at least len bytes, reusing a released
+ * buffer if one is available. On return len is the usable length of the
+ * buffer. The buffer may be realloc'ed, and must eventually be passed to
+ * archive_buffer_release() (or free()).
+ *
+ * Buffers are kept in a small per thread cache backed by a shared depot,
+ * since buffers are usually released by a different thread (the sender
+ * or the function call handlers) than the one which acquired them.
+ */
+char* archive_buffer_acquire(size_t& len, archive_buffer_site site);
+
+/**
+ * \internal
+ * Returns a malloc'ed buffer to the pool. Buffers which are not of a
+ * pooled size are freed.
+ */
+void archive_buffer_release(char* buf);
+
+/**
+ * \internal
+ * Number of acquires served from the pool (allocations avoided) and
+ * served by malloc at a given site.
+ */
+size_t archive_buffer_reused(archive_buffer_site site);
+size_t archive_buffer_allocated(archive_buffer_site site);
+
+/**
+ * \internal
+ * Logs the pool statistics of every site.
+ */
+void log_archive_buffer_stats();
+
+} // namespace dc_impl
+} // namespace graphlab
+#endif
@@ -29,6 +29,8 @@
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
 #include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/util/inplace_lf_queue2.hpp>
+#include <graphlab/util/region_allocator.hpp>
 
 
 #include <graphlab/macros_def.hpp>
@@ -48,7 +50,7 @@ namespace graphlab {
    *    exchange.partial_flush([thread id]);
    *  }
    *
-   *  .. now in 1 thread ..
+   *  .. now in 1 thread, once all threads are done sending ..
    *  exchange.flush()
    *
    *  .. In parallel .. {
@@ -74,7 +76,14 @@ namespace graphlab {
     struct buffer_record {
       procid_t proc;
       buffer_type buffer;
-      buffer_record() : proc(-1)  { }
+      // the serialized values, if keep_serialized is set
+      char* data;
+      size_t len;
+      size_t numel;
+      bool compact;
+      buffer_record* next;
+      buffer_record() : proc(-1), data(NULL), len(0), numel(0),
+                        compact(false), next(NULL)  { }
     }; // end of buffer record
 
 
@@ -82,8 +91,17 @@ namespace graphlab {
     /** The rpc interface for this class */
     mutable dc_dist_object<buffered_exchange> rpc;
 
-    std::deque< buffer_record > recv_buffers;
-    mutex recv_lock;
+    /**
+     * Received buffers. The rpc handlers enqueue without locking. Only
+     * one receiver at a time (holding recv_lock) takes them off the queue
+     * and into recv_pending.
+     */
+    inplace_lf_queue2<buffer_record> recv_queue;
+    buffer_record* recv_pending;
+    mutable mutex recv_lock;
+    atomic<size_t> num_recv_values;
+    /// Holds the received buffers if keep_serialized is set
+    region_allocator recv_region;
 
 
     struct send_record {
@@ -91,10 +109,20 @@ namespace graphlab {
       size_t numinserts;
     };
 
+    /**
+     * The send buffers of each thread id, one per target. The first thread
+     * to send with a thread id owns its buffers until the next flush(),
+     * and uses them without locking. Any other thread sending with the
+     * same thread id falls back to the locked shared_buffers.
+     */
     std::vector<send_record> send_buffers;
-    std::vector< mutex >  send_locks;
+    std::vector<void*> lane_owner;
+    std::vector<send_record> shared_buffers;
+    std::vector< mutex >  shared_locks;
     const size_t num_threads;
     const size_t max_buffer_size;
+    const bool compact;
+    const bool keep_serialized;
 
 
     // typedef boost::function<void (const T& tref)> handler_type;
@@ -106,27 +134,51 @@ namespace graphlab {
      *
      * \ref dc The master distributed_control object
      * \ref num_threads The number of threads to support. This is essentially
-     *                  the number of fine-grained locks to use. This does not
+     *                  the number of thread owned send buffers. This does not
      *                  need to match the total number of threads used during 
      *                  the exchange process, but there are performance / contention
      *                  advantages if this matches.
      * \ref max_buffer_size The size of the per thread and per target send buffer.
+     * \ref compact If true, integers in the exchanged values are sent as
+     *               variable length integers (see graphlab::oarchive).
+     *               This is recorded in every buffer, so the receivers
+     *               need not be constructed with the same setting.
+     * \ref keep_serialized If true, received buffers are kept serialized
+     *               in a graphlab::region_allocator until recv()
+     *               deserializes them. Pending data then takes the size of
+     *               the messages (much less than the values when compact),
+     *               and is returned to the system as it is received.
+     *               Useful when the data is only received after all of
+     *               it has been sent, as in graph ingress.
      */
     buffered_exchange(distributed_control& dc,
                       const size_t num_threads = 1,
-                      const size_t max_buffer_size = DEFAULT_BUFFERED_EXCHANGE_SIZE) :
+                      const size_t max_buffer_size = DEFAULT_BUFFERED_EXCHANGE_SIZE,
+                      const bool compact = false,
+                      const bool keep_serialized = false) :
       rpc(dc, this),
+      recv_pending(NULL),
+      recv_region(region_allocator::DEFAULT_CHUNK_SIZE,
+                  memory_info::RPC_BUFFERS),
       send_buffers(num_threads *  dc.numprocs()),
-      send_locks(num_threads *  dc.numprocs()),
+      lane_owner(num_threads, NULL),
+      shared_buffers(dc.numprocs()),
+      shared_locks(dc.numprocs()),
       num_threads(num_threads),
-      max_buffer_size(max_buffer_size) {
+      max_buffer_size(max_buffer_size),
+      compact(compact),
+      keep_serialized(keep_serialized) {
        //
        for (size_t i = 0;i < send_buffers.size(); ++i) {
          // initialize the split call
          send_buffers[i].oarc = rpc.split_call_begin(&buffered_exchange::rpc_recv);
          send_buffers[i].numinserts = 0;
-         // begin by writing the src proc.
-         (*(send_buffers[i].oarc)) << rpc.procid();
+         write_header(*(send_buffers[i].oarc));
+       }
+       for (size_t i = 0;i < shared_buffers.size(); ++i) {
+         shared_buffers[i].oarc = rpc.split_call_begin(&buffered_exchange::rpc_recv);
+         shared_buffers[i].numinserts = 0;
+         write_header(*(shared_buffers[i].oarc));
        }
        rpc.barrier();
       }
@@ -137,6 +189,16 @@ namespace graphlab {
       for (size_t i = 0;i < send_buffers.size(); ++i) {
         rpc.split_call_cancel(send_buffers[i].oarc);
       }
+      for (size_t i = 0;i < shared_buffers.size(); ++i) {
+        rpc.split_call_cancel(shared_buffers[i].oarc);
+      }
+      // clear the unreceived buffers
+      take_received();
+      while(recv_pending != NULL) {
+        buffer_record* rec = recv_pending;
+        recv_pending = rec->next;
+        delete rec;
+      }
     }
     // buffered_exchange(distributed_control& dc, handler_type recv_handler,
     //                   size_t buffer_size = 1000) :
@@ -151,57 +213,97 @@ namespace graphlab {
     void send(const procid_t proc, const T& value, const size_t thread_id = 0) {
       ASSERT_LT(proc, rpc.numprocs());
       ASSERT_LT(thread_id, num_threads);
-      const size_t index = thread_id * rpc.numprocs() + proc;
-      ASSERT_LT(index, send_locks.size());
-      send_locks[index].lock();
-
-      (*(send_buffers[index].oarc)) << value;
-      ++send_buffers[index].numinserts;
-
-      if(send_buffers[index].oarc->off >= max_buffer_size) {
-        oarchive* prevarc = swap_buffer(index);
-        send_locks[index].unlock();
-        // complete the send
-        rpc.split_call_end(proc, prevarc);
+      if (owns_lane(thread_id)) {
+        const size_t index = thread_id * rpc.numprocs() + proc;
+        send_record& rec = send_buffers[index];
+        (*(rec.oarc)) << value;
+        ++rec.numinserts;
+        if(rec.oarc->off >= max_buffer_size) {
+          // complete the send
+          rpc.split_call_end(proc, swap_buffer(rec));
+        }
       } else {
-        send_locks[index].unlock();
+        shared_locks[proc].lock();
+        send_record& rec = shared_buffers[proc];
+        (*(rec.oarc)) << value;
+        ++rec.numinserts;
+        if(rec.oarc->off >= max_buffer_size) {
+          oarchive* prevarc = swap_buffer(rec);
+          shared_locks[proc].unlock();
+          // complete the send
+          rpc.split_call_end(proc, prevarc);
+        } else {
+          shared_locks[proc].unlock();
+        }
       }
     } // end of send
 
     /**
-     * Flushes the send buffer owned owned by thread_id.
+     * Flushes the send buffers the calling thread used with thread_id,
+     * and the shared send buffers.
+     *
+     * \note The send buffers of thread_id are only flushed if the calling
+     * thread owns them, that is if it is the first thread which sent with
+     * thread_id since the last flush(). The owner uses them without
+     * locking, so another thread cannot flush them safely: they are left
+     * to the owner's own partial_flush() or to flush(). Each sending
+     * thread should therefore call partial_flush() with its own
+     * thread_id.
      */
     void partial_flush(size_t thread_id) {
+      ASSERT_LT(thread_id, num_threads);
+      const bool owner = (get_lane_owner(thread_id) == &thread::get_tls_data());
       for(procid_t proc = 0; proc < rpc.numprocs(); ++proc) {
-        const size_t index = thread_id * rpc.numprocs() + proc;
-        ASSERT_LT(proc, rpc.numprocs());
-        if (send_buffers[index].numinserts > 0) {
-          send_locks[index].lock();
-          oarchive* prevarc = swap_buffer(index);
-          send_locks[index].unlock();
-          // complete the send
-          rpc.split_call_end(proc, prevarc);
-          rpc.dc().flush_soon(proc);
+        if (owner) {
+          send_record& rec = send_buffers[thread_id * rpc.numprocs() + proc];
+          if (rec.numinserts > 0) {
+            rpc.split_call_end(proc, swap_buffer(rec));
+            rpc.dc().flush_soon(proc);
+          }
+        }
+        if (shared_buffers[proc].numinserts > 0) {
+          shared_locks[proc].lock();
+          oarchive* prevarc = NULL;
+          if (shared_buffers[proc].numinserts > 0) {
+            prevarc = swap_buffer(shared_buffers[proc]);
+          }
+          shared_locks[proc].unlock();
+          if (prevarc) {
+            rpc.split_call_end(proc, prevarc);
+            rpc.dc().flush_soon(proc);
+          }
         }
       }
     }
 
     /**
-     * Flushes all send buffers. Must be called only on one thread.
-     * Will not return until all machines call flush.
+     * Flushes all send buffers. Releases the ownership of the thread send
+     * buffers. Will not return until all machines call flush.
+     *
+     * \warning Must be called only on one thread, when no other thread is
+     * sending or flushing: the thread send buffers are used without
+     * locking, so a concurrent send() may lose values or corrupt the
+     * buffer being flushed. Synchronize the senders (for instance with a
+     * barrier) before calling flush().
      */
     void flush() {
       for(size_t i = 0; i < send_buffers.size(); ++i) {
         const procid_t proc = i % rpc.numprocs();
         ASSERT_LT(proc, rpc.numprocs());
-        send_locks[i].lock();
         if (send_buffers[i].numinserts > 0) {
-          oarchive* prevarc = swap_buffer(i);
           // complete the send
-          rpc.split_call_end(proc, prevarc);
+          rpc.split_call_end(proc, swap_buffer(send_buffers[i]));
         }
-        send_locks[i].unlock();
       }
+      for(procid_t proc = 0; proc < rpc.numprocs(); ++proc) {
+        shared_locks[proc].lock();
+        if (shared_buffers[proc].numinserts > 0) {
+          rpc.split_call_end(proc, swap_buffer(shared_buffers[proc]));
+        }
+        shared_locks[proc].unlock();
+      }
+      for (size_t i = 0; i < lane_owner.size(); ++i) lane_owner[i] = NULL;
+      __sync_synchronize();
       rpc.dc().flush_soon();
       rpc.full_barrier();
     } // end of flush
@@ -224,30 +326,36 @@ namespace graphlab {
     bool recv(procid_t& ret_proc, buffer_type& ret_buffer,
               const bool try_lock = false) {
       fiber_control::fast_yield();
-      dc_impl::blob read_buffer;
       bool has_lock = false;
       if(try_lock) {
-        if (recv_buffers.empty()) return false;
+        // the count of pending values is read without the lock
+        if (size() == 0) return false;
         has_lock = recv_lock.try_lock();
       } else {
         recv_lock.lock();
         has_lock = true;
       }
-      bool success = false;
+      buffer_record* rec = NULL;
       if(has_lock) {
-        if(!recv_buffers.empty()) {
-          success = true;
-          buffer_record& rec =  recv_buffers.front();
-          // read the record
-          ret_proc = rec.proc;
-          ret_buffer.swap(rec.buffer);
-          ASSERT_LT(ret_proc, rpc.numprocs());
-          recv_buffers.pop_front();
-        }
+        if (recv_pending == NULL) take_received();
+        rec = recv_pending;
+        if (rec != NULL) recv_pending = rec->next;
         recv_lock.unlock();
       }
-
-      return success;
+      if (rec == NULL) return false;
+      // read the record
+      ret_proc = rec->proc;
+      if (rec->data != NULL) {
+        deserialize_values(rec->data, rec->len, rec->compact, rec->numel,
+                           ret_buffer);
+        recv_region.deallocate(rec->data);
+      } else {
+        ret_buffer.swap(rec->buffer);
+      }
+      ASSERT_LT(ret_proc, rpc.numprocs());
+      num_recv_values.dec(ret_buffer.size());
+      delete rec;
+      return true;
     } // end of recv
 
 
@@ -256,31 +364,29 @@ namespace graphlab {
      * Returns the number of elements available for receiving.
      */
     size_t size() const {
-      typedef typename std::deque< buffer_record >::const_iterator iterator;
-      recv_lock.lock();
-      size_t count = 0;
-      foreach(const buffer_record& rec, recv_buffers) {
-        count += rec.buffer.size();
-      }
-      recv_lock.unlock();
-      return count;
+      return num_recv_values.value;
     } // end of size
 
     /**
      * Returns true if there are no elements available for receiving.
      */
-    bool empty() const { return recv_buffers.empty(); }
+    bool empty() const {
+      recv_lock.lock();
+      const bool ret = (recv_pending == NULL && recv_queue.empty());
+      recv_lock.unlock();
+      return ret;
+    }
 
     void clear() { }
 
     void barrier() { rpc.barrier(); }
   private:
     void rpc_recv(size_t len, wild_pointer w) {
-      buffer_type tmp;
       iarchive iarc(reinterpret_cast<const char*>(w.ptr), len);
-      // first desrialize the source process
+      // first desrialize the source process and the encoding
       procid_t src_proc; iarc >> src_proc;
       ASSERT_LT(src_proc, rpc.numprocs());
+      iarc >> iarc.compact;
       // create an iarchive which just points to the last size_t bytes
       // to get the number of elements
       iarchive numel_iarc(reinterpret_cast<const char*>(w.ptr) + len - sizeof(size_t),
@@ -288,35 +394,103 @@ namespace graphlab {
       size_t numel = 0; 
       numel_iarc.read(reinterpret_cast<char*>(&numel), sizeof(size_t));
       //std::cout << "Receiving: " << numel << "\n";
-      tmp.resize(numel);
-      for (size_t i = 0;i < numel; ++i) {
-        iarc >> tmp[i];
+      const char* values = iarc.buf + iarc.off;
+      const size_t values_len = len - iarc.off - sizeof(size_t);
+
+      buffer_record* rec = new buffer_record;
+      rec->proc = src_proc;
+      if (keep_serialized) {
+        rec->data = reinterpret_cast<char*>(recv_region.allocate(values_len));
+        memcpy(rec->data, values, values_len);
+        rec->len = values_len;
+        rec->numel = numel;
+        rec->compact = iarc.compact;
+      } else {
+        deserialize_values(values, values_len, iarc.compact, numel, rec->buffer);
       }
-
-      recv_lock.lock();
-      recv_buffers.push_back(buffer_record());
-      buffer_record& rec = recv_buffers.back();
-      rec.proc = src_proc;
-      rec.buffer.swap(tmp);
-      recv_lock.unlock();
+      num_recv_values.inc(numel);
+      recv_queue.enqueue(rec);
     } // end of rpc rcv
 
 
-    // create a new buffer for send_buffer[index], returning the old buffer
-    oarchive* swap_buffer(size_t index) {
+    // read numel values serialized in values into ret
+    static void deserialize_values(const char* values, size_t len,
+                                   bool compact, size_t numel,
+                                   buffer_type& ret) {
+      ret.resize(numel);
+      if (numel == 0) return;
+      // copied in bulk if the values were written as raw bytes
+      iarchive iarc(values, len);
+      iarc.compact = compact;
+      archive_detail::deserialize_sequence<iarchive, T>::
+          exec(iarc, &(ret[0]), numel);
+    }
+
+    /**
+     * Moves everything in the receive queue to the end of recv_pending.
+     * Must be called with recv_lock held.
+     */
+    void take_received() {
+      buffer_record* head = recv_queue.dequeue_all();
+      if (head == NULL) return;
+      // find the end of the list, waiting for the enqueues in flight to
+      // connect their next pointers
+      buffer_record* cur = head;
+      while(true) {
+        volatile buffer_record** n = (volatile buffer_record**)(&cur->next);
+        while(__unlikely__((*n) == NULL)) {
+          asm volatile("pause\n": : :"memory");
+        }
+        buffer_record* next = (buffer_record*)(*n);
+        if (recv_queue.end_of_dequeue_list(next)) break;
+        cur = next;
+      }
+      cur->next = NULL;
+      if (recv_pending == NULL) {
+        recv_pending = head;
+      } else {
+        buffer_record* tail = recv_pending;
+        while(tail->next != NULL) tail = tail->next;
+        tail->next = head;
+      }
+    }
+
+    /**
+     * True if the calling thread owns the send buffers of thread_id,
+     * claiming them if no thread does.
+     */
+    bool owns_lane(size_t thread_id) {
+      void* me = &thread::get_tls_data();
+      void* owner = get_lane_owner(thread_id);
+      if (owner == me) return true;
+      return owner == NULL &&
+          atomic_compare_and_swap(lane_owner[thread_id], (void*)NULL, me);
+    }
+
+    void* get_lane_owner(size_t thread_id) const {
+      return *reinterpret_cast<void* const volatile*>(&lane_owner[thread_id]);
+    }
+
+    // create a new buffer for a send record, returning the old buffer
+    oarchive* swap_buffer(send_record& rec) {
       oarchive* swaparc = rpc.split_call_begin(&buffered_exchange::rpc_recv);
-      std::swap(send_buffers[index].oarc, swaparc);
+      std::swap(rec.oarc, swaparc);
       // write the length at the end of the buffere are returning
-      (*swaparc).write(reinterpret_cast<char*>(&send_buffers[index].numinserts), sizeof(size_t));
+      (*swaparc).write(reinterpret_cast<char*>(&rec.numinserts), sizeof(size_t));
 
-      //std::cout << "Sending : " << (send_buffers[index].numinserts)<< "\n";
+      //std::cout << "Sending : " << (rec.numinserts)<< "\n";
       // reset the insertion count
-      send_buffers[index].numinserts = 0;
-      // write the current procid into the new buffer
-      (*(send_buffers[index].oarc)) << rpc.procid();
+      rec.numinserts = 0;
+      write_header(*(rec.oarc));
       return swaparc;
     }
 
+    // begin a buffer by writing the src proc and the encoding of the values
+    void write_header(oarchive& oarc) {
+      oarc << rpc.procid() << compact;
+      oarc.compact = compact;
+    }
+
 
   }; // end of buffered exchange
 
@@ -25,6 +25,7 @@
 #define GRAPHLAB_RPC_CIRCULAR_IOVEC_BUFFER_HPP
 #include <vector>
 #include <sys/socket.h>
+#include <graphlab/rpc/archive_buffer_pool.hpp>
 
 namespace graphlab{
 namespace dc_impl {
@@ -125,7 +126,7 @@ struct circular_iovec_buffer {
    * Erases a single iovec from the head and free the pointer
    */
   inline void erase_from_head_and_free() {
-    free(v[head].iov_base);
+    archive_buffer_release((char*)v[head].iov_base);
     head = (head + 1) & (v.size() - 1);
     --numel;
   }
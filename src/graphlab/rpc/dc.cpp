@@ -47,6 +47,7 @@
 #include <graphlab/rpc/dc_stream_receive.hpp>
 #include <graphlab/rpc/request_reply_handler.hpp>
 #include <graphlab/rpc/dc_services.hpp>
+#include <graphlab/rpc/archive_buffer_pool.hpp>
 
 #include <graphlab/rpc/dc_init_from_env.hpp>
 #include <graphlab/rpc/dc_init_from_mpi.hpp>
@@ -200,6 +201,7 @@ distributed_control::~distributed_control() {
   logstream(LOG_INFO) << "Network Sent: " << network_bytes_sent() << std::endl;
   logstream(LOG_INFO) << "Bytes Received: " << bytesreceived << std::endl;
   logstream(LOG_INFO) << "Calls Received: " << calls_received() << std::endl;
+  dc_impl::log_archive_buffer_stats();
 
   delete comm;
 
@@ -294,7 +296,7 @@ void distributed_control::process_fcall_block(fcallqueue_entry &fcallblock) {
     if (fcallblock.chunk_ref_counter != NULL) {
       if (fcallblock.chunk_ref_counter->dec(fcallblock.calls.size()) == 0) {
         delete fcallblock.chunk_ref_counter;
-        free(fcallblock.chunk_src);
+        dc_impl::archive_buffer_release(fcallblock.chunk_src);
       }
     }
   }
@@ -321,7 +323,7 @@ void distributed_control::process_fcall_block(fcallqueue_entry &fcallblock) {
       data += sizeof(dc_impl::packet_hdr) + hdr.len;
       remaininglen -= sizeof(dc_impl::packet_hdr) + hdr.len;
     }
-    free(fcallblock.chunk_src);
+    dc_impl::archive_buffer_release(fcallblock.chunk_src);
   }
 #else
   else {
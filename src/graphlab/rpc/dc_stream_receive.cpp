@@ -65,7 +65,7 @@ char* dc_stream_receive::advance_buffer(char* c, size_t wrotelength,
       if (offset + sizeof(packet_hdr) <= write_buffer_written) incomplete_message_len = hdr->len;
 
       size_t new_buflen = std::max<size_t>(sizeof(packet_hdr) + incomplete_message_len, RECEIVE_BUFFER_SIZE);
-      char* new_writebuffer = (char*)malloc(new_buflen);
+      char* new_writebuffer = archive_buffer_acquire(new_buflen, RECEIVE_SITE);
 
       if (write_buffer_len - offset > 0) {
         // copy over to the new buffer everything we will not use
@@ -29,6 +29,7 @@
 #include <graphlab/rpc/dc_types.hpp>
 #include <graphlab/rpc/dc_compile_parameters.hpp>
 #include <graphlab/rpc/dc_receive.hpp>
+#include <graphlab/rpc/archive_buffer_pool.hpp>
 #include <graphlab/parallel/atomic.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/logger/logger.hpp>
@@ -53,8 +54,8 @@ class dc_stream_receive: public dc_receive{
   dc_stream_receive(distributed_control* dc, procid_t associated_proc): 
                   writebuffer(NULL), write_buffer_written(0), dc(dc), 
                   associated_proc(associated_proc) { 
-    writebuffer = (char*)malloc(RECEIVE_BUFFER_SIZE);
     write_buffer_len = RECEIVE_BUFFER_SIZE;
+    writebuffer = archive_buffer_acquire(write_buffer_len, RECEIVE_SITE);
   }
 
  private:
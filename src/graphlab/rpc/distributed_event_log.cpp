@@ -32,6 +32,7 @@
 #include <graphlab/util/timer.hpp>
 #include <graphlab/logger/assertions.hpp>
 #include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/memory_info.hpp>
 #include <graphlab/ui/metrics_server.hpp>
 #include <graphlab/macros_def.hpp>
 #define DISABLE_DISTRIBUTED_EVENT_LOG
@@ -48,6 +49,15 @@ metric_aggregate_json(std::map<std::string, std::string>& vars);
 static std::pair<std::string, std::string> 
 metric_by_machine_json(std::map<std::string, std::string>& vars);
 
+static std::pair<std::string, std::string> 
+metric_memory_json(std::map<std::string, std::string>& vars);
+
+
+static double category_megabytes(size_t category) {
+  return double(memory_info::category_bytes(
+      memory_info::memory_category(category))) / (1024 * 1024);
+}
+
 
 static size_t time_to_index(double t) {
   return std::floor(t / 5);
@@ -339,6 +349,9 @@ void distributed_event_logger::set_dc(distributed_control& dc) {
     add_metric_server_callback("names.json", metric_names_json);
     add_metric_server_callback("metrics_aggregate.json", metric_aggregate_json);
     add_metric_server_callback("metrics_by_machine.json", metric_by_machine_json);
+
+    // the memory categories are gathered from every machine on request
+    add_metric_server_callback("memory.json", metric_memory_json);
   }
 }
     
@@ -794,5 +807,76 @@ static metric_by_machine_json(std::map<std::string, std::string>& vars) {
 
 
 
+std::vector<double> distributed_event_logger::local_memory_megabytes() {
+  std::vector<double> ret(memory_info::NUM_MEMORY_CATEGORIES);
+  for (size_t i = 0; i < ret.size(); ++i) ret[i] = category_megabytes(i);
+  return ret;
+}
+
+std::vector<std::vector<double> >
+distributed_event_logger::gather_memory_megabytes() {
+  if (rmi == NULL) {
+    return std::vector<std::vector<double> >(1, local_memory_megabytes());
+  }
+  std::vector<std::vector<double> > ret(rmi->numprocs());
+  for (procid_t p = 0; p < rmi->numprocs(); ++p) {
+    if (p == rmi->procid()) {
+      ret[p] = local_memory_megabytes();
+    } else {
+      ret[p] = rmi->remote_request(
+          p, &distributed_event_logger::local_memory_megabytes);
+    }
+  }
+  return ret;
+}
+
+std::string distributed_event_logger::memory_json() {
+  const std::vector<std::vector<double> > by_machine =
+      gather_memory_megabytes();
+  const std::vector<double> local = local_memory_megabytes();
+  std::stringstream strm;
+  strm << "{\n"
+       << "  \"time\": " << get_current_time() << ",\n"
+       << "  \"units\": \"MB\",\n"
+       << "  \"categories\": [\n";
+  for (size_t i = 0; i < memory_info::NUM_MEMORY_CATEGORIES; ++i) {
+    double total = 0;
+    for (size_t p = 0; p < by_machine.size(); ++p) total += by_machine[p][i];
+
+    strm << "    {\n"
+         << "      \"name\": \"" 
+         << memory_info::category_name(memory_info::memory_category(i)) 
+         << "\",\n"
+         << "      \"local\": " << local[i] << ",\n"
+         << "      \"total\": " << total << ",\n"
+         << "      \"by_machine\": [";
+    for (size_t p = 0; p < by_machine.size(); ++p) {
+      strm << by_machine[p][i];
+      if (p + 1 < by_machine.size()) strm << ", ";
+    }
+    strm << "]\n"
+         << "    }";
+    if (i + 1 < memory_info::NUM_MEMORY_CATEGORIES) strm << ",";
+    strm << "\n";
+  }
+  strm << "  ]\n"
+       << "}\n";
+  return strm.str();
+}
+
+
+/*
+   Used to process the memory.json request.
+   Reports the memory accounted to each category on this machine, on
+   each machine, and in total. The categories are requested from every
+   machine when the page is served.
+*/
+std::pair<std::string, std::string> 
+static metric_memory_json(std::map<std::string, std::string>& vars) {
+  return std::make_pair(std::string("text/plain"),
+                        get_event_log().memory_json());
+}
+
+
 
 } // namespace graphlab
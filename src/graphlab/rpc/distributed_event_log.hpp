@@ -86,7 +86,7 @@ struct log_group{
 
   boost::function<double(void)> callback;
 
-  size_t sum_of_instantaneous_entries;
+  double sum_of_instantaneous_entries;
   size_t count_of_instantaneous_entries;
 
   bool machine_log_modified;  
@@ -223,6 +223,27 @@ class distributed_event_logger {
      */
     void thr_dec_log_entry(size_t entry, size_t value);
 
+    /**
+     * Returns the megabytes accounted to each memory_info category on
+     * this machine.
+     */
+    std::vector<double> local_memory_megabytes();
+
+    /**
+     * Returns the megabytes accounted to each memory_info category on
+     * every machine, indexed by machine and then by category. Requests
+     * the values from the other machines, so may be called on one
+     * machine only. Returns only this machine before set_dc() is called.
+     */
+    std::vector<std::vector<double> > gather_memory_megabytes();
+
+    /**
+     * Returns the JSON document served as memory.json: the megabytes
+     * accounted to each memory_info category on this machine, on every
+     * machine, and in total. See gather_memory_megabytes().
+     */
+    std::string memory_json();
+
 
     /// \cond GRAPHLAB_INTERNAL
     inline double get_current_time() const {
@@ -64,6 +64,8 @@ namespace graphlab {
    *      for each buffer_record in buffer:
    *        buffer_record.proc is the machine which sent the contents of this record
    *        buffer_record.buffer is an array containing values sent by the machine buffer_record.proc
+   *        (or, if the exchange keeps non-POD values serialized, read
+   *        the values with a value_reader instead)
    *    }
    *  }
    *  
@@ -89,12 +91,66 @@ namespace graphlab {
   public:
     typedef std::vector<T> buffer_type;
 
+    /**
+     * A buffer of values received from one machine.
+     * The values are in buffer. POD values are copied there in bulk,
+     * without deserializing element by element, when the sender wrote
+     * them as raw bytes. If the exchange was constructed with
+     * keep_serialized, non-POD values are instead left serialized in data
+     * and are read with a value_reader, so that the receiver can
+     * deserialize each value directly into its final location.
+     */
     struct buffer_record {
       procid_t proc;
       buffer_type buffer;
-      buffer_record() : proc(-1)  { }
+      size_t numel;
+      bool compact;
+      std::vector<char> data;
+      buffer_record() : proc(-1), numel(0), compact(false)  { }
     }; // end of buffer record
     typedef std::vector<buffer_record> recv_buffer_type;
+
+    /**
+     * Reads the serialized values of a buffer_record of a non-POD type,
+     * received by an exchange which keeps them serialized, in order. Either read() a whole value, or read it member by member
+     * from archive() (for instance the key of a pair first, and then the
+     * value straight into the storage the key selects) and call next().
+     * \code
+     * value_reader reader(rec);
+     * while(!reader.done()) {
+     *   vertex_id_type vid; reader.archive() >> vid;
+     *   reader.archive() >> vertex_data[local_vid(vid)];
+     *   reader.next();
+     * }
+     * \endcode
+     */
+    class value_reader {
+      iarchive iarc;
+      size_t remaining;
+    public:
+      explicit value_reader(const buffer_record& rec) :
+        iarc(rec.data.empty() ? NULL : &(rec.data[0]), rec.data.size()),
+        remaining(rec.numel) {
+        iarc.compact = rec.compact;
+      }
+      /// True once all values have been read
+      bool done() const { return remaining == 0; }
+      /// Number of values left to read
+      size_t size() const { return remaining; }
+      /// Deserializes the next value into t
+      void read(T& t) {
+        ASSERT_GT(remaining, 0);
+        iarc >> t;
+        --remaining;
+      }
+      /// The archive, positioned at the next value
+      iarchive& archive() { return iarc; }
+      /// Marks the value read from archive() as consumed
+      void next() {
+        ASSERT_GT(remaining, 0);
+        --remaining;
+      }
+    }; // end of value_reader
     mutex lock;
   private:
 
@@ -113,6 +169,8 @@ namespace graphlab {
 
     std::vector<std::vector<send_record> > send_buffers;
     const size_t max_buffer_size;
+    const bool compact;
+    const bool keep_serialized;
 
 
     /**
@@ -137,11 +195,20 @@ namespace graphlab {
      *
      * \ref dc The master distributed_control object
      * \ref max_buffer_size The size of the per thread and per target send buffer.
+     * \ref compact If true, integers in the exchanged values are sent as
+     *               variable length integers (see graphlab::oarchive).
+     * \ref keep_serialized If true and T is not a POD type, received
+     *               values are left serialized in buffer_record::data,
+     *               to be read with a value_reader, and
+     *               buffer_record::buffer is empty.
      */
     fiber_buffered_exchange(distributed_control& dc,
-                      const size_t max_buffer_size = DEFAULT_BUFFERED_EXCHANGE_SIZE) :
+                      const size_t max_buffer_size = DEFAULT_BUFFERED_EXCHANGE_SIZE,
+                      const bool compact = false,
+                      const bool keep_serialized = false) :
       rpc(dc, this),
-      max_buffer_size(max_buffer_size) {
+      max_buffer_size(max_buffer_size),
+      compact(compact), keep_serialized(keep_serialized) {
        send_buffers.resize(fiber_control::get_instance().num_workers());
        recv_buffers.resize(fiber_control::get_instance().num_workers());
        for (size_t i = 0;i < send_buffers.size(); ++i) {
@@ -177,8 +244,9 @@ namespace graphlab {
       size_t wid = fiber_control::get_worker_id();
       if (send_buffers[wid][proc].oarc == NULL) {
         send_buffers[wid][proc].oarc = rpc.split_call_begin(&fiber_buffered_exchange::rpc_recv);
-        // write a header
-        (*send_buffers[wid][proc].oarc) << rpc.procid();
+        // write a header: the src proc and the encoding of the values
+        (*send_buffers[wid][proc].oarc) << rpc.procid() << compact;
+        send_buffers[wid][proc].oarc->compact = compact;
         send_buffers[wid][proc].numinserts = 0;
       }
 
@@ -285,10 +353,10 @@ namespace graphlab {
     void barrier() { rpc.barrier(); }
   private:
     void rpc_recv(size_t len, wild_pointer w) {
-      buffer_type tmp;
       iarchive iarc(reinterpret_cast<const char*>(w.ptr), len);
       // first desrialize the source process
       procid_t src_proc; iarc >> src_proc;
+      iarc >> iarc.compact;
 //       logstream(LOG_DEBUG) << rpc.procid() << ": Receiving exchange of length "
 //                            << len << " from " << src_proc << std::endl;
       // create an iarchive which just points to the last size_t bytes
@@ -298,17 +366,32 @@ namespace graphlab {
       size_t numel = 0; 
       numel_iarc.read(reinterpret_cast<char*>(&numel), sizeof(size_t));
       //std::cout << "Receiving: " << numel << "\n";
-      tmp.resize(numel);
-      for (size_t i = 0;i < numel; ++i) {
-        iarc >> tmp[i];
+      buffer_record tmp;
+      tmp.proc = src_proc;
+      tmp.numel = numel;
+      tmp.compact = iarc.compact;
+      const char* values = iarc.buf + iarc.off;
+      const size_t values_len = len - iarc.off - sizeof(size_t);
+      if (keep_serialized && !gl_is_pod<T>::value) {
+        // keep the values serialized. They are read by a value_reader
+        tmp.data.assign(values, values + values_len);
+      } else {
+        tmp.buffer.resize(numel);
+        if (numel > 0) {
+          archive_detail::deserialize_sequence<iarchive, T>::
+              exec(iarc, &(tmp.buffer[0]), numel);
+        }
       }
 
       size_t wid = fiber_control::get_worker_id();
       lock.lock();
       recv_buffers[wid].push_back(buffer_record());
       buffer_record& rec = recv_buffers[wid].back();
-      rec.proc = src_proc;
-      rec.buffer.swap(tmp);
+      rec.proc = tmp.proc;
+      rec.numel = tmp.numel;
+      rec.compact = tmp.compact;
+      rec.buffer.swap(tmp.buffer);
+      rec.data.swap(tmp.data);
       lock.unlock();
     } // end of rpc rcv
 
@@ -29,6 +29,7 @@
 #include <graphlab/rpc/dc_internal_types.hpp>
 #include <graphlab/rpc/dc_send.hpp>
 #include <graphlab/rpc/dc_thread_get_send_buffer.hpp>
+#include <graphlab/rpc/archive_buffer_pool.hpp>
 #include <graphlab/rpc/function_call_dispatch.hpp>
 #include <graphlab/rpc/function_call_issue.hpp>
 #include <graphlab/rpc/is_rpc_call.hpp>
@@ -102,8 +103,8 @@ class  BOOST_PP_CAT(FNAME_AND_CALL, N) { \
   public: \
   static void exec(std::vector<dc_send*>& sender, unsigned char flags, Iterator target_begin, Iterator target_end, F remote_function BOOST_PP_COMMA_IF(N) BOOST_PP_ENUM(N,GENARGS ,_) ) {  \
     oarchive arc;       \
-    arc.buf = (char*)malloc(INITIAL_BUFFER_SIZE); \
     arc.len = INITIAL_BUFFER_SIZE; \
+    arc.buf = dc_impl::archive_buffer_acquire(arc.len, dc_impl::BROADCAST_SITE); \
     size_t len = dc_send::write_packet_header(arc, _get_procid(), flags, _get_sequentialization_key()); \
     uint32_t beginoff = arc.off; \
     dispatch_type d = BOOST_PP_CAT(function_call_issue_detail::dispatch_selector,N)<typename is_rpc_call<F>::type, F BOOST_PP_COMMA_IF(N) BOOST_PP_ENUM_PARAMS(N, T) >::dispatchfn();   \
@@ -118,7 +119,7 @@ class  BOOST_PP_CAT(FNAME_AND_CALL, N) { \
       release_thread_local_buffer(*iter, flags & CONTROL_PACKET); \
       ++iter;    \
     } \
-    free(arc.buf); \
+    dc_impl::archive_buffer_release(arc.buf); \
     if (flags & FLUSH_PACKET) pull_flush_soon_thread_local_buffer(); \
   }\
 };
@@ -32,6 +32,7 @@
 #include <graphlab/rpc/object_call_issue.hpp>
 #include <graphlab/rpc/is_rpc_call.hpp>
 #include <graphlab/rpc/dc_thread_get_send_buffer.hpp>
+#include <graphlab/rpc/archive_buffer_pool.hpp>
 #include <boost/preprocessor.hpp>
 #include <graphlab/rpc/mem_function_arg_types_def.hpp>
 
@@ -105,8 +106,8 @@ class  BOOST_PP_CAT(BOOST_PP_TUPLE_ELEM(2,0,FNAME_AND_CALL), N) { \
   static void exec(dc_dist_object_base* rmi, std::vector<dc_send*> sender, unsigned char flags, \
                     Iterator target_begin, Iterator target_end, size_t objid, F remote_function BOOST_PP_COMMA_IF(N) BOOST_PP_ENUM(N,GENARGS ,_) ) {  \
     oarchive arc;       \
-    arc.buf = (char*)malloc(INITIAL_BUFFER_SIZE); \
     arc.len = INITIAL_BUFFER_SIZE; \
+    arc.buf = dc_impl::archive_buffer_acquire(arc.len, dc_impl::BROADCAST_SITE); \
     size_t len = dc_send::write_packet_header(arc, _get_procid(), flags, _get_sequentialization_key()); \
     uint32_t beginoff = arc.off; \
     dispatch_type d = BOOST_PP_CAT(dc_impl::OBJECT_NONINTRUSIVE_DISPATCH,N)<distributed_control,T,F BOOST_PP_COMMA_IF(N) BOOST_PP_ENUM(N, GENT ,_) >;   \
@@ -126,7 +127,7 @@ class  BOOST_PP_CAT(BOOST_PP_TUPLE_ELEM(2,0,FNAME_AND_CALL), N) { \
       } \
       ++iter; \
     } \
-    free(arc.buf); \
+    dc_impl::archive_buffer_release(arc.buf); \
     if (flags & FLUSH_PACKET) pull_flush_soon_thread_local_buffer(); \
   }  \
 };
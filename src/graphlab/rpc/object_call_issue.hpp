@@ -33,6 +33,7 @@
 #include <graphlab/rpc/dc_thread_get_send_buffer.hpp>
 #include <boost/preprocessor.hpp>
 #include <graphlab/rpc/dc_compile_parameters.hpp>
+#include <graphlab/rpc/archive_buffer_pool.hpp>
 #include <graphlab/util/generics/blob.hpp>
 #include <graphlab/rpc/mem_function_arg_types_def.hpp>
 
@@ -134,8 +135,8 @@ class object_split_call {
   static oarchive* split_call_begin(dc_dist_object_base* rmi, size_t objid, F remote_function) {
     oarchive* ptr = new oarchive;
     oarchive& arc = *ptr;
-    arc.buf = (char*)malloc(INITIAL_BUFFER_SIZE); 
-    arc.len = INITIAL_BUFFER_SIZE; 
+    arc.len = INITIAL_BUFFER_SIZE;
+    arc.buf = archive_buffer_acquire(arc.len, SPLIT_CALL_SITE);
     arc.advance(sizeof(packet_hdr));
     dispatch_type d = dc_impl::OBJECT_NONINTRUSIVE_DISPATCH2<distributed_control,T,F,size_t, wild_pointer>;
     arc << reinterpret_cast<size_t>(d);
@@ -150,7 +151,7 @@ class object_split_call {
     return ptr;
   }
   static void split_call_cancel(oarchive* oarc) {
-    free(oarc->buf);
+    archive_buffer_release(oarc->buf);
     delete oarc;
   }
 
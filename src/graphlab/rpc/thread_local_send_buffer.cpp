@@ -1,5 +1,6 @@
 #include <graphlab/rpc/thread_local_send_buffer.hpp>
 #include <graphlab/rpc/dc.hpp>
+#include <graphlab/rpc/archive_buffer_pool.hpp>
 namespace graphlab {
 namespace dc_impl {
 
@@ -28,7 +29,7 @@ thread_local_buffer::~thread_local_buffer() {
   // deallocate the buffers
   for (size_t i = 0; i < current_archive.size(); ++i) {
     if (current_archive[i].buf) {
-      free(current_archive[i].buf);
+      archive_buffer_release(current_archive[i].buf);
       current_archive[i].buf = NULL;
     }
   }
@@ -87,9 +88,10 @@ oarchive* thread_local_buffer::acquire(procid_t target) {
   archive_locks[target].lock();
   // need a new archive, or existing one at risk of being resized
   if (current_archive[target].buf == NULL) {
-    current_archive[target].buf = (char*)malloc(INITIAL_BUFFER_SIZE);
+    size_t len = INITIAL_BUFFER_SIZE;
+    current_archive[target].buf = archive_buffer_acquire(len, SEND_BUFFER_SITE);
     current_archive[target].off = 0;
-    current_archive[target].len = INITIAL_BUFFER_SIZE;
+    current_archive[target].len = len;
   }
   prev_acquire_archive_size = current_archive[target].off;
   return &current_archive[target];
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <graphlab/scheduler/block_sweep_scheduler.hpp>
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+void block_sweep_scheduler::set_options(const graphlab_options& opts) {
+  std::vector<std::string> keys = opts.get_scheduler_args().get_option_keys();
+  foreach(std::string opt, keys) {
+    if (opt == "tile_size") {
+      opts.get_scheduler_args().get_option("tile_size", tile_size);
+    } else {
+      logstream(LOG_FATAL) << "Unexpected Scheduler Option: " << opt << std::endl;
+    }
+  }
+  // whole words of the vertex bitset per tile
+  tile_size = std::max<size_t>((tile_size + 63) / 64 * 64, 64);
+}
+
+block_sweep_scheduler::block_sweep_scheduler(size_t num_vertices,
+                                             const graphlab_options& opts) :
+    ncpus(opts.get_ncpus()),
+    num_vertices(num_vertices),
+    tile_size(4096),
+    next_tile(0),
+    tracked_memory(memory_info::SCHEDULER) {
+  ASSERT_GE(opts.get_ncpus(), 1);
+  set_options(opts);
+  cpus.resize(ncpus);
+  set_num_vertices(num_vertices);
+} // end of constructor
+
+
+void block_sweep_scheduler::set_num_vertices(const lvid_type numv) {
+  num_vertices = numv;
+  num_tiles = (num_vertices + tile_size - 1) / tile_size;
+  vertex_is_scheduled.resize(numv);
+  tile_is_active.resize(num_tiles);
+  tracked_memory.set(vertex_is_scheduled.size() / 8 +
+                     tile_is_active.size() / 8);
+}
+
+void block_sweep_scheduler::schedule(const lvid_type vid, double priority) {
+  if (vid >= num_vertices) return;
+  if (!vertex_is_scheduled.set_bit(vid)) num_scheduled.inc();
+  // Set after the vertex bit: a thread clearing the tile bit after this
+  // sees the vertex when it sweeps the tile.
+  const size_t tile = vid / tile_size;
+  if (!tile_is_active.get(tile)) tile_is_active.set_bit(tile);
+}
+
+bool block_sweep_scheduler::claim_tile(size_t& ret_tile) {
+  while (1) {
+    const size_t start = next_tile < num_tiles ? next_tile : 0;
+    size_t tile = start;
+    if (!tile_is_active.first_bit_in_range(tile, num_tiles)) {
+      tile = 0;
+      if (!tile_is_active.first_bit_in_range(tile, start)) return false;
+    }
+    next_tile = tile + 1;
+    // another thread may claim it first. Look again.
+    if (tile_is_active.clear_bit(tile)) {
+      ret_tile = tile;
+      return true;
+    }
+  }
+}
+
+sched_status::status_enum
+block_sweep_scheduler::get_next(const size_t cpuid, lvid_type& ret_vid) {
+  cpu_state& cpu = cpus[cpuid];
+  while (1) {
+    if (cpu.tile == size_t(-1)) {
+      if (num_scheduled.value == 0 || !claim_tile(cpu.tile)) {
+        return sched_status::EMPTY;
+      }
+      cpu.pos = cpu.tile * tile_size;
+    }
+    // sweep the rest of the tile in lvid order
+    const size_t tile_end = std::min((cpu.tile + 1) * tile_size, num_vertices);
+    size_t vid = cpu.pos;
+    while (vertex_is_scheduled.first_bit_in_range(vid, tile_end)) {
+      if (vertex_is_scheduled.clear_bit(vid)) {
+        cpu.pos = vid + 1;
+        num_scheduled.dec();
+        ret_vid = vid;
+        return sched_status::NEW_TASK;
+      }
+      ++vid;
+    }
+    // the tile is done. Vertices scheduled into it since it was claimed
+    // reactivated it.
+    cpu.tile = size_t(-1);
+  }
+} // end of get_next
+
+
+}
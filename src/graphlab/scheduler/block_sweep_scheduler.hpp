@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_BLOCK_SWEEP_SCHEDULER_HPP
+#define GRAPHLAB_BLOCK_SWEEP_SCHEDULER_HPP
+
+#include <vector>
+
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/scheduler/ischeduler.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/memory_info.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/options/graphlab_options.hpp>
+
+#include <graphlab/macros_def.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup group_schedulers
+   *
+   * A sweep scheduler which follows the local vertex order in tiles.
+   * The lvid space is partitioned into tiles of "tile_size" consecutive
+   * vertices. A thread claims a whole active tile and runs its scheduled
+   * vertices in ascending lvid order before claiming the next one.
+   * Since the local graph stores vertices and edges in lvid order,
+   * consecutive updates then touch neighboring vertex data and edge
+   * lists, and a tile of vertices which fits in cache is swept with
+   * few misses. sweep_scheduler in contrast visits the vertices in a
+   * fixed permutation and pays a cache miss for almost every vertex.
+   *
+   * A summary bitmap with one bit per tile records which tiles may
+   * contain scheduled vertices, so inactive tiles are skipped with a
+   * word scan. Tiles are claimed in a shared round robin order, so all
+   * threads sweep the graph together, Gauss-Seidel style.
+   */
+  class block_sweep_scheduler: public ischeduler {
+  private:
+
+    // The tile a thread is sweeping
+    struct cpu_state {
+      // the tile, or size_t(-1) if none
+      size_t tile;
+      // the next vertex in the tile to look at
+      size_t pos;
+      char padding[64 - 2 * sizeof(size_t)];
+      cpu_state(): tile(size_t(-1)), pos(0) { }
+    };
+
+    size_t ncpus;
+    size_t num_vertices;
+    size_t tile_size;
+    size_t num_tiles;
+
+    // a bitset denoting if a vertex is scheduled
+    dense_bitset vertex_is_scheduled;
+    // a bitset denoting if a tile may contain scheduled vertices
+    dense_bitset tile_is_active;
+    // the number of vertices scheduled and not yet returned
+    atomic<size_t> num_scheduled;
+    // the tile from which the next tile search begins. Racy updates
+    // only change the sweep order.
+    volatile size_t next_tile;
+    std::vector<cpu_state> cpus;
+    // the memory accounted to memory_info::SCHEDULER
+    memory_info::tracked_size tracked_memory;
+
+    void set_options(const graphlab_options& opts);
+
+    // claims an active tile. Returns false if no tile is active.
+    bool claim_tile(size_t& ret_tile);
+
+  public:
+    block_sweep_scheduler(size_t num_vertices,
+                          const graphlab_options& opts);
+
+    void set_num_vertices(const lvid_type numv);
+
+    void schedule(const lvid_type vid, double priority = 1 /* ignored */);
+
+    sched_status::status_enum get_next(const size_t cpuid, lvid_type& ret_vid);
+
+    static void print_options_help(std::ostream &out) {
+      out << "tile_size = [integer, number of consecutive vertices swept "
+          << "by one thread\n"
+          << "\t at a time, rounded up to a multiple of 64. default=4096]\n";
+    } // end of print_options_help
+
+    bool empty() {
+      return num_scheduled.value == 0;
+    }
+  };
+
+
+} // end of namespace graphlab
+#include <graphlab/macros_undef.hpp>
+
+#endif
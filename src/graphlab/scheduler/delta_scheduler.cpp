@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <cmath>
+#include <limits>
+#include <graphlab/scheduler/delta_scheduler.hpp>
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+void delta_scheduler::set_options(const graphlab_options& opts) {
+  ncpus = opts.get_ncpus();
+  std::vector<std::string> keys = opts.get_scheduler_args().get_option_keys();
+  foreach(std::string opt, keys) {
+    if (opt == "multi") {
+      opts.get_scheduler_args().get_option("multi", multi);
+    } else if (opt == "delta") {
+      opts.get_scheduler_args().get_option("delta", delta);
+    } else {
+      logstream(LOG_FATAL) << "Unexpected Scheduler Option: " << opt << std::endl;
+    }
+  }
+  if (!(delta > 0)) {
+    logstream(LOG_FATAL) << "delta must be positive" << std::endl;
+  }
+}
+
+// Initializes the internal datastructures
+void delta_scheduler::initialize_data_structures() {
+  size_t nqueues = std::max(multi * ncpus, size_t(1));
+  queues.resize(nqueues);
+  queue_sizes.resize(nqueues, 0);
+  locks.resize(nqueues);
+  vertex_is_scheduled.resize(num_vertices);
+  vertex_bucket.resize(num_vertices);
+  tracked_memory.set(vertex_is_scheduled.size() / 8 +
+                     vertex_bucket.capacity() * sizeof(int64_t));
+}
+
+delta_scheduler::delta_scheduler(size_t num_vertices,
+                                 const graphlab_options& opts):
+    tracked_memory(memory_info::SCHEDULER),
+    current_bucket(std::numeric_limits<int64_t>::max()),
+    multi(3),
+    delta(1.0),
+    num_vertices(num_vertices) {
+  ASSERT_GE(opts.get_ncpus(), 1);
+  set_options(opts);
+  initialize_data_structures();
+}
+
+
+void delta_scheduler::set_num_vertices(const lvid_type numv) {
+  num_vertices = numv;
+  vertex_is_scheduled.resize(numv);
+  vertex_bucket.resize(numv);
+  tracked_memory.set(vertex_is_scheduled.size() / 8 +
+                     vertex_bucket.capacity() * sizeof(int64_t));
+}
+
+int64_t delta_scheduler::get_bucket(double priority) const {
+  double b = std::floor(priority / delta);
+  // clamp so that infinite priorities land in the extreme buckets
+  if (b >= 9.0e18) return std::numeric_limits<int64_t>::max();
+  else if (b <= -9.0e18) return std::numeric_limits<int64_t>::min();
+  else return (int64_t)b;
+}
+
+void delta_scheduler::schedule(const lvid_type vid, double priority) {
+  if (vid >= num_vertices) return;
+  const int64_t bucket = get_bucket(priority);
+  if (!vertex_is_scheduled.set_bit(vid)) {
+    num_scheduled.inc();
+  } else if (bucket > vertex_bucket[vid]) {
+    // already scheduled, but its priority rose into a higher bucket.
+    // Insert it again. The old entry is skipped when popped.
+  } else {
+    return;
+  }
+  vertex_bucket[vid] = bucket;
+  if (bucket > current_bucket) current_bucket = bucket;
+
+  // M.D. Mitzenmacher The Power of Two Choices in Randomized
+  // Load Balancing (1991)
+  size_t idx = 0;
+  if(queues.size() > 1) {
+    const uint32_t prod =
+        random::fast_uniform(uint32_t(0),
+                             uint32_t(queues.size() * queues.size() - 1));
+    const uint32_t r1 = prod / queues.size();
+    const uint32_t r2 = prod % queues.size();
+    idx = (queue_sizes[r1] < queue_sizes[r2]) ? r1 : r2;
+  }
+  locks[idx].lock();
+  queues[idx][bucket].push_back(vid);
+  ++queue_sizes[idx];
+  locks[idx].unlock();
+}
+
+bool delta_scheduler::find_highest_bucket(int64_t& ret_bucket) {
+  bool found = false;
+  for (size_t i = 0; i < queues.size(); ++i) {
+    locks[i].lock();
+    if (!queues[i].empty() &&
+        (!found || queues[i].begin()->first > ret_bucket)) {
+      ret_bucket = queues[i].begin()->first;
+      found = true;
+    }
+    locks[i].unlock();
+  }
+  return found;
+}
+
+sched_status::status_enum delta_scheduler::get_next(const size_t cpuid,
+                                                    lvid_type& ret_vid) {
+  while(1) {
+    const int64_t cur = current_bucket;
+    // begin scanning from the first queue owned by this cpu
+    const size_t initial_idx = cpuid * multi;
+    for(size_t i = 0; i < queues.size(); ++i) {
+      const size_t idx = (initial_idx + i) % queues.size();
+      bool good = false;
+      locks[idx].lock();
+      while(!queues[idx].empty() && queues[idx].begin()->first >= cur) {
+        bucket_map_type::iterator iter = queues[idx].begin();
+        ret_vid = iter->second.front();
+        iter->second.pop_front();
+        --queue_sizes[idx];
+        if (iter->second.empty()) queues[idx].erase(iter);
+        if (ret_vid < num_vertices) {
+          good = vertex_is_scheduled.clear_bit(ret_vid);
+          if (good) break;
+        }
+      }
+      locks[idx].unlock();
+      // managed to retrieve a task
+      if(good) {
+        num_scheduled.dec();
+        return sched_status::NEW_TASK;
+      }
+    }
+    // the current bucket is exhausted. Advance to the next one
+    int64_t next_bucket;
+    if (!find_highest_bucket(next_bucket)) {
+      current_bucket = std::numeric_limits<int64_t>::max();
+      return sched_status::EMPTY;
+    }
+    if (next_bucket < current_bucket) current_bucket = next_bucket;
+  }
+} // end of get_next
+
+
+bool delta_scheduler::empty() {
+  return num_scheduled.value == 0;
+}
+
+}
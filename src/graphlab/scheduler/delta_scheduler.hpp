@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_DELTA_SCHEDULER_HPP
+#define GRAPHLAB_DELTA_SCHEDULER_HPP
+
+#include <deque>
+#include <map>
+#include <functional>
+#include <stdint.h>
+
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+
+#include <graphlab/util/random.hpp>
+#include <graphlab/scheduler/ischeduler.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/memory_info.hpp>
+
+#include <graphlab/options/graphlab_options.hpp>
+
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+  /**
+   * \ingroup group_schedulers
+   * This class defines a bucketed priority scheduler in the style of
+   * delta-stepping. Priorities are grouped into buckets of width
+   * "delta", bucket k holding priorities in [k * delta, (k+1) * delta).
+   * All the vertices in the highest non-empty bucket are handed out,
+   * in no particular order, before any vertex in a lower bucket.
+   *
+   * For shortest path style programs whose message priority is the
+   * negated tentative distance, this processes vertices in distance
+   * buckets of width delta: vertices within a bucket run in parallel,
+   * and vertices with larger tentative distances wait until their
+   * distance has had a chance to settle.
+   *
+   * Each machine orders its own vertices, so in the distributed setting
+   * the bucket order is only approximate across machines.
+   */
+  class delta_scheduler : public ischeduler {
+
+  public:
+
+    typedef std::map<int64_t, std::deque<lvid_type>,
+                     std::greater<int64_t> > bucket_map_type;
+
+  private:
+
+    // a bitset denoting if a vertex is scheduled
+    dense_bitset vertex_is_scheduled;
+    // the bucket the vertex was last inserted into
+    std::vector<int64_t> vertex_bucket;
+    // the memory accounted to memory_info::SCHEDULER
+    memory_info::tracked_size tracked_memory;
+    // a collection of bucket queues. The highest bucket is at begin()
+    std::vector<bucket_map_type> queues;
+    // the number of entries (including stale ones) in each queue
+    std::vector<size_t> queue_sizes;
+    // a parallel datastructure to queues containing all the locks
+    std::vector<padded_simple_spinlock> locks;
+
+    // the number of vertices scheduled and not yet returned
+    atomic<size_t> num_scheduled;
+    // the bucket being processed. Racy updates only relax the order.
+    volatile int64_t current_bucket;
+
+    // the number of CPUs
+    size_t ncpus;
+    // The queue to CPU ratio
+    size_t multi;
+    // the width of each bucket
+    double delta;
+    // the number of vertices in the graph
+    size_t num_vertices;
+
+
+    void set_options(const graphlab_options& opts);
+
+    // Initializes the internal datastructures
+    void initialize_data_structures();
+
+    // Returns the bucket of a priority value
+    int64_t get_bucket(double priority) const;
+
+    // Returns the highest non-empty bucket over all queues.
+    // Returns false if all queues are empty.
+    bool find_highest_bucket(int64_t& ret_bucket);
+  public:
+
+    delta_scheduler(size_t num_vertices, const graphlab_options& opts);
+
+    void set_num_vertices(const lvid_type numv);
+
+    void schedule(const lvid_type vid, double priority = 1);
+
+    /** Get the next element in the queue */
+    sched_status::status_enum get_next(const size_t cpuid,
+                                       lvid_type& ret_vid);
+
+    bool empty();
+
+    static void print_options_help(std::ostream& out) {
+      out << "\t delta = [double, width of each priority bucket. "
+          << "Default = 1]\n"
+          << "\t multi = [number of queues per thread. Default = 3].\n";
+    }
+
+
+  };
+
+
+} // end of namespace graphlab
+#include <graphlab/macros_undef.hpp>
+
+#endif
+
@@ -45,10 +45,12 @@ void fifo_scheduler::initialize_data_structures() {
   queues.resize(nqueues);
   locks.resize(nqueues);
   vertex_is_scheduled.resize(num_vertices);
+  tracked_memory.set(vertex_is_scheduled.size() / 8);
 }
 
 fifo_scheduler::fifo_scheduler(size_t num_vertices,
                                const graphlab_options& opts):
+     tracked_memory(memory_info::SCHEDULER),
      multi(3), num_vertices(num_vertices) { 
   ASSERT_GE(opts.get_ncpus(), 1);
   set_options(opts);
@@ -59,6 +61,7 @@ fifo_scheduler::fifo_scheduler(size_t num_vertices,
 void fifo_scheduler::set_num_vertices(const lvid_type numv) {
   num_vertices = numv;
   vertex_is_scheduled.resize(numv);
+  tracked_memory.set(vertex_is_scheduled.size() / 8);
 }
 
 void fifo_scheduler::schedule(const lvid_type vid, double priority) {
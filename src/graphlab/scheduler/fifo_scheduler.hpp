@@ -34,6 +34,7 @@
 #include <graphlab/util/random.hpp>
 #include <graphlab/scheduler/ischeduler.hpp>
 #include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/memory_info.hpp>
 
 #include <graphlab/options/graphlab_options.hpp>
 
@@ -59,6 +60,8 @@ namespace graphlab {
 
     // a bitset denoting if a vertex is scheduled
     dense_bitset vertex_is_scheduled;
+    // the memory accounted to memory_info::SCHEDULER
+    memory_info::tracked_size tracked_memory;
     // a collection of FIFO queues
     std::vector<queue_type> queues;
     // a parallel datastructure to queues containing all the locks
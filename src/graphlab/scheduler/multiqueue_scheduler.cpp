@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <cmath>
+#include <graphlab/scheduler/multiqueue_scheduler.hpp>
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+void multiqueue_scheduler::set_options(const graphlab_options& opts) {
+  ncpus = opts.get_ncpus();
+  std::vector<std::string> keys = opts.get_scheduler_args().get_option_keys();
+  foreach(std::string opt, keys) {
+    if (opt == "multi") {
+      opts.get_scheduler_args().get_option("multi", multi);
+    } else if (opt == "choices") {
+      opts.get_scheduler_args().get_option("choices", choices);
+    } else if (opt == "resolution") {
+      opts.get_scheduler_args().get_option("resolution", resolution);
+    } else {
+      logstream(LOG_FATAL) << "Unexpected Scheduler Option: " << opt << std::endl;
+    }
+  }
+  if (choices < 1) {
+    logstream(LOG_FATAL) << "choices must be at least 1" << std::endl;
+  }
+  if (resolution < 1 || resolution > 256) {
+    logstream(LOG_FATAL) << "resolution must be between 1 and 256" << std::endl;
+  }
+}
+
+// Initializes the internal datastructures
+void multiqueue_scheduler::initialize_data_structures() {
+  // bucket 0 holds the non-positive priorities
+  num_buckets = (MAX_EXPONENT - MIN_EXPONENT) * resolution + 1;
+  size_t nqueues = std::max(multi * ncpus, size_t(1));
+  queues.resize(nqueues);
+  for (size_t i = 0; i < queues.size(); ++i) {
+    queues[i].buckets.resize(num_buckets);
+  }
+  locks.resize(nqueues);
+  vertex_is_scheduled.resize(num_vertices);
+  vertex_bucket.resize(num_vertices);
+  tracked_memory.set(vertex_is_scheduled.size() / 8 +
+                     vertex_bucket.capacity() * sizeof(uint16_t));
+}
+
+multiqueue_scheduler::multiqueue_scheduler(size_t num_vertices,
+                                           const graphlab_options& opts):
+    tracked_memory(memory_info::SCHEDULER),
+    multi(2),
+    choices(2),
+    resolution(4),
+    num_vertices(num_vertices) {
+  ASSERT_GE(opts.get_ncpus(), 1);
+  set_options(opts);
+  initialize_data_structures();
+}
+
+
+void multiqueue_scheduler::set_num_vertices(const lvid_type numv) {
+  num_vertices = numv;
+  vertex_is_scheduled.resize(numv);
+  vertex_bucket.resize(numv);
+  tracked_memory.set(vertex_is_scheduled.size() / 8 +
+                     vertex_bucket.capacity() * sizeof(uint16_t));
+}
+
+size_t multiqueue_scheduler::get_bucket(double priority) const {
+  // also catches NaN
+  if (!(priority > 0)) return 0;
+  // priority = mant * 2^exp with mant in [0.5, 1). Split each doubling
+  // linearly into resolution buckets.
+  int exp;
+  const double mant = std::frexp(priority, &exp);
+  if (exp - 1 < MIN_EXPONENT) return 1;
+  if (exp - 1 >= MAX_EXPONENT) return num_buckets - 1;
+  return 1 + (exp - 1 - MIN_EXPONENT) * resolution +
+      size_t((2 * mant - 1) * resolution);
+}
+
+void multiqueue_scheduler::schedule(const lvid_type vid, double priority) {
+  if (vid >= num_vertices) return;
+  const size_t bucket = get_bucket(priority);
+  if (!vertex_is_scheduled.set_bit(vid)) {
+    num_scheduled.inc();
+  } else if (bucket > vertex_bucket[vid]) {
+    // already scheduled, but its priority rose into a higher bucket.
+    // Insert it again. The old entry is skipped when popped.
+  } else {
+    return;
+  }
+  vertex_bucket[vid] = bucket;
+
+  // insert into the first free of a sequence of random queues
+  size_t idx;
+  do {
+    idx = random::fast_uniform(size_t(0), queues.size() - 1);
+  } while (!locks[idx].try_lock());
+  bucket_queue& q = queues[idx];
+  q.buckets[bucket].push_back(vid);
+  if (int32_t(bucket) > q.top) q.top = bucket;
+  locks[idx].unlock();
+}
+
+bool multiqueue_scheduler::pop_locked(size_t idx, lvid_type& ret_vid) {
+  bucket_queue& q = queues[idx];
+  bool good = false;
+  while (q.top >= 0 && !good) {
+    std::vector<lvid_type>& bucket = q.buckets[q.top];
+    while (!bucket.empty() && !good) {
+      ret_vid = bucket.back();
+      bucket.pop_back();
+      good = ret_vid < num_vertices && vertex_is_scheduled.clear_bit(ret_vid);
+    }
+    // move the top down to the next non-empty bucket
+    int32_t top = q.top;
+    while (top >= 0 && q.buckets[top].empty()) --top;
+    q.top = top;
+  }
+  return good;
+}
+
+sched_status::status_enum
+multiqueue_scheduler::get_next(const size_t cpuid, lvid_type& ret_vid) {
+  // pop from the best of a few random queues. Give up after a number of
+  // rounds which only fail if the queues are (nearly) empty
+  for (size_t round = 0; round < queues.size(); ++round) {
+    if (num_scheduled.value == 0) return sched_status::EMPTY;
+    size_t best = 0;
+    int32_t best_top = -1;
+    for (size_t i = 0; i < choices; ++i) {
+      const size_t idx = random::fast_uniform(size_t(0), queues.size() - 1);
+      const int32_t top = queues[idx].top;
+      if (top > best_top) {
+        best = idx;
+        best_top = top;
+      }
+    }
+    if (best_top < 0 || !locks[best].try_lock()) continue;
+    const bool good = pop_locked(best, ret_vid);
+    locks[best].unlock();
+    if (good) {
+      num_scheduled.dec();
+      return sched_status::NEW_TASK;
+    }
+  }
+  // scan all queues, beginning with those owned by this cpu
+  const size_t initial_idx = cpuid * multi;
+  for (size_t i = 0; i < queues.size(); ++i) {
+    const size_t idx = (initial_idx + i) % queues.size();
+    if (queues[idx].top < 0) continue;
+    locks[idx].lock();
+    const bool good = pop_locked(idx, ret_vid);
+    locks[idx].unlock();
+    if (good) {
+      num_scheduled.dec();
+      return sched_status::NEW_TASK;
+    }
+  }
+  return sched_status::EMPTY;
+} // end of get_next
+
+
+bool multiqueue_scheduler::empty() {
+  return num_scheduled.value == 0;
+}
+
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_MULTIQUEUE_SCHEDULER_HPP
+#define GRAPHLAB_MULTIQUEUE_SCHEDULER_HPP
+
+#include <vector>
+#include <stdint.h>
+
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+
+#include <graphlab/util/random.hpp>
+#include <graphlab/scheduler/ischeduler.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/memory_info.hpp>
+
+#include <graphlab/options/graphlab_options.hpp>
+
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+  /**
+   * \ingroup group_schedulers
+   *
+   * This class defines a relaxed priority scheduler in the style of
+   * MultiQueues (Rihani, Sanders and Dementiev, 2015). There are
+   * "multi" queues per thread. A vertex is scheduled into a random
+   * queue, and get_next() samples "choices" queues and pops the best
+   * vertex of the one with the highest top priority. The vertices
+   * returned are therefore only approximately in priority order, but
+   * no lock is ever waited on: busy queues are skipped.
+   *
+   * Instead of a heap, each queue is an array of buckets on a log scale
+   * of the priority, with "resolution" buckets per doubling of the
+   * priority. Scheduling is an O(1) append to a bucket and vertices
+   * within a bucket are returned in no particular order. All priorities
+   * which are not positive share the lowest bucket.
+   *
+   * This replaces the O(log n) heap update of priority_scheduler, which
+   * dominates the cost of scheduling for residual style programs which
+   * reschedule their neighbors on every update.
+   */
+  class multiqueue_scheduler : public ischeduler {
+
+  private:
+
+    // A queue of vertices bucketed by priority
+    struct bucket_queue {
+      // the vertices in each bucket. Includes stale entries.
+      std::vector<std::vector<lvid_type> > buckets;
+      // the highest non-empty bucket, or -1 if the queue is empty.
+      // Read without the lock to pick a queue.
+      volatile int32_t top;
+      // pad to a cache line so that queues do not share tops
+      char padding[64 - sizeof(std::vector<std::vector<lvid_type> >) -
+                   sizeof(int32_t)];
+      bucket_queue(): top(-1) { }
+    };
+
+    // the log2 of the smallest and largest distinguished priorities
+    static const int MIN_EXPONENT = -64;
+    static const int MAX_EXPONENT = 64;
+
+    // a bitset denoting if a vertex is scheduled
+    dense_bitset vertex_is_scheduled;
+    // the bucket the vertex was last inserted into
+    std::vector<uint16_t> vertex_bucket;
+    // the memory accounted to memory_info::SCHEDULER
+    memory_info::tracked_size tracked_memory;
+    // the collection of queues
+    std::vector<bucket_queue> queues;
+    // a parallel datastructure to queues containing all the locks
+    std::vector<padded_simple_spinlock> locks;
+
+    // the number of vertices scheduled and not yet returned
+    atomic<size_t> num_scheduled;
+
+    // the number of CPUs
+    size_t ncpus;
+    // The queue to CPU ratio
+    size_t multi;
+    // the number of queues compared by get_next
+    size_t choices;
+    // the number of buckets per doubling of the priority
+    size_t resolution;
+    // the total number of buckets in each queue
+    size_t num_buckets;
+    // the number of vertices in the graph
+    size_t num_vertices;
+
+
+    void set_options(const graphlab_options& opts);
+
+    // Initializes the internal datastructures
+    void initialize_data_structures();
+
+    // Returns the bucket of a priority value
+    size_t get_bucket(double priority) const;
+
+    // Pops a vertex from queue idx, whose lock must be held.
+    // Returns false if the queue has no scheduled vertex.
+    bool pop_locked(size_t idx, lvid_type& ret_vid);
+  public:
+
+    multiqueue_scheduler(size_t num_vertices, const graphlab_options& opts);
+
+    void set_num_vertices(const lvid_type numv);
+
+    void schedule(const lvid_type vid, double priority = 1);
+
+    /** Get the next element in the queue */
+    sched_status::status_enum get_next(const size_t cpuid,
+                                       lvid_type& ret_vid);
+
+    bool empty();
+
+    static void print_options_help(std::ostream& out) {
+      out << "\t multi = [number of queues per thread. Default = 2].\n"
+          << "\t choices = [number of queues compared on each pop. Larger\n"
+          << "\t           values give a stricter priority order. "
+          << "Default = 2]\n"
+          << "\t resolution = [number of priority buckets per doubling of\n"
+          << "\t              the priority. Default = 4]\n";
+    }
+
+
+  };
+
+
+} // end of namespace graphlab
+#include <graphlab/macros_undef.hpp>
+
+#endif
@@ -46,10 +46,12 @@ void priority_scheduler::initialize_data_structures() {
   queues.resize(nqueues);
   locks.resize(nqueues);
   vertex_is_scheduled.resize(num_vertices);
+  tracked_memory.set(vertex_is_scheduled.size() / 8);
 }
 
 priority_scheduler::priority_scheduler(size_t num_vertices,
                                        const graphlab_options& opts):
+    tracked_memory(memory_info::SCHEDULER),
     multi(3), 
     min_priority(-std::numeric_limits<double>::max()),
     num_vertices(num_vertices) { 
@@ -62,6 +64,7 @@ priority_scheduler::priority_scheduler(size_t num_vertices,
 void priority_scheduler::set_num_vertices(const lvid_type numv) {
   num_vertices = numv;
   vertex_is_scheduled.resize(numv);
+  tracked_memory.set(vertex_is_scheduled.size() / 8);
 }
 
 void priority_scheduler::schedule(const lvid_type vid, double priority) {
@@ -35,6 +35,7 @@
 #include <graphlab/util/mutable_queue.hpp>
 #include <graphlab/scheduler/ischeduler.hpp>
 #include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/memory_info.hpp>
 
 #include <graphlab/options/graphlab_options.hpp>
 
@@ -61,6 +62,8 @@ namespace graphlab {
 
     // a bitset denoting if a vertex is scheduled
     dense_bitset vertex_is_scheduled;
+    // the memory accounted to memory_info::SCHEDULER
+    memory_info::tracked_size tracked_memory;
     // a collection of priority queues
     std::vector<queue_type> queues;
     // a parallel datastructure to queues containing all the locks
@@ -47,6 +47,7 @@ void queued_fifo_scheduler::initialize_data_structures() {
   out_queue_locks.resize(ncpus);
   out_queues.resize(ncpus);
   vertex_is_scheduled.resize(num_vertices);
+  tracked_memory.set(vertex_is_scheduled.size() / 8);
 }
 
 queued_fifo_scheduler::queued_fifo_scheduler(size_t num_vertices,
@@ -54,6 +55,7 @@ queued_fifo_scheduler::queued_fifo_scheduler(size_t num_vertices,
     ncpus(opts.get_ncpus()),
     num_vertices(num_vertices),
     multi(3),
+    tracked_memory(memory_info::SCHEDULER),
     sub_queue_size(100) {
       ASSERT_GE(opts.get_ncpus(), 1);
       set_options(opts);
@@ -63,6 +65,7 @@ queued_fifo_scheduler::queued_fifo_scheduler(size_t num_vertices,
 void queued_fifo_scheduler::set_num_vertices(const lvid_type numv) {
   num_vertices = numv;
   vertex_is_scheduled.resize(numv);
+  tracked_memory.set(vertex_is_scheduled.size() / 8);
 }
 
 void queued_fifo_scheduler::schedule(const lvid_type vid, double priority) {
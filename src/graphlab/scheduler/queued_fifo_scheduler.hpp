@@ -33,6 +33,7 @@
 #include <graphlab/parallel/atomic.hpp>
 
 #include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/memory_info.hpp>
 
 #include <graphlab/util/random.hpp>
 #include <graphlab/scheduler/ischeduler.hpp>
@@ -63,6 +64,8 @@ namespace graphlab {
     size_t num_vertices;
     size_t multi;
     dense_bitset vertex_is_scheduled;
+    // the memory accounted to memory_info::SCHEDULER
+    memory_info::tracked_size tracked_memory;
     std::deque<queue_type> master_queue;
     mutex master_lock;
     size_t sub_queue_size;
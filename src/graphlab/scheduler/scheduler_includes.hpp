@@ -22,9 +22,12 @@
 #ifndef GRAPHLAB_SCHEDULER_INCLUDES_HPP
 #define GRAPHLAB_SCHEDULER_INCLUDES_HPP
 
+#include <graphlab/scheduler/block_sweep_scheduler.hpp>
+#include <graphlab/scheduler/delta_scheduler.hpp>
 #include <graphlab/scheduler/fifo_scheduler.hpp>
 #include <graphlab/scheduler/get_message_priority.hpp>
 #include <graphlab/scheduler/ischeduler.hpp>
+#include <graphlab/scheduler/multiqueue_scheduler.hpp>
  #include <graphlab/scheduler/priority_scheduler.hpp>
 #include <graphlab/scheduler/queued_fifo_scheduler.hpp>
 #include <graphlab/scheduler/scheduler_factory.hpp>
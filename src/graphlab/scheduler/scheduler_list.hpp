@@ -43,12 +43,29 @@
     "This scheduler maintains a shared FIFO queue of FIFO queues. "     \
     "Each thread maintains its own smaller in and out queues. When a "  \
     "threads out queue is too large (greater than \"queuesize\") then " \
-    "the thread puts its out queue at the end of the master queue."))   
+    "the thread puts its out queue at the end of the master queue."))   \
+  (("delta", delta_scheduler,                                           \
+    "Bucketed priority scheduler in the style of delta-stepping. "      \
+    "Priorities are grouped into buckets of width \"delta\" and all "   \
+    "vertices in the highest bucket are executed before any vertex in " \
+    "a lower bucket."))                                                 \
+  (("multiqueue", multiqueue_scheduler,                                 \
+    "Relaxed priority scheduler in the style of MultiQueues. Vertices " \
+    "are bucketed on a log scale of their priority in several queues " \
+    "per thread, and the best of \"choices\" random queues is popped. " \
+    "Much faster than \"priority\" but only approximately ordered."))  \
+  (("block_sweep", block_sweep_scheduler,                               \
+    "Sweeps the vertices in local id order in tiles of \"tile_size\" "  \
+    "vertices. Each thread runs the scheduled vertices of a whole tile " \
+    "before moving on, so consecutive updates share cache lines."))
 
 #include <graphlab/scheduler/fifo_scheduler.hpp>
 #include <graphlab/scheduler/sweep_scheduler.hpp>
 #include <graphlab/scheduler/priority_scheduler.hpp>
 #include <graphlab/scheduler/queued_fifo_scheduler.hpp>
+#include <graphlab/scheduler/delta_scheduler.hpp>
+#include <graphlab/scheduler/multiqueue_scheduler.hpp>
+#include <graphlab/scheduler/block_sweep_scheduler.hpp>
 
 
 namespace graphlab {
@@ -54,7 +54,8 @@ sweep_scheduler::sweep_scheduler(size_t num_vertices,
     num_vertices(num_vertices),
     strict_round_robin(true),
     max_iterations(std::numeric_limits<size_t>::max()),
-    vertex_is_scheduled(num_vertices) {
+    vertex_is_scheduled(num_vertices),
+    tracked_memory(memory_info::SCHEDULER) {
   // initialize defaults
   ASSERT_GE(opts.get_ncpus(), 1);
   ordering = "random";
@@ -82,12 +83,14 @@ sweep_scheduler::sweep_scheduler(size_t num_vertices,
     for(size_t i = 0; i < cpu2index.size(); ++i) cpu2index[i] = i;
   }
   vertex_is_scheduled.resize(num_vertices);
+  tracked_memory.set(vertex_is_scheduled.size() / 8);
 } // end of constructor
 
 
 void sweep_scheduler::set_num_vertices(const lvid_type numv) {
   num_vertices = numv;
   vertex_is_scheduled.resize(numv);
+  tracked_memory.set(vertex_is_scheduled.size() / 8);
 }
 
 void sweep_scheduler::schedule(const lvid_type vid, double priority) {      
@@ -30,6 +30,7 @@
 #include <graphlab/graph/graph_basic_types.hpp>
 #include <graphlab/scheduler/ischeduler.hpp>
 #include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/memory_info.hpp>
 #include <graphlab/parallel/atomic.hpp>
 #include <graphlab/options/graphlab_options.hpp>
 
@@ -53,6 +54,8 @@ namespace graphlab {
     std::vector<lvid_type>             cpu2index;
 
     dense_bitset vertex_is_scheduled;
+    // the memory accounted to memory_info::SCHEDULER
+    memory_info::tracked_size tracked_memory;
     std::string                             ordering;
 
     void set_options(const graphlab_options& opts);
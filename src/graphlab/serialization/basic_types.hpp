@@ -29,6 +29,9 @@
 #define ARCHIVE_BASIC_TYPES_HPP
 
 #include <string>
+#include <boost/type_traits/is_same.hpp>
+#include <graphlab/serialization/is_pod.hpp>
+#include <graphlab/serialization/varint.hpp>
 #include <graphlab/serialization/serializable_pod.hpp>
 #include <graphlab/logger/assertions.hpp>
 #include <stdint.h>
@@ -170,6 +173,10 @@ namespace graphlab {
     template <typename OutArcType>
     struct serialize_impl<OutArcType, unsigned long , true> {
       static void exec(OutArcType& oarc, const unsigned long & s) {
+        if (__unlikely__(base_archive(oarc).compact)) {
+          base_archive(oarc).write_varint(s);
+          return;
+        }
         // only bottom 1 byte
         if ((s >> 8) == 0) {
           unsigned char c = 0;
@@ -204,6 +211,10 @@ namespace graphlab {
     template <typename InArcType>
     struct deserialize_impl<InArcType, unsigned long , true> {
       static void exec(InArcType& iarc, unsigned long & s) {
+        if (__unlikely__(base_archive(iarc).compact)) {
+          s = base_archive(iarc).read_varint();
+          return;
+        }
         unsigned char c;
         iarc.read(reinterpret_cast<char*>(&c), 1);
         switch(c) {
@@ -236,6 +247,43 @@ namespace graphlab {
     };
 
 
+    /**
+     * True if a sequence of T written to an archive is exactly the raw
+     * bytes of the values, so that it can be copied in bulk. This holds
+     * for the POD types except unsigned long (which is length encoded)
+     * and, in compact mode, the integers.
+     */
+    template <typename T>
+    inline bool is_raw_serialized(bool compact) {
+      return gl_is_pod<T>::value &&
+          !boost::is_same<T, unsigned long>::value &&
+          !(compact && is_compact_integer<T>::value);
+    }
+
+    /**
+     * Reads numel consecutive values of T from iarc into out. Values
+     * written as raw bytes (see is_raw_serialized) are copied in bulk.
+     * The bulk copy is selected at compile time on gl_is_pod<T>, so it is
+     * never instantiated for types which are not trivially copyable.
+     */
+    template <typename InArcType, typename T,
+              bool IsPOD = gl_is_pod<T>::value>
+    struct deserialize_sequence {
+      static void exec(InArcType& iarc, T* out, size_t numel) {
+        for (size_t i = 0; i < numel; ++i) iarc >> out[i];
+      }
+    };
+
+    template <typename InArcType, typename T>
+    struct deserialize_sequence<InArcType, T, true> {
+      static void exec(InArcType& iarc, T* out, size_t numel) {
+        if (is_raw_serialized<T>(iarc.compact)) {
+          iarc.read(reinterpret_cast<char*>(out), numel * sizeof(T));
+        } else {
+          for (size_t i = 0; i < numel; ++i) iarc >> out[i];
+        }
+      }
+    };
 
   } // namespace archive_detail
 } // namespace graphlab
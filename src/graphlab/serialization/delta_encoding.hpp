@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_SERIALIZATION_DELTA_ENCODING_HPP
+#define GRAPHLAB_SERIALIZATION_DELTA_ENCODING_HPP
+
+#include <vector>
+#include <iterator>
+#include <graphlab/serialization/serialize.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup group_serialization
+   * \brief Serializes a sequence of integers as the varint encoded
+   * differences between consecutive values.
+   *
+   * The sequence may be in any order, but sorted sequences of nearby
+   * values (such as a batch of sorted vertex ids) take one or two bytes
+   * per value. Read back with deserialize_delta_encoded().
+   * The encoding does not depend on the compact flag of the archive.
+   */
+  template <typename RandomAccessIterator>
+  void serialize_delta_encoded(oarchive& oarc, RandomAccessIterator begin,
+                               RandomAccessIterator end) {
+    oarc.write_varint(std::distance(begin, end));
+    int64_t prev = 0;
+    for (; begin != end; ++begin) {
+      const int64_t cur = int64_t(*begin);
+      oarc.write_varint(zigzag_encode(cur - prev));
+      prev = cur;
+    }
+  }
+
+  /**
+   * \ingroup group_serialization
+   * \brief Reads a sequence written by serialize_delta_encoded(),
+   * replacing the contents of values.
+   */
+  template <typename T>
+  void deserialize_delta_encoded(iarchive& iarc, std::vector<T>& values) {
+    values.resize(iarc.read_varint());
+    int64_t prev = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+      prev += zigzag_decode(iarc.read_varint());
+      values[i] = T(prev);
+    }
+  }
+
+  /**
+   * \ingroup group_serialization
+   * \brief A batch of integer ids which is serialized delta encoded.
+   * Sort ids before sending to get the smallest encoding.
+   */
+  template <typename T>
+  struct sorted_id_batch {
+    std::vector<T> ids;
+    void save(oarchive& oarc) const {
+      serialize_delta_encoded(oarc, ids.begin(), ids.end());
+    }
+    void load(iarchive& iarc) {
+      deserialize_delta_encoded(iarc, ids);
+    }
+  };
+
+} // namespace graphlab
+
+#endif
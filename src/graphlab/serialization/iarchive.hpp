@@ -34,6 +34,8 @@
 #include <graphlab/logger/assertions.hpp>
 #include <graphlab/serialization/is_pod.hpp>
 #include <graphlab/serialization/has_load.hpp>
+#include <graphlab/serialization/varint.hpp>
+#include <graphlab/util/branch_hints.hpp>
 namespace graphlab {
 
   /**
@@ -71,6 +73,9 @@ namespace graphlab {
    * The iarchive object should not be used once the associated stream
    * object is closed or is destroyed.
    *
+   * compact must match the compact flag of the oarchive which wrote the
+   * data (see graphlab::oarchive).
+   *
    * To use this class, include
    * graphlab/serialization/serialization_includes.hpp
    */
@@ -80,6 +85,7 @@ namespace graphlab {
     const char* buf;
     size_t off;
     size_t len;
+    bool compact;
 
     /// Directly reads a single character from the input stream
     inline char read_char() {
@@ -106,6 +112,20 @@ namespace graphlab {
       }
     }
 
+    /// Reads a variable length integer
+    inline uint64_t read_varint() {
+      if (buf) return varint_decode(buf, off);
+      uint64_t v = 0;
+      size_t shift = 0;
+      char c;
+      do {
+        in->get(c);
+        v |= uint64_t((unsigned char)c & 0x7f) << shift;
+        shift += 7;
+      } while (c & 0x80);
+      return v;
+    }
+
 
     /// Returns true if the underlying stream is in a failure state
     inline bool fail() {
@@ -119,10 +139,10 @@ namespace graphlab {
      * assiciated input stream.
      */
     inline iarchive(std::istream& instream)
-      : in(&instream), buf(NULL), off(0), len(0) { }
+      : in(&instream), buf(NULL), off(0), len(0), compact(false) { }
 
     inline iarchive(const char* buf, size_t len)
-      : in(NULL), buf(buf), off(0), len(len) { }
+      : in(NULL), buf(buf), off(0), len(len), compact(false) { }
 
     ~iarchive() {}
   };
@@ -212,12 +232,37 @@ namespace graphlab {
       }
     };
 
+    /// The iarchive which does the actual reading
+    inline iarchive& base_archive(iarchive& iarc) { return iarc; }
+    inline iarchive& base_archive(iarchive_soft_fail& iarc) { return *iarc.iarc; }
+
+    /**
+       Reads a POD. Integers are read as varints if the archive is in
+       compact mode.
+    */
+    template <typename InArcType, typename T, bool IsCompactInteger>
+    struct deserialize_pod {
+      inline static void exec(InArcType& iarc, T& t) {
+        iarc.read(reinterpret_cast<char*>(&t), sizeof(T));
+      }
+    };
+
+    template <typename InArcType, typename T>
+    struct deserialize_pod<InArcType, T, true> {
+      inline static void exec(InArcType& iarc, T& t) {
+        if (__unlikely__(base_archive(iarc).compact)) {
+          t = varint_mapping<T>::from_unsigned(base_archive(iarc).read_varint());
+        } else {
+          iarc.read(reinterpret_cast<char*>(&t), sizeof(T));
+        }
+      }
+    };
+
     // catch if type is a POD
     template <typename InArcType, typename T>
     struct deserialize_impl<InArcType, T, true>{
       inline static void exec(InArcType& iarc, T &t) {
-        iarc.read(reinterpret_cast<char*>(&t),
-                  sizeof(T));
+        deserialize_pod<InArcType, T, is_compact_integer<T>::value>::exec(iarc, t);
       }
     };
 
@@ -36,6 +36,7 @@
 #include <graphlab/serialization/is_pod.hpp>
 #include <graphlab/serialization/has_save.hpp>
 #include <graphlab/util/branch_hints.hpp>
+#include <graphlab/serialization/varint.hpp>
 namespace graphlab {
 
   /**
@@ -80,6 +81,12 @@ namespace graphlab {
    * and input, it is necessary to flush the stream before all bytes written to
    * the stringstream are available for input.
    *
+   * If compact is set, integers wider than one byte are written as
+   * variable length integers (see varint.hpp) instead of fixed width
+   * raw bytes. Objects which are serialized as a whole (POD types,
+   * arrays of POD types) are unaffected. The reading iarchive must have
+   * compact set over exactly the same range of the stream.
+   *
    * To use this class, include
    * graphlab/serialization/serialization_includes.hpp
    */
@@ -89,12 +96,13 @@ namespace graphlab {
     char* buf;
     size_t off;
     size_t len;
+    bool compact;
     /// constructor. Takes a generic std::ostream object
     inline oarchive(std::ostream& outstream)
-      : out(&outstream),buf(NULL),off(0),len(0) {}
+      : out(&outstream),buf(NULL),off(0),len(0),compact(false) {}
 
     inline oarchive(void)
-      : out(NULL),buf(NULL),off(0),len(0) {}
+      : out(NULL),buf(NULL),off(0),len(0),compact(false) {}
 
     inline void expand_buf(size_t s) {
         if (__unlikely__(off + s > len)) {
@@ -126,6 +134,17 @@ namespace graphlab {
       }
     }
 
+    /** Writes v as a variable length integer */
+    inline void write_varint(uint64_t v) {
+      if (out == NULL) {
+        expand_buf(MAX_VARINT_BYTES);
+        off += varint_encode(v, buf + off);
+      } else {
+        char tmp[MAX_VARINT_BYTES];
+        out->write(tmp, varint_encode(v, tmp));
+      }
+    }
+
     inline void advance(size_t s) {
       if (out == NULL) {
         expand_buf(s);
@@ -222,10 +241,36 @@ namespace graphlab {
     };
 
     /** Catch if type is a POD */
+    /// The oarchive which does the actual writing
+    inline oarchive& base_archive(oarchive& oarc) { return oarc; }
+    inline oarchive& base_archive(oarchive_soft_fail& oarc) { return *oarc.oarc; }
+
+    /**
+       Writes a POD. Integers are written as varints if the archive is
+       in compact mode.
+    */
+    template <typename OutArcType, typename T, bool IsCompactInteger>
+    struct serialize_pod {
+      inline static void exec(OutArcType& oarc, const T& t) {
+        oarc.direct_assign(t);
+      }
+    };
+
+    template <typename OutArcType, typename T>
+    struct serialize_pod<OutArcType, T, true> {
+      inline static void exec(OutArcType& oarc, const T& t) {
+        if (__unlikely__(base_archive(oarc).compact)) {
+          base_archive(oarc).write_varint(varint_mapping<T>::to_unsigned(t));
+        } else {
+          oarc.direct_assign(t);
+        }
+      }
+    };
+
     template <typename OutArcType, typename T>
     struct serialize_impl<OutArcType, T, true> {
       inline static void exec(OutArcType& oarc, const T& t) {
-        oarc.direct_assign(t);
+        serialize_pod<OutArcType, T, is_compact_integer<T>::value>::exec(oarc, t);
         //oarc.write(reinterpret_cast<const char*>(&t), sizeof(T));
       }
     };
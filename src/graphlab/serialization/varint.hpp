@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+/*
+   This file defines the variable length integer encoding used by the
+   compact mode of the oarchive / iarchive. An integer is written 7 bits
+   at a time, least significant group first, with the high bit of each
+   byte set if more bytes follow. Signed integers are zigzag mapped first
+   so that small negative values are short as well.
+*/
+#ifndef GRAPHLAB_SERIALIZATION_VARINT_HPP
+#define GRAPHLAB_SERIALIZATION_VARINT_HPP
+
+#include <cstddef>
+#include <stdint.h>
+#include <boost/type_traits/is_integral.hpp>
+#include <boost/type_traits/is_signed.hpp>
+
+namespace graphlab {
+
+  /// The longest varint: a 64 bit integer in 7 bit groups
+  static const size_t MAX_VARINT_BYTES = 10;
+
+  /// Maps signed integers to unsigned so that small magnitudes stay small
+  inline uint64_t zigzag_encode(int64_t v) {
+    return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+  }
+
+  /// Inverse of zigzag_encode
+  inline int64_t zigzag_decode(uint64_t v) {
+    return int64_t(v >> 1) ^ -int64_t(v & 1);
+  }
+
+  /**
+   * Writes v to out, which must have room for MAX_VARINT_BYTES.
+   * Returns the number of bytes written.
+   */
+  inline size_t varint_encode(uint64_t v, char* out) {
+    size_t i = 0;
+    while (v >= 0x80) {
+      out[i++] = char(v | 0x80);
+      v >>= 7;
+    }
+    out[i++] = char(v);
+    return i;
+  }
+
+  /**
+   * Reads a varint starting at in + off, advancing off past it.
+   */
+  inline uint64_t varint_decode(const char* in, size_t& off) {
+    uint64_t v = 0;
+    size_t shift = 0;
+    unsigned char c;
+    do {
+      c = (unsigned char)in[off++];
+      v |= uint64_t(c & 0x7f) << shift;
+      shift += 7;
+    } while (c & 0x80);
+    return v;
+  }
+
+  namespace archive_detail {
+
+    /**
+     * True for the integer types which the compact archive mode writes
+     * as varints. Single byte types are always written as is.
+     */
+    template <typename T>
+    struct is_compact_integer {
+      static const bool value = boost::is_integral<T>::value && sizeof(T) > 1;
+    };
+
+    /// Converts an integer to and from the unsigned value stored as a varint
+    template <typename T, bool IsSigned = boost::is_signed<T>::value>
+    struct varint_mapping {
+      static uint64_t to_unsigned(const T& t) { return uint64_t(t); }
+      static T from_unsigned(uint64_t v) { return T(v); }
+    };
+
+    template <typename T>
+    struct varint_mapping<T, true> {
+      static uint64_t to_unsigned(const T& t) { return zigzag_encode(int64_t(t)); }
+      static T from_unsigned(uint64_t v) { return T(zigzag_decode(v)); }
+    };
+
+  } // namespace archive_detail
+} // namespace graphlab
+
+#endif
@@ -361,6 +361,28 @@ namespace graphlab {
       return false;
     }
 
+    /** Searches for the first bit set to true in the range [b, end).
+        If found, sets b to its position and returns true. Otherwise
+        returns false. Only the words overlapping the range are read.
+    */
+    inline bool first_bit_in_range(size_t &b, size_t end) const {
+      if (end > len) end = len;
+      if (b >= end) return false;
+      size_t arrpos, bitpos;
+      bit_to_pos(b, arrpos, bitpos);
+      size_t block = array[arrpos] & (size_t(-1) << bitpos);
+      while (block == 0) {
+        ++arrpos;
+        if (arrpos * (sizeof(size_t) * 8) >= end) return false;
+        block = array[arrpos];
+      }
+      const size_t pos = arrpos * (sizeof(size_t) * 8) +
+          first_bit_in_block(block);
+      if (pos >= end) return false;
+      b = pos;
+      return true;
+    }
+
     ///  Returns the number of bits in this bitset
     inline size_t size() const {
       return len;
@@ -0,0 +1,395 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_UTIL_DENSE_ID_MAP_HPP
+#define GRAPHLAB_UTIL_DENSE_ID_MAP_HPP
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <iterator>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+
+namespace graphlab {
+
+  /**
+   * A map from integer ids to integer values which is either a hash map
+   * of type HashMap, or, when the ids are known to be dense, an array
+   * indexed directly by the id. The mode is chosen with set_dense() while
+   * the map is empty. The interface is the subset of the
+   * graphlab::hopscotch_map interface used for the vertex id maps.
+   *
+   * In dense mode a lookup is a single array load. The array covers the
+   * range of ids from the smallest to the largest one inserted and takes
+   * sizeof(Value) bytes per id of that range, rather than a hashed
+   * (key, value) pair per element: it is only smaller than a hash map
+   * if most of the ids in the range are present. Absent ids are marked
+   * with Value(-1), which can therefore not be stored.
+   *
+   * In dense mode iterators yield copies of the (key, value) pairs:
+   * values must be changed through operator[].
+   *
+   * Both modes serialize to the same format as HashMap, so a map saved
+   * in either mode can be loaded in either mode.
+   *
+   * \tparam Key An unsigned integer type
+   * \tparam Value An unsigned integer type
+   * \tparam HashMap The map used when the ids are not dense
+   */
+  template <typename Key, typename Value, typename HashMap>
+  class dense_id_map {
+  public:
+    typedef Key                                      key_type;
+    typedef std::pair<Key, Value>                    value_type;
+    typedef Value                                    mapped_type;
+    typedef size_t                                   size_type;
+
+    struct const_iterator {
+      typedef std::forward_iterator_tag iterator_category;
+      typedef const typename dense_id_map::value_type value_type;
+      typedef size_t difference_type;
+      typedef value_type* pointer;
+      typedef value_type& reference;
+
+      friend class dense_id_map;
+
+      const dense_id_map* ptr;
+      mutable typename HashMap::const_iterator iter;
+      size_t idx;
+      mutable typename dense_id_map::value_type cur;
+
+      const_iterator(): ptr(NULL), idx(0) { }
+
+      const_iterator operator++() {
+        if (ptr->dense) idx = ptr->next_present(idx + 1);
+        else ++iter;
+        return *this;
+      }
+
+      const_iterator operator++(int) {
+        const_iterator it = *this;
+        ++(*this);
+        return it;
+      }
+
+      reference operator*() const {
+        if (!ptr->dense) return *iter;
+        cur.first = ptr->base + idx;
+        cur.second = ptr->table[idx];
+        return cur;
+      }
+
+      pointer operator->() const {
+        return &(**this);
+      }
+
+      bool operator==(const const_iterator it) const {
+        return ptr == it.ptr &&
+            (ptr == NULL || (ptr->dense ? idx == it.idx : iter == it.iter));
+      }
+
+      bool operator!=(const const_iterator it) const {
+        return !((*this) == it);
+      }
+    private:
+      const_iterator(const dense_id_map* map,
+                     typename HashMap::const_iterator iter, size_t idx):
+        ptr(map), iter(iter), idx(idx) { }
+    };
+
+    struct iterator {
+      typedef std::forward_iterator_tag iterator_category;
+      typedef typename dense_id_map::value_type value_type;
+      typedef size_t difference_type;
+      typedef value_type* pointer;
+      typedef value_type& reference;
+
+      friend class dense_id_map;
+
+      dense_id_map* ptr;
+      mutable typename HashMap::iterator iter;
+      size_t idx;
+      mutable value_type cur;
+
+      iterator(): ptr(NULL), idx(0) { }
+
+      operator const_iterator() const {
+        return const_iterator(ptr, iter, idx);
+      }
+
+      iterator operator++() {
+        if (ptr->dense) idx = ptr->next_present(idx + 1);
+        else ++iter;
+        return *this;
+      }
+
+      iterator operator++(int) {
+        iterator it = *this;
+        ++(*this);
+        return it;
+      }
+
+      reference operator*() const {
+        if (!ptr->dense) return *iter;
+        cur.first = ptr->base + idx;
+        cur.second = ptr->table[idx];
+        return cur;
+      }
+
+      pointer operator->() const {
+        return &(**this);
+      }
+
+      bool operator==(const iterator it) const {
+        return ptr == it.ptr &&
+            (ptr == NULL || (ptr->dense ? idx == it.idx : iter == it.iter));
+      }
+
+      bool operator!=(const iterator it) const {
+        return !((*this) == it);
+      }
+    private:
+      iterator(dense_id_map* map, typename HashMap::iterator iter, size_t idx):
+        ptr(map), iter(iter), idx(idx) { }
+    };
+
+  private:
+    static Value absent() { return Value(-1); }
+
+    bool dense;
+    // dense mode: the value of each id base + i, absent() if not present
+    std::vector<Value> table;
+    size_t base;
+    size_t numel;
+    // hashed mode
+    HashMap hash;
+
+    size_t next_present(size_t idx) const {
+      while (idx < table.size() && table[idx] == absent()) ++idx;
+      return idx;
+    }
+
+    // dense mode: the index of key k in the table, or table.size() if
+    // k is outside of the range of the table
+    size_t index(key_type k) const {
+      return size_t(k) >= base && size_t(k) - base < table.size() ?
+          size_t(k) - base : table.size();
+    }
+
+    // dense mode: the slot of key k, growing the table if necessary
+    Value& slot(key_type k) {
+      if (table.empty()) {
+        base = k;
+      } else if (size_t(k) < base) {
+        // grow the front at least geometrically so that inserting
+        // decreasing ids takes amortized constant time
+        const size_t grow = std::max(base - size_t(k),
+                                     std::min(base, table.size()));
+        table.insert(table.begin(), grow, absent());
+        base -= grow;
+      }
+      const size_t idx = size_t(k) - base;
+      if (idx >= table.size()) table.resize(idx + 1, absent());
+      return table[idx];
+    }
+
+  public:
+    dense_id_map(): dense(false), numel(0), base(0) { }
+
+    /**
+     * Switches between direct indexing (if true) and hashing of the ids.
+     * The map must be empty.
+     */
+    void set_dense(bool d) {
+      ASSERT_EQ(size(), 0);
+      dense = d;
+      std::vector<Value>().swap(table);
+      hash.clear();
+    }
+
+    bool is_dense() const {
+      return dense;
+    }
+
+    size_type size() const {
+      return dense ? numel : hash.size();
+    }
+
+    bool empty() const {
+      return size() == 0;
+    }
+
+    iterator begin() {
+      return iterator(this, hash.begin(), dense ? next_present(0) : 0);
+    }
+
+    iterator end() {
+      return iterator(this, hash.end(), table.size());
+    }
+
+    const_iterator begin() const {
+      return const_iterator(this, hash.begin(), dense ? next_present(0) : 0);
+    }
+
+    const_iterator end() const {
+      return const_iterator(this, hash.end(), table.size());
+    }
+
+    iterator find(key_type const& k) {
+      if (!dense) return iterator(this, hash.find(k), 0);
+      const size_t idx = index(k);
+      if (idx < table.size() && table[idx] != absent()) {
+        return iterator(this, hash.end(), idx);
+      }
+      return end();
+    }
+
+    const_iterator find(key_type const& k) const {
+      if (!dense) return const_iterator(this, hash.find(k), 0);
+      const size_t idx = index(k);
+      if (idx < table.size() && table[idx] != absent()) {
+        return const_iterator(this, hash.end(), idx);
+      }
+      return end();
+    }
+
+    size_t count(key_type const& k) const {
+      if (!dense) return hash.count(k);
+      const size_t idx = index(k);
+      return idx < table.size() && table[idx] != absent();
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) {
+      if (!dense) {
+        std::pair<typename HashMap::iterator, bool> ret = hash.insert(v);
+        return std::make_pair(iterator(this, ret.first, 0), ret.second);
+      }
+      ASSERT_NE(v.second, absent());
+      Value& s = slot(v.first);
+      const bool inserted = (s == absent());
+      if (inserted) {
+        s = v.second;
+        ++numel;
+      }
+      return std::make_pair(iterator(this, hash.end(), v.first - base),
+                            inserted);
+    }
+
+    mapped_type& operator[](const key_type& k) {
+      if (!dense) return hash[k];
+      Value& s = slot(k);
+      if (s == absent()) {
+        s = mapped_type();
+        ++numel;
+      }
+      return s;
+    }
+
+    bool erase(key_type const& k) {
+      if (!dense) return hash.erase(k);
+      const size_t idx = index(k);
+      if (idx >= table.size() || table[idx] == absent()) return false;
+      table[idx] = absent();
+      --numel;
+      return true;
+    }
+
+    void swap(dense_id_map& other) {
+      std::swap(dense, other.dense);
+      table.swap(other.table);
+      std::swap(numel, other.numel);
+      std::swap(base, other.base);
+      hash.swap(other.hash);
+    }
+
+    /// Removes all elements and releases the memory. Keeps the mode.
+    void clear() {
+      std::vector<Value>().swap(table);
+      numel = 0;
+      hash.clear();
+    }
+
+    /// Ensures that dense mode ids below n can be inserted without growing
+    void reserve(size_t n) {
+      if (!dense || n == 0) return;
+      slot(0); // extends the array down to id 0
+      if (n > table.size()) table.resize(n, absent());
+    }
+
+    /// Prepares a hashed map for n elements. Does nothing in dense mode.
+    void rehash(size_t n) {
+      if (!dense) hash.rehash(n);
+    }
+
+    /**
+     * The number of ids spanned by the array in dense mode: the largest
+     * minus the smallest id inserted, plus one. 0 in hashed mode.
+     */
+    size_t span() const {
+      return table.size();
+    }
+
+    size_t capacity() const {
+      return dense ? table.capacity() : hash.capacity();
+    }
+
+    float load_factor() const {
+      return float(size()) / capacity();
+    }
+
+    /// The approximate number of bytes used by the map
+    size_t estimate_sizeof() const {
+      return sizeof(dense_id_map) + table.capacity() * sizeof(Value) +
+          hash.capacity() * sizeof(value_type);
+    }
+
+    void save(oarchive &oarc) const {
+      if (!dense) {
+        oarc << hash;
+        return;
+      }
+      oarc << size() << capacity();
+      for (const_iterator iter = begin(); iter != end(); ++iter) {
+        oarc << (*iter);
+      }
+    }
+
+    void load(iarchive &iarc) {
+      if (!dense) {
+        iarc >> hash;
+        return;
+      }
+      size_t s, c;
+      iarc >> s >> c;
+      clear();
+      for (size_t i = 0;i < s; ++i) {
+        value_type v;
+        iarc >> v;
+        insert(v);
+      }
+    }
+  };
+
+}; // end of graphlab namespace
+
+#endif
@@ -35,6 +35,7 @@ extern "C" {
 
 
 #include <graphlab/logger/assertions.hpp>
+#include <graphlab/util/prefetch_stream.hpp>
 
 
 namespace graphlab {
@@ -102,6 +103,33 @@ namespace graphlab {
      */
     typedef boost::iostreams::stream<hdfs_device> fstream;
 
+    /**
+     * A file opened for reading at arbitrary offsets. Read through a
+     * graphlab::prefetch_device, which hides the latency of each read.
+     */
+    class hdfs_file : public random_access_file {
+    private:
+      hdfsFS filesystem;
+      hdfsFile file;
+      size_t filesize;
+    public:
+      hdfs_file(const hdfs& hdfs_fs, const std::string& filename) :
+        filesystem(hdfs_fs.filesystem) {
+        ASSERT_TRUE(filesystem != NULL);
+        file = hdfsOpenFile(filesystem, filename.c_str(), O_RDONLY, 0, 0, 0);
+        ASSERT_TRUE(file != NULL);
+        filesize = hdfs_fs.file_size(filename);
+      }
+      ~hdfs_file() {
+        const int close_error = hdfsCloseFile(filesystem, file);
+        ASSERT_EQ(close_error, 0);
+      }
+      size_t size() const { return filesize; }
+      std::streamsize pread(char* buf, size_t n, size_t offset) {
+        return hdfsPread(filesystem, file, offset, buf, n);
+      }
+    }; // end of hdfs_file
+
     /**
      * Open a connection to the filesystem. The default arguments
      * should be sufficient for most uses 
@@ -129,6 +157,14 @@ namespace graphlab {
       return files;
     } // end of list_files
 
+    inline size_t file_size(const std::string& path) const {
+      hdfsFileInfo* info = hdfsGetPathInfo(filesystem, path.c_str());
+      ASSERT_TRUE(info != NULL);
+      const size_t size = info->mSize;
+      hdfsFreeFileInfo(info, 1);
+      return size;
+    } // end of file_size
+
     inline static bool has_hadoop() { return true; }
     
     static hdfs& get_hdfs();
@@ -169,6 +205,20 @@ namespace graphlab {
      */
     typedef boost::iostreams::stream<hdfs_device> fstream;
 
+    class hdfs_file : public random_access_file {
+    public:
+      hdfs_file(const hdfs& hdfs_fs, const std::string& filename) {
+        logstream(LOG_FATAL) << "Libhdfs is not installed on this system." 
+                             << std::endl;
+      }
+      size_t size() const { return 0; }
+      std::streamsize pread(char* buf, size_t n, size_t offset) {
+        logstream(LOG_FATAL) << "Libhdfs is not installed on this system." 
+                             << std::endl;
+        return 0;
+      }
+    }; // end of hdfs_file
+
     /**
      * Open a connection to the filesystem. The default arguments
      * should be sufficient for most uses 
@@ -186,6 +236,12 @@ namespace graphlab {
       return std::vector<std::string>();;
     } // end of list_files
 
+    inline size_t file_size(const std::string& path) const {
+      logstream(LOG_FATAL) << "Libhdfs is not installed on this system." 
+                           << std::endl;
+      return 0;
+    } // end of file_size
+
     // No hadoop available
     inline static bool has_hadoop() { return false; }
     
@@ -21,14 +21,28 @@
  */
 
 #include <iostream>
+#include <sstream>
 #ifdef HAS_TCMALLOC
 #include <google/malloc_extension.h>
 #endif
+#include <graphlab/util/memory_info.hpp>
+#include <graphlab/parallel/atomic.hpp>
 #include <graphlab/logger/assertions.hpp>
 
 namespace graphlab {
   namespace memory_info {
 
+    namespace {
+      const char* CATEGORY_NAME[NUM_MEMORY_CATEGORIES] = {
+        "graph structure", "vertex data", "edge data", "gather cache",
+        "message arrays", "rpc buffers", "scheduler"
+      };
+
+      // Frees may be counted before the matching allocations reach
+      // memory, so the counters may transiently wrap below zero.
+      atomic<size_t> category_counter[NUM_MEMORY_CATEGORIES];
+    } // end of anonymous namespace
+
     bool available() {
 #ifdef HAS_TCMALLOC
       return true;
@@ -68,35 +82,77 @@ namespace graphlab {
 
 
 
+    const char* category_name(memory_category category) {
+      ASSERT_LT(category, NUM_MEMORY_CATEGORIES);
+      return CATEGORY_NAME[category];
+    } // end of category name
+
+
+
+    void track_alloc(memory_category category, size_t bytes) {
+      if (category < NUM_MEMORY_CATEGORIES) {
+        category_counter[category].inc(bytes);
+      }
+    } // end of track alloc
+
+
+
+    void track_free(memory_category category, size_t bytes) {
+      if (category < NUM_MEMORY_CATEGORIES) {
+        category_counter[category].dec(bytes);
+      }
+    } // end of track free
+
+
+
+    size_t category_bytes(memory_category category) {
+      ASSERT_LT(category, NUM_MEMORY_CATEGORIES);
+      const size_t value = category_counter[category].value;
+      return value > (size_t(-1) >> 1) ? 0 : value;
+    } // end of category bytes
+
+
+
+    size_t tracked_bytes() {
+      size_t total = 0;
+      for (size_t i = 0; i < NUM_MEMORY_CATEGORIES; ++i) {
+        total += category_bytes(memory_category(i));
+      }
+      return total;
+    } // end of tracked bytes
+
+
+
     void print_usage(const std::string& label) {
-#ifdef HAS_TCMALLOC
         const double BYTES_TO_MB = double(1) / double(1024 * 1024);
+        std::cout << "Memory Info: " << label << std::endl;
+        for (size_t i = 0; i < NUM_MEMORY_CATEGORIES; ++i) {
+          std::cout << "\t " << CATEGORY_NAME[i] << ": "
+                    << (category_bytes(memory_category(i)) * BYTES_TO_MB)
+                    << " MB" << std::endl;
+        }
+#ifdef HAS_TCMALLOC
         std::cout
-          << "Memory Info: " << label << std::endl
           << "\t Heap: " << (heap_bytes() * BYTES_TO_MB) << " MB"
           << std::endl
           << "\t Allocated: " << (allocated_bytes() * BYTES_TO_MB) << " MB"
           << std::endl;
-#else
-        logstream_once(LOG_WARNING)
-          << "Unable to print memory info for: " << label << ". "
-          << "No memory extensions api available." << std::endl;
 #endif
     } // end of print_usage
 
     void log_usage(const std::string& label) {
-#ifdef HAS_TCMALLOC
         const double BYTES_TO_MB = double(1) / double(1024 * 1024);
-        logstream(LOG_INFO)
-          << "Memory Info: " << label
-          << "\n\t Heap: " << (heap_bytes() * BYTES_TO_MB) << " MB"
-          << "\n\t Allocated: " << (allocated_bytes() * BYTES_TO_MB) << " MB"
-          << std::endl;
-#else
-        logstream_once(LOG_WARNING)
-          << "Unable to print memory info for: " << label << ". "
-          << "No memory extensions api available." << std::endl;
+        std::stringstream strm;
+        strm << "Memory Info: " << label;
+        for (size_t i = 0; i < NUM_MEMORY_CATEGORIES; ++i) {
+          strm << "\n\t " << CATEGORY_NAME[i] << ": "
+               << (category_bytes(memory_category(i)) * BYTES_TO_MB) << " MB";
+        }
+#ifdef HAS_TCMALLOC
+        strm << "\n\t Heap: " << (heap_bytes() * BYTES_TO_MB) << " MB"
+             << "\n\t Allocated: " << (allocated_bytes() * BYTES_TO_MB) << " MB";
 #endif
+        logstream(LOG_INFO) << strm.str() << std::endl;
     } // end of log usage
 
 
@@ -23,6 +23,9 @@
 #ifndef GRAPHLAB_MEMORY_INFO_HPP
 #define GRAPHLAB_MEMORY_INFO_HPP
 
+#include <cstddef>
+#include <string>
+
 namespace graphlab {
   /**
    * \internal \brief Memory info namespace contains functions used to
@@ -83,6 +86,120 @@ namespace graphlab {
      * @param [in] label the string to print before the memory usage summary.
      */
     void log_usage(const std::string& label = "");
+
+
+
+    /**
+     * \internal
+     *
+     * \brief The subsystems memory usage is accounted to.
+     *
+     * Unlike heap_bytes() and allocated_bytes() the per category
+     * accounting does not depend on TCMalloc. Each subsystem reports
+     * the size of its large data structures as they are allocated,
+     * resized and freed. The metrics server page memory.json gathers
+     * the categories of every machine from the distributed event log
+     * when it is served.
+     *
+     * RPC_BUFFERS counts the idle buffers held by the RPC buffer pool
+     * and the received buffered_exchange data kept serialized. Buffers
+     * in use by the RPC layer (being filled, sent or handled) are
+     * realloc'ed and freed outside the pool and are not counted.
+     */
+    enum memory_category {
+      GRAPH_STRUCTURE = 0,  ///< adjacency, vertex records and id maps
+      VERTEX_DATA,          ///< the vertex data array
+      EDGE_DATA,            ///< the edge data array
+      GATHER_CACHE,         ///< the engines' gather caches
+      MESSAGE_ARRAYS,       ///< the engines' message arrays
+      RPC_BUFFERS,          ///< idle communication buffers
+      SCHEDULER,            ///< the schedulers' queues and bitsets
+      NUM_MEMORY_CATEGORIES,
+      UNTRACKED = NUM_MEMORY_CATEGORIES  ///< not accounted to a category
+    };
+
+    /**
+     * \internal
+     * \brief Returns a printable name of the category.
+     */
+    const char* category_name(memory_category category);
+
+    /**
+     * \internal
+     * \brief Accounts bytes allocated to a category. Thread safe.
+     * Has no effect for UNTRACKED.
+     */
+    void track_alloc(memory_category category, size_t bytes);
+
+    /**
+     * \internal
+     * \brief Accounts bytes freed from a category. Thread safe.
+     * Has no effect for UNTRACKED.
+     */
+    void track_free(memory_category category, size_t bytes);
+
+    /**
+     * \internal
+     * \brief Returns the number of bytes currently accounted to a
+     * category on this machine.
+     */
+    size_t category_bytes(memory_category category);
+
+    /**
+     * \internal
+     * \brief Returns the number of bytes accounted to all categories on
+     * this machine.
+     */
+    size_t tracked_bytes();
+
+    /**
+     * \internal
+     *
+     * \brief The size of a data structure accounted to a category.
+     *
+     * The owner of the data structure calls set() with the new size
+     * whenever it is resized, and the category is adjusted by the
+     * difference. The size is removed from the category when the
+     * tracked_size is destroyed. set() is not thread safe for a given
+     * tracked_size.
+     *
+     * \code
+     * memory_info::tracked_size messages_size(memory_info::MESSAGE_ARRAYS);
+     * messages.resize(nverts);
+     * messages_size.set(messages.capacity() * sizeof(message_type));
+     * \endcode
+     */
+    class tracked_size {
+    public:
+      explicit tracked_size(memory_category category = UNTRACKED) :
+        category(category), bytes(0) { }
+
+      tracked_size(const tracked_size& other) :
+        category(other.category), bytes(0) {
+        set(other.bytes);
+      }
+
+      tracked_size& operator=(const tracked_size& other) {
+        set(other.bytes);
+        return *this;
+      }
+
+      ~tracked_size() { set(0); }
+
+      /// Sets the size of the data structure
+      void set(size_t newbytes) {
+        if (newbytes > bytes) track_alloc(category, newbytes - bytes);
+        else if (newbytes < bytes) track_free(category, bytes - newbytes);
+        bytes = newbytes;
+      }
+
+      /// Returns the size of the data structure
+      size_t value() const { return bytes; }
+
+    private:
+      memory_category category;
+      size_t bytes;
+    };
   } // end of namespace memory info
 };
 
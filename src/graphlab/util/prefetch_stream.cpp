@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <graphlab/util/prefetch_stream.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/logger/logger.hpp>
+
+namespace graphlab {
+
+  posix_random_access_file::posix_random_access_file(const std::string& filename) {
+    fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      logstream(LOG_FATAL) << "Unable to open " << filename << ": "
+                           << strerror(errno) << std::endl;
+    }
+    struct stat st;
+    ASSERT_EQ(fstat(fd, &st), 0);
+    filesize = st.st_size;
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  }
+
+  posix_random_access_file::~posix_random_access_file() {
+    close(fd);
+  }
+
+  std::streamsize posix_random_access_file::pread(char* buf, size_t n,
+                                                  size_t offset) {
+    ssize_t ret;
+    do {
+      ret = ::pread(fd, buf, n, offset);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+  }
+
+
+  /**
+   * The state shared by the copies of a prefetch_device. A background
+   * thread reads the blocks of the range into a queue, and read() hands
+   * them out, skipping the partial line at the start of the range and
+   * reading the partial line at the end of it directly from the file.
+   */
+  class prefetch_reader {
+  public:
+    prefetch_reader(random_access_file* file, size_t begin, size_t end,
+                    size_t block_size, size_t nblocks)
+      : file(file), block_size(std::max<size_t>(block_size, 1)),
+        nblocks(std::max<size_t>(nblocks, 1)),
+        end(std::min(end, file->size())),
+        read_start(begin > 0 ? std::min(begin - 1, this->end) : 0),
+        stopping(false), producer_done(false), error(false),
+        cur(NULL), cur_pos(0), last_byte('\n'),
+        state(begin > 0 ? SKIPPING : BODY), tail_pos(0) {
+      fetcher.launch(boost::bind(&prefetch_reader::fetch_loop, this));
+    }
+
+    ~prefetch_reader() {
+      lock.lock();
+      stopping = true;
+      not_full.signal();
+      lock.unlock();
+      fetcher.join();
+      delete cur;
+      for (size_t i = 0; i < full.size(); ++i) delete full[i];
+      for (size_t i = 0; i < free_blocks.size(); ++i) delete free_blocks[i];
+      delete file;
+    }
+
+    std::streamsize read(char* out, std::streamsize n) {
+      std::streamsize copied = 0;
+      while (copied < n && state != FINISHED) {
+        if (state == TAIL) {
+          copied += read_tail(out + copied, n - copied);
+          continue;
+        }
+        if (cur == NULL || cur_pos == cur->size()) {
+          if (!next_block()) {
+            // the line the range ends in is finished by reading on
+            if (state == SKIPPING || last_byte == '\n' ||
+                end >= file->size()) {
+              state = FINISHED;
+            } else {
+              state = TAIL;
+              tail_pos = end;
+            }
+          }
+          continue;
+        }
+        const char* data = &(*cur)[0];
+        if (state == SKIPPING) {
+          const char* newline = reinterpret_cast<const char*>(
+              memchr(data + cur_pos, '\n', cur->size() - cur_pos));
+          if (newline == NULL) {
+            cur_pos = cur->size();
+          } else {
+            cur_pos = newline - data + 1;
+            state = BODY;
+          }
+          continue;
+        }
+        const size_t len = std::min<size_t>(n - copied, cur->size() - cur_pos);
+        memcpy(out + copied, data + cur_pos, len);
+        cur_pos += len;
+        copied += len;
+      }
+      return copied == 0 ? -1 : copied;
+    }
+
+  private:
+    enum read_state { SKIPPING, BODY, TAIL, FINISHED };
+
+    void fetch_loop() {
+      size_t pos = read_start;
+      while (pos < end) {
+        std::vector<char>* block = NULL;
+        lock.lock();
+        while (full.size() >= nblocks && !stopping) not_full.wait(lock);
+        if (stopping) {
+          lock.unlock();
+          break;
+        }
+        if (!free_blocks.empty()) {
+          block = free_blocks.back();
+          free_blocks.pop_back();
+        }
+        lock.unlock();
+        if (block == NULL) block = new std::vector<char>();
+        const size_t len = std::min(block_size, end - pos);
+        block->resize(len);
+        size_t got = 0;
+        while (got < len) {
+          const std::streamsize ret = file->pread(&(*block)[got], len - got,
+                                                  pos + got);
+          if (ret <= 0) break;
+          got += ret;
+        }
+        lock.lock();
+        if (got < len) {
+          delete block;
+          error = true;
+          lock.unlock();
+          break;
+        }
+        full.push_back(block);
+        not_empty.signal();
+        lock.unlock();
+        pos += len;
+      }
+      lock.lock();
+      producer_done = true;
+      not_empty.signal();
+      lock.unlock();
+    }
+
+    // Moves on to the next prefetched block. Returns false at the end of
+    // the range.
+    bool next_block() {
+      lock.lock();
+      if (cur != NULL) free_blocks.push_back(cur);
+      cur = NULL;
+      while (full.empty() && !producer_done) not_empty.wait(lock);
+      if (error) {
+        lock.unlock();
+        logstream(LOG_FATAL) << "Error reading file" << std::endl;
+      }
+      if (full.empty()) {
+        lock.unlock();
+        return false;
+      }
+      cur = full.front();
+      full.pop_front();
+      not_full.signal();
+      lock.unlock();
+      cur_pos = 0;
+      last_byte = cur->back();
+      return true;
+    }
+
+    // Reads the rest of the last line, which is past the end of the range
+    std::streamsize read_tail(char* out, size_t n) {
+      std::streamsize ret = file->pread(out, n, tail_pos);
+      if (ret < 0) {
+        logstream(LOG_FATAL) << "Error reading file" << std::endl;
+      }
+      if (ret == 0) {
+        state = FINISHED;
+        return 0;
+      }
+      const char* newline = reinterpret_cast<const char*>(
+          memchr(out, '\n', ret));
+      if (newline != NULL) {
+        ret = newline - out + 1;
+        state = FINISHED;
+      }
+      tail_pos += ret;
+      return ret;
+    }
+
+    random_access_file* file;
+    const size_t block_size;
+    const size_t nblocks;
+    const size_t end;
+    const size_t read_start;
+
+    thread fetcher;
+    mutex lock;
+    conditional not_empty, not_full;
+    /// blocks read and not yet consumed, in order
+    std::deque<std::vector<char>*> full;
+    /// consumed blocks, reused by the fetcher
+    std::vector<std::vector<char>*> free_blocks;
+    bool stopping, producer_done, error;
+
+    // consumer state
+    std::vector<char>* cur;
+    size_t cur_pos;
+    char last_byte;
+    read_state state;
+    size_t tail_pos;
+  };
+
+
+  prefetch_device::prefetch_device(random_access_file* file,
+                                   size_t begin, size_t end,
+                                   size_t block_size, size_t nblocks)
+    : reader(new prefetch_reader(file, begin, end, block_size, nblocks)) { }
+
+  std::streamsize prefetch_device::read(char* buf, std::streamsize n) {
+    return reader->read(buf, n);
+  }
+
+
+  void split_files(const std::vector<std::string>& files,
+                   const std::vector<size_t>& sizes,
+                   size_t split_size,
+                   std::vector<file_split>& splits) {
+    ASSERT_EQ(files.size(), sizes.size());
+    splits.clear();
+    for (size_t i = 0; i < files.size(); ++i) {
+      const bool gzip = boost::ends_with(files[i], ".gz");
+      if (gzip || split_size == 0 || sizes[i] <= split_size) {
+        splits.push_back(file_split(files[i], 0, sizes[i]));
+        continue;
+      }
+      const size_t nsplits = (sizes[i] + split_size - 1) / split_size;
+      for (size_t j = 0; j < nsplits; ++j) {
+        splits.push_back(file_split(files[i], sizes[i] * j / nsplits,
+                                    sizes[i] * (j + 1) / nsplits));
+      }
+    }
+  }
+
+} // namespace graphlab
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_PREFETCH_STREAM_HPP
+#define GRAPHLAB_PREFETCH_STREAM_HPP
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <boost/shared_ptr.hpp>
+#include <boost/iostreams/stream.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup util
+   * A file which can be read at arbitrary offsets. Implemented for the
+   * local filesystem by posix_random_access_file, and for HDFS by
+   * hdfs::hdfs_file.
+   */
+  class random_access_file {
+  public:
+    virtual ~random_access_file() { }
+
+    /// The size of the file in bytes
+    virtual size_t size() const = 0;
+
+    /**
+     * Reads up to n bytes starting at offset into buf. Returns the
+     * number of bytes read, 0 at the end of the file, and a negative
+     * value on error. Must be safe to call concurrently with itself.
+     */
+    virtual std::streamsize pread(char* buf, size_t n, size_t offset) = 0;
+  };
+
+
+  /**
+   * \ingroup util
+   * A random_access_file on the local filesystem.
+   */
+  class posix_random_access_file : public random_access_file {
+  public:
+    explicit posix_random_access_file(const std::string& filename);
+    ~posix_random_access_file();
+    size_t size() const { return filesize; }
+    std::streamsize pread(char* buf, size_t n, size_t offset);
+  private:
+    // not copyable
+    posix_random_access_file(const posix_random_access_file&);
+    posix_random_access_file& operator=(const posix_random_access_file&);
+
+    int fd;
+    size_t filesize;
+  };
+
+
+  class prefetch_reader;
+
+  /**
+   * \ingroup util
+   * A boost iostreams source reading a byte range of a random_access_file
+   * with a background thread which keeps nblocks blocks of block_size
+   * bytes read ahead of the consumer. This hides the latency of each
+   * read, which dominates on remote filesystems such as HDFS.
+   *
+   * The byte range [begin, end) is read as a split of a line oriented
+   * file: a split which does not start the file skips the line it starts
+   * in, and the last line is read past end to its end. A line is thus
+   * read by exactly the one split it starts in, and the splits of a file
+   * can be loaded independently.
+   *
+   * The device is copyable; copies share the reader.
+   */
+  class prefetch_device {
+  public:
+    typedef char char_type;
+    struct category :
+      public boost::iostreams::source_tag,
+      public boost::iostreams::optimally_buffered_tag { };
+
+    /// The default size of a read-ahead block
+    static const size_t DEFAULT_BLOCK_SIZE = 4 * 1024 * 1024;
+    /// The default number of blocks read ahead
+    static const size_t DEFAULT_NBLOCKS = 4;
+
+    /**
+     * Reads [begin, end) of file, which the device takes ownership of.
+     * end is clipped to the size of the file.
+     */
+    explicit prefetch_device(random_access_file* file,
+                             size_t begin = 0, size_t end = size_t(-1),
+                             size_t block_size = DEFAULT_BLOCK_SIZE,
+                             size_t nblocks = DEFAULT_NBLOCKS);
+
+    std::streamsize read(char* buf, std::streamsize n);
+
+    std::streamsize optimal_buffer_size() const { return 64 * 1024; }
+
+  private:
+    boost::shared_ptr<prefetch_reader> reader;
+  };
+
+  typedef boost::iostreams::stream<prefetch_device> prefetch_stream;
+
+
+  /**
+   * \ingroup util
+   * A byte range of a file, read with a prefetch_device.
+   */
+  struct file_split {
+    std::string filename;
+    size_t begin, end;
+    file_split(const std::string& filename = "",
+               size_t begin = 0, size_t end = 0)
+      : filename(filename), begin(begin), end(end) { }
+  };
+
+  /// The default size of the splits made by split_files()
+  const size_t DEFAULT_SPLIT_SIZE = 128 * 1024 * 1024;
+
+  /**
+   * Splits each of the files, whose sizes are given in sizes, into ranges
+   * of about split_size bytes which can be loaded in parallel. Compressed
+   * (.gz) files cannot be split and are returned whole.
+   */
+  void split_files(const std::vector<std::string>& files,
+                   const std::vector<size_t>& sizes,
+                   size_t split_size,
+                   std::vector<file_split>& splits);
+
+} // namespace graphlab
+
+#endif
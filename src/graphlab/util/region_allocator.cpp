@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <sys/mman.h>
+#include <graphlab/util/region_allocator.hpp>
+#include <graphlab/logger/logger.hpp>
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+namespace graphlab {
+
+  namespace {
+    // Every allocation is prefixed by a pointer to its chunk. The prefix
+    // is padded to keep allocations 16 byte aligned.
+    const size_t ALLOC_HEADER = 16;
+    const size_t ALIGNMENT = 16;
+    // the chunk header, rounded up to the alignment
+    inline size_t chunk_header_size(size_t header) {
+      return (header + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+  } // anonymous namespace
+
+  const size_t region_allocator::DEFAULT_CHUNK_SIZE;
+
+  region_allocator::region_allocator(size_t chunk_size,
+                                     memory_info::memory_category category)
+    : chunk_size(chunk_size), category(category),
+      chunks(NULL), current(NULL), mapped(0) { }
+
+
+  region_allocator::chunk* region_allocator::map_chunk(size_t size) {
+    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      logstream(LOG_FATAL) << "region_allocator: unable to map "
+                           << size << " bytes" << std::endl;
+    }
+    chunk* c = reinterpret_cast<chunk*>(ptr);
+    c->size = size;
+    c->used = chunk_header_size(sizeof(chunk));
+    c->live = 0;
+    c->prev = NULL;
+    c->next = chunks;
+    if (chunks) chunks->prev = c;
+    chunks = c;
+    mapped += size;
+    memory_info::track_alloc(category, size);
+    return c;
+  }
+
+
+  void region_allocator::unmap_chunk(chunk* c) {
+    if (c->prev) c->prev->next = c->next;
+    else chunks = c->next;
+    if (c->next) c->next->prev = c->prev;
+    if (c == current) current = NULL;
+    mapped -= c->size;
+    memory_info::track_free(category, c->size);
+    munmap(c, c->size);
+  }
+
+
+  void* region_allocator::allocate(size_t bytes) {
+    const size_t needed = ALLOC_HEADER + ((bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1));
+    const size_t header = chunk_header_size(sizeof(chunk));
+    lock.lock();
+    chunk* c = current;
+    if (header + needed > chunk_size) {
+      // too large to share a chunk
+      c = map_chunk(header + needed);
+    } else if (c == NULL || c->used + needed > c->size) {
+      // retire the current chunk. It is unmapped by the last deallocate
+      if (current != NULL && current->live == 0) unmap_chunk(current);
+      current = map_chunk(chunk_size);
+      c = current;
+    }
+    char* ret = reinterpret_cast<char*>(c) + c->used;
+    c->used += needed;
+    ++c->live;
+    lock.unlock();
+    *reinterpret_cast<chunk**>(ret) = c;
+    return ret + ALLOC_HEADER;
+  }
+
+
+  void region_allocator::deallocate(void* ptr) {
+    if (ptr == NULL) return;
+    chunk* c = *reinterpret_cast<chunk**>(reinterpret_cast<char*>(ptr) - ALLOC_HEADER);
+    lock.lock();
+    ASSERT_GT(c->live, 0);
+    --c->live;
+    if (c->live == 0 && c != current) unmap_chunk(c);
+    lock.unlock();
+  }
+
+
+  void region_allocator::release() {
+    lock.lock();
+    while (chunks != NULL) unmap_chunk(chunks);
+    current = NULL;
+    lock.unlock();
+  }
+
+} // namespace graphlab
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_REGION_ALLOCATOR_HPP
+#define GRAPHLAB_REGION_ALLOCATOR_HPP
+
+#include <vector>
+#include <algorithm>
+#include <new>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/util/memory_info.hpp>
+#include <graphlab/logger/assertions.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup util
+   * A region allocator for large, short lived buffers such as the ones
+   * used while constructing a graph. Memory is mapped directly from the
+   * system in large chunks and handed out by bumping a pointer.
+   *
+   * Each chunk counts its live allocations and is returned to the system
+   * as soon as they are all deallocated, so a region which is consumed
+   * roughly in the order it was filled (a queue of received buffers, an
+   * edge list being copied into its final arrays) gives memory back while
+   * it drains. release() returns everything at once.
+   *
+   * Unlike buffers from malloc, the chunks never stay behind in a
+   * fragmented heap, which keeps the peak resident size of graph
+   * construction close to the size of the data.
+   *
+   * The mapped chunks are accounted to a memory_info category.
+   *
+   * allocate() and deallocate() are thread safe.
+   */
+  class region_allocator {
+  public:
+    /// The default size of a chunk mapped from the system
+    static const size_t DEFAULT_CHUNK_SIZE = 4 * 1024 * 1024;
+
+    explicit region_allocator(size_t chunk_size = DEFAULT_CHUNK_SIZE,
+                              memory_info::memory_category category =
+                                  memory_info::UNTRACKED);
+
+    ~region_allocator() { release(); }
+
+    /**
+     * Returns bytes of memory aligned to 16 bytes. Allocations larger
+     * than a chunk get a chunk of their own.
+     */
+    void* allocate(size_t bytes);
+
+    /// Returns memory obtained from allocate()
+    void deallocate(void* ptr);
+
+    /**
+     * Returns all the memory to the system, including allocations which
+     * were not deallocated.
+     */
+    void release();
+
+    /// The number of bytes currently mapped from the system
+    size_t bytes_mapped() const { return mapped; }
+
+  private:
+    struct chunk {
+      chunk* prev;
+      chunk* next;
+      size_t size;
+      size_t used;
+      size_t live;
+    };
+
+    // not copyable
+    region_allocator(const region_allocator&);
+    region_allocator& operator=(const region_allocator&);
+
+    chunk* map_chunk(size_t size);
+    void unmap_chunk(chunk* c);
+
+    const size_t chunk_size;
+    const memory_info::memory_category category;
+    simple_spinlock lock;
+    /// all chunks, in a doubly linked list
+    chunk* chunks;
+    /// the chunk allocations are bumped from
+    chunk* current;
+    size_t mapped;
+  };
+
+
+  /**
+   * \ingroup util
+   * An append only array of T stored in fixed size segments allocated
+   * from a region_allocator. Growing never copies the existing elements,
+   * and move_to() copies the contents into a std::vector releasing each
+   * segment once it is copied, so the peak footprint of building a
+   * vector this way is one segment above the size of the data.
+   */
+  template <typename T>
+  class chunked_array {
+  public:
+    /// Approximate size in bytes of a segment
+    static const size_t SEGMENT_BYTES = 1024 * 1024;
+
+    // Every segment is larger than the region chunks, so each is mapped
+    // as a chunk of its own and move_to() returns it to the system at once
+    explicit chunked_array(memory_info::memory_category category =
+                               memory_info::UNTRACKED)
+      : category(category), region(SMALL_CHUNK_SIZE, category), numel(0) { }
+
+    chunked_array(const chunked_array& other)
+      : category(other.category), region(SMALL_CHUNK_SIZE, category),
+        numel(0) {
+      for (size_t i = 0; i < other.size(); ++i) push_back(other[i]);
+    }
+
+    chunked_array& operator=(const chunked_array& other) {
+      if (this != &other) {
+        clear();
+        for (size_t i = 0; i < other.size(); ++i) push_back(other[i]);
+      }
+      return *this;
+    }
+
+    ~chunked_array() { clear(); }
+
+    /// The number of elements
+    size_t size() const { return numel; }
+
+    bool empty() const { return numel == 0; }
+
+    void push_back(const T& t) {
+      const size_t offset = numel % segment_size();
+      if (offset == 0) {
+        segments.push_back(reinterpret_cast<T*>(
+            region.allocate(segment_size() * sizeof(T))));
+      }
+      new (segments.back() + offset) T(t);
+      ++numel;
+    }
+
+    template <typename Iterator>
+    void append(Iterator begin, Iterator end) {
+      for (; begin != end; ++begin) push_back(*begin);
+    }
+
+    T& operator[](size_t i) {
+      return segments[i / segment_size()][i % segment_size()];
+    }
+
+    const T& operator[](size_t i) const {
+      return segments[i / segment_size()][i % segment_size()];
+    }
+
+    /**
+     * Appends the contents to out and empties the array, returning each
+     * segment to the system as soon as it has been copied.
+     */
+    void move_to(std::vector<T>& out) {
+      out.reserve(out.size() + numel);
+      for (size_t s = 0; s < segments.size(); ++s) {
+        const size_t n = std::min(segment_size(), numel - s * segment_size());
+        T* seg = segments[s];
+        out.insert(out.end(), seg, seg + n);
+        for (size_t i = 0; i < n; ++i) seg[i].~T();
+        region.deallocate(seg);
+      }
+      std::vector<T*>().swap(segments);
+      numel = 0;
+      region.release();
+    }
+
+    /// Destroys all elements and releases the memory
+    void clear() {
+      for (size_t s = 0; s < segments.size(); ++s) {
+        const size_t n = std::min(segment_size(), numel - s * segment_size());
+        for (size_t i = 0; i < n; ++i) segments[s][i].~T();
+      }
+      std::vector<T*>().swap(segments);
+      numel = 0;
+      region.release();
+    }
+
+    /// The number of bytes mapped for the array
+    size_t estimate_sizeof() const {
+      return region.bytes_mapped() + segments.capacity() * sizeof(T*) +
+          sizeof(chunked_array);
+    }
+
+  private:
+    static const size_t SMALL_CHUNK_SIZE = 4096;
+
+    static size_t segment_size() {
+      return sizeof(T) >= SEGMENT_BYTES ? 1 : SEGMENT_BYTES / sizeof(T);
+    }
+
+    memory_info::memory_category category;
+    region_allocator region;
+    std::vector<T*> segments;
+    size_t numel;
+  };
+
+} // namespace graphlab
+
+#endif
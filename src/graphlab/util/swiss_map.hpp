@@ -0,0 +1,590 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_UTIL_SWISS_MAP_HPP
+#define GRAPHLAB_UTIL_SWISS_MAP_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <boost/functional/hash.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+
+#define _SWISS_MAP_DEFAULT_HASH boost::hash<Key>
+
+
+namespace graphlab {
+
+  namespace swiss_map_impl {
+
+    /**
+     * The control byte of a slot. A full slot holds the low 7 bits of
+     * the hash of its key. Empty and deleted slots have the high bit set.
+     */
+    typedef int8_t ctrl_t;
+    const ctrl_t CTRL_EMPTY = -128;
+    const ctrl_t CTRL_DELETED = -2;
+
+    /// The number of control bytes compared at once
+    const size_t GROUP_WIDTH = 16;
+
+    /**
+     * A group of GROUP_WIDTH control bytes. The match functions return a
+     * bitmask with bit i set if control byte i matches.
+     */
+    struct group {
+#ifdef __SSE2__
+      __m128i ctrl;
+      explicit group(const ctrl_t* pos) :
+        ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) { }
+
+      uint32_t match(ctrl_t h2) const {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));
+      }
+
+      uint32_t match_empty() const {
+        return match(CTRL_EMPTY);
+      }
+
+      uint32_t match_empty_or_deleted() const {
+        return _mm_movemask_epi8(ctrl);
+      }
+#else
+      const ctrl_t* ctrl;
+      explicit group(const ctrl_t* pos) : ctrl(pos) { }
+
+      uint32_t match(ctrl_t h2) const {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP_WIDTH; ++i) {
+          mask |= uint32_t(ctrl[i] == h2) << i;
+        }
+        return mask;
+      }
+
+      uint32_t match_empty() const {
+        return match(CTRL_EMPTY);
+      }
+
+      uint32_t match_empty_or_deleted() const {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP_WIDTH; ++i) {
+          mask |= uint32_t(ctrl[i] < 0) << i;
+        }
+        return mask;
+      }
+#endif
+    };
+
+    /**
+     * Mixes the bits of a hash value. The default hash of an integer is
+     * the integer itself, which puts consecutive ids in consecutive
+     * groups and leaves the control bytes all alike.
+     */
+    inline uint64_t mix(uint64_t h) {
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      h *= 0xc4ceb9fe1a85ec53ULL;
+      h ^= h >> 33;
+      return h;
+    }
+
+  } // namespace swiss_map_impl
+
+
+
+  /**
+   * An open addressing hash map in the style of the "Swiss table".
+   * Interface is similar to graphlab::hopscotch_map and largely
+   * similar to boost::unordered_map, though not entirely STL compliant.
+   *
+   * Every slot has a one byte control word holding 7 bits of the hash of
+   * its key. A lookup loads the control words of a group of 16 slots and
+   * compares all of them with the hash bits at once (with SSE2 when
+   * available), and only compares the keys of the slots which match. The
+   * groups are probed in a triangular sequence. As a result most lookups
+   * touch one cache line of control words and one slot.
+   *
+   * The table grows by doubling at a load factor of 7/8.
+   * Should only be used to store small keys and trivial values.
+   *
+   * \tparam Key The key of the map
+   * \tparam Value The value to store for each key
+   * \tparam Hash The hash functor type. Defaults to boost::hash<Key>.
+   *              The hash is mixed further so it need not be uniform.
+   * \tparam KeyEqual The functor used to identify object equality. Defaults to
+   *                  std::equal_to<Key>
+   */
+  template <typename Key,
+            typename Value,
+            typename Hash = _SWISS_MAP_DEFAULT_HASH,
+            typename KeyEqual = std::equal_to<Key> >
+  class swiss_map {
+
+  public:
+    // public typedefs
+    typedef Key                                      key_type;
+    typedef std::pair<Key, Value>                    value_type;
+    typedef Value                                    mapped_type;
+    typedef size_t                                   size_type;
+    typedef Hash                                     hasher;
+    typedef KeyEqual equality_function;
+    typedef value_type* pointer;
+    typedef value_type& reference;
+    typedef const value_type* const_pointer;
+    typedef const value_type& const_reference;
+
+    struct const_iterator {
+      typedef std::forward_iterator_tag iterator_category;
+      typedef const typename swiss_map::value_type value_type;
+      typedef size_t difference_type;
+      typedef value_type* pointer;
+      typedef value_type& reference;
+
+      friend class swiss_map;
+
+      const swiss_map* ptr;
+      size_t idx;
+
+      const_iterator(): ptr(NULL), idx(0) { }
+
+      const_iterator operator++() {
+        idx = ptr->next_full(idx + 1);
+        return *this;
+      }
+
+      const_iterator operator++(int) {
+        const_iterator cur = *this;
+        ++(*this);
+        return cur;
+      }
+
+      reference operator*() const { return ptr->slots[idx]; }
+
+      pointer operator->() const { return &(ptr->slots[idx]); }
+
+      bool operator==(const const_iterator it) const {
+        return ptr == it.ptr && idx == it.idx;
+      }
+
+      bool operator!=(const const_iterator it) const {
+        return !((*this) == it);
+      }
+    private:
+      const_iterator(const swiss_map* map, size_t idx): ptr(map), idx(idx) { }
+    };
+
+    struct iterator {
+      typedef std::forward_iterator_tag iterator_category;
+      typedef typename swiss_map::value_type value_type;
+      typedef size_t difference_type;
+      typedef value_type* pointer;
+      typedef value_type& reference;
+
+      friend class swiss_map;
+
+      swiss_map* ptr;
+      size_t idx;
+
+      iterator(): ptr(NULL), idx(0) { }
+
+      operator const_iterator() const {
+        return const_iterator(ptr, idx);
+      }
+
+      iterator operator++() {
+        idx = ptr->next_full(idx + 1);
+        return *this;
+      }
+
+      iterator operator++(int) {
+        iterator cur = *this;
+        ++(*this);
+        return cur;
+      }
+
+      reference operator*() const { return ptr->slots[idx]; }
+
+      pointer operator->() const { return &(ptr->slots[idx]); }
+
+      bool operator==(const iterator it) const {
+        return ptr == it.ptr && idx == it.idx;
+      }
+
+      bool operator!=(const iterator it) const {
+        return !((*this) == it);
+      }
+    private:
+      iterator(swiss_map* map, size_t idx): ptr(map), idx(idx) { }
+    };
+
+
+  private:
+    typedef swiss_map_impl::ctrl_t ctrl_t;
+    typedef swiss_map_impl::group group;
+
+    static const size_t MIN_CAPACITY = 2 * swiss_map_impl::GROUP_WIDTH;
+
+    // the control bytes, one per slot
+    ctrl_t* ctrl;
+    // the slots. Only slots with a full control byte are constructed
+    value_type* slots;
+    // the number of slots. A power of two and a multiple of GROUP_WIDTH
+    size_t cap;
+    size_t numel;
+    size_t numdeleted;
+
+    Hash hashfun;
+    KeyEqual equalfun;
+
+    static size_t max_load(size_t capacity) {
+      return capacity - capacity / 8;
+    }
+
+    size_t hash_of(const key_type& k) const {
+      return swiss_map_impl::mix(hashfun(k));
+    }
+
+    static ctrl_t h2(size_t hash) {
+      return ctrl_t(hash & 0x7F);
+    }
+
+    // the first group to probe
+    size_t h1(size_t hash) const {
+      return (hash >> 7) & (cap / swiss_map_impl::GROUP_WIDTH - 1);
+    }
+
+    static int lowest_bit(uint32_t mask) {
+      return __builtin_ctz(mask);
+    }
+
+    // the index of the first full slot at or after idx, or cap
+    size_t next_full(size_t idx) const {
+      while (idx < cap && ctrl[idx] < 0) ++idx;
+      return idx;
+    }
+
+    // allocates empty arrays of capacity c
+    void allocate(size_t c) {
+      cap = c;
+      ctrl = reinterpret_cast<ctrl_t*>(malloc(cap));
+      ASSERT_TRUE(ctrl != NULL);
+      memset(ctrl, swiss_map_impl::CTRL_EMPTY, cap);
+      slots = reinterpret_cast<value_type*>(malloc(cap * sizeof(value_type)));
+      ASSERT_TRUE(slots != NULL);
+      numel = 0;
+      numdeleted = 0;
+    }
+
+    // destroys all elements and frees the arrays
+    void destroy_all() {
+      if (ctrl == NULL) return;
+      for (size_t i = 0; i < cap; ++i) {
+        if (ctrl[i] >= 0) slots[i].~value_type();
+      }
+      free(ctrl);
+      free(slots);
+      ctrl = NULL;
+      slots = NULL;
+      numel = 0;
+      numdeleted = 0;
+    }
+
+    // returns the index of the slot holding k, or cap
+    size_t find_index(const key_type& k) const {
+      const size_t hash = hash_of(k);
+      const ctrl_t tag = h2(hash);
+      const size_t groupmask = cap / swiss_map_impl::GROUP_WIDTH - 1;
+      size_t g = h1(hash);
+      for (size_t probe = 1; ; ++probe) {
+        const size_t base = g * swiss_map_impl::GROUP_WIDTH;
+        group grp(ctrl + base);
+        uint32_t mask = grp.match(tag);
+        while (mask) {
+          const size_t idx = base + lowest_bit(mask);
+          if (__builtin_expect(equalfun(slots[idx].first, k), 1)) return idx;
+          mask &= mask - 1;
+        }
+        if (grp.match_empty()) return cap;
+        // triangular probing visits every group of a power of two table
+        g = (g + probe) & groupmask;
+      }
+    }
+
+    // returns the slot a new element with the given hash goes into
+    size_t find_insert_slot(size_t hash) const {
+      const size_t groupmask = cap / swiss_map_impl::GROUP_WIDTH - 1;
+      size_t g = h1(hash);
+      for (size_t probe = 1; ; ++probe) {
+        const size_t base = g * swiss_map_impl::GROUP_WIDTH;
+        const uint32_t mask = group(ctrl + base).match_empty_or_deleted();
+        if (mask) return base + lowest_bit(mask);
+        g = (g + probe) & groupmask;
+      }
+    }
+
+    // Inserts a value into the hash table. This does not check
+    // if the key already exists, and may produce duplicate values.
+    size_t do_insert(const value_type& v) {
+      if (numel + numdeleted + 1 > max_load(cap)) {
+        // double, unless most of the load is deleted slots
+        rehash_to_new_capacity(numel + 1 > max_load(cap) / 2 ? cap * 2 : cap);
+      }
+      const size_t hash = hash_of(v.first);
+      const size_t idx = find_insert_slot(hash);
+      if (ctrl[idx] == swiss_map_impl::CTRL_DELETED) --numdeleted;
+      new (slots + idx) value_type(v);
+      ctrl[idx] = h2(hash);
+      ++numel;
+      return idx;
+    }
+
+    void rehash_to_new_capacity(size_t newcap) {
+      ctrl_t* oldctrl = ctrl;
+      value_type* oldslots = slots;
+      const size_t oldcap = cap;
+      allocate(newcap);
+      for (size_t i = 0; i < oldcap; ++i) {
+        if (oldctrl[i] >= 0) {
+          const size_t hash = hash_of(oldslots[i].first);
+          const size_t idx = find_insert_slot(hash);
+          new (slots + idx) value_type(oldslots[i]);
+          ctrl[idx] = h2(hash);
+          ++numel;
+          oldslots[i].~value_type();
+        }
+      }
+      free(oldctrl);
+      free(oldslots);
+    }
+
+    void erase_index(size_t idx) {
+      slots[idx].~value_type();
+      --numel;
+      // A probe only continues past a group with no empty slots, so if
+      // this group has an empty slot the slot can be emptied. Otherwise
+      // it must stay marked to keep later probes going.
+      const size_t base = idx & ~(swiss_map_impl::GROUP_WIDTH - 1);
+      if (group(ctrl + base).match_empty()) {
+        ctrl[idx] = swiss_map_impl::CTRL_EMPTY;
+      } else {
+        ctrl[idx] = swiss_map_impl::CTRL_DELETED;
+        ++numdeleted;
+      }
+    }
+
+    static size_t capacity_for(size_t n) {
+      size_t c = MIN_CAPACITY;
+      while (max_load(c) < n) c *= 2;
+      return c;
+    }
+
+  public:
+
+    swiss_map(Hash hashfun = Hash(),
+              KeyEqual equalfun = KeyEqual()):
+      ctrl(NULL), slots(NULL), cap(0), numel(0), numdeleted(0),
+      hashfun(hashfun), equalfun(equalfun) {
+      allocate(MIN_CAPACITY);
+    }
+
+    swiss_map(const swiss_map& h):
+      ctrl(NULL), slots(NULL), cap(0), numel(0), numdeleted(0),
+      hashfun(h.hashfun), equalfun(h.equalfun) {
+      allocate(capacity_for(h.size()));
+      for (const_iterator iter = h.begin(); iter != h.end(); ++iter) {
+        do_insert(*iter);
+      }
+    }
+
+    ~swiss_map() {
+      destroy_all();
+    }
+
+    swiss_map& operator=(const swiss_map& other) {
+      if (this != &other) {
+        swiss_map tmp(other);
+        swap(tmp);
+      }
+      return *this;
+    }
+
+    /// Ensures that n elements can be held without growing.
+    void reserve(size_t n) {
+      if (max_load(cap) < n) rehash_to_new_capacity(capacity_for(n));
+    }
+
+    /// Grows the table to at least s slots. Only increases.
+    void rehash(size_t s) {
+      if (s > cap) {
+        size_t c = MIN_CAPACITY;
+        while (c < s) c *= 2;
+        rehash_to_new_capacity(c);
+      }
+    }
+
+    hasher hash_function() const {
+      return hashfun;
+    }
+
+    KeyEqual key_eq() const {
+      return equalfun;
+    }
+
+    size_type size() const {
+      return numel;
+    }
+
+    bool empty() const {
+      return numel == 0;
+    }
+
+    iterator begin() {
+      return iterator(this, next_full(0));
+    }
+
+    iterator end() {
+      return iterator(this, cap);
+    }
+
+    const_iterator begin() const {
+      return const_iterator(this, next_full(0));
+    }
+
+    const_iterator end() const {
+      return const_iterator(this, cap);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) {
+      const size_t idx = find_index(v.first);
+      if (idx != cap) return std::make_pair(iterator(this, idx), false);
+      else return std::make_pair(iterator(this, do_insert(v)), true);
+    }
+
+    iterator insert(const_iterator hint, const value_type& v) {
+      return insert(v).first;
+    }
+
+    iterator find(key_type const& k) {
+      return iterator(this, find_index(k));
+    }
+
+    const_iterator find(key_type const& k) const {
+      return const_iterator(this, find_index(k));
+    }
+
+    size_t count(key_type const& k) const {
+      return find_index(k) != cap;
+    }
+
+    bool erase(iterator iter) {
+      if (iter.idx >= cap || ctrl[iter.idx] < 0) return false;
+      erase_index(iter.idx);
+      return true;
+    }
+
+    bool erase(key_type const& k) {
+      const size_t idx = find_index(k);
+      if (idx == cap) return false;
+      erase_index(idx);
+      return true;
+    }
+
+    void swap(swiss_map& other) {
+      std::swap(ctrl, other.ctrl);
+      std::swap(slots, other.slots);
+      std::swap(cap, other.cap);
+      std::swap(numel, other.numel);
+      std::swap(numdeleted, other.numdeleted);
+      std::swap(hashfun, other.hashfun);
+      std::swap(equalfun, other.equalfun);
+    }
+
+    mapped_type& operator[](const key_type& i) {
+      size_t idx = find_index(i);
+      if (idx == cap) idx = do_insert(value_type(i, mapped_type()));
+      return slots[idx].second;
+    }
+
+    /// Removes all elements and releases the memory
+    void clear() {
+      destroy_all();
+      allocate(MIN_CAPACITY);
+    }
+
+    size_t capacity() const {
+      return cap;
+    }
+
+    float load_factor() const {
+      return float(size()) / capacity();
+    }
+
+    void save(oarchive &oarc) const {
+      oarc << size() << capacity();
+      const_iterator iter = begin();
+      while (iter != end()) {
+        oarc << (*iter);
+        ++iter;
+      }
+    }
+
+    void load(iarchive &iarc) {
+      size_t s, c;
+      iarc >> s >> c;
+      destroy_all();
+      allocate(capacity_for(s));
+      for (size_t i = 0;i < s; ++i) {
+        value_type v;
+        iarc >> v;
+        insert(v);
+      }
+    }
+
+    void put(const value_type &v) {
+      (*this)[v.first] = v.second;
+    }
+
+    void put(const Key& k, const Value& v) {
+      (*this)[k] = v;
+    }
+
+    /// Returns (true, value) if k is present, (false, Value()) otherwise
+    std::pair<bool, Value> get(const Key& k) const {
+      const size_t idx = find_index(k);
+      if (idx == cap) return std::make_pair(false, Value());
+      return std::make_pair(true, slots[idx].second);
+    }
+  };
+
+}; // end of graphlab namespace
+
+#endif
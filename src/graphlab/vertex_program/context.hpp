@@ -149,6 +149,13 @@ namespace graphlab {
       engine.internal_clear_gather_cache(vertex);      
     }
 
+    /**
+     * Report the residual of the vertex being updated
+     */
+    void report_residual(const vertex_type& vertex, double residual) {
+      engine.internal_report_residual(vertex, residual);
+    }
+
 
                                                 
 
@@ -264,6 +264,23 @@ namespace graphlab {
      */
     virtual void clear_gather_cache(const vertex_type& vertex) { } 
 
+    /**
+     * \brief Report the residual of a vertex.
+     *
+     * The residual measures how far the vertex is from convergence,
+     * typically the absolute change of its value in the last apply.
+     * The engines track the last residual reported by each vertex, and
+     * stop when the sum of the residuals is at most the residual_l1
+     * engine option, or the largest residual is at most the
+     * residual_linf engine option, once every vertex has reported one.
+     * The residual must be reported from apply.
+     *
+     * \param vertex [in] the vertex being updated
+     * \param residual [in] the residual of the vertex
+     */
+    virtual void report_residual(const vertex_type& vertex,
+                                 double residual) { }
+
   }; // end of icontext
   
 } // end of namespace
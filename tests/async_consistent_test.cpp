@@ -310,7 +310,151 @@ void test_aggregator(graphlab::distributed_control& dc,
 
 
 
+// The largest vertex id from which each vertex can be reached. The
+// scatter keeps the cached gather of the out neighbors up to date with
+// post_delta, or clears it, so with use_cache the result depends on the
+// caches and the totals kept on the masters.
+struct max_gather : public graphlab::IS_POD_TYPE {
+  int value;
+  max_gather(int value = 0) : value(value) { }
+  max_gather& operator+=(const max_gather& other) {
+    value = std::max(value, other.value);
+    return *this;
+  }
+};
+
+class propagate_max :
+  public graphlab::ivertex_program<graph_type, max_gather>,
+  public graphlab::IS_POD_TYPE {
+  bool changed;
+public:
+  edge_dir_type
+  gather_edges(icontext_type& context, const vertex_type& vertex) const {
+    return graphlab::IN_EDGES;
+  }
+  gather_type
+  gather(icontext_type& context, const vertex_type& vertex,
+         edge_type& edge) const {
+    return max_gather(edge.source().data());
+  }
+  void apply(icontext_type& context, vertex_type& vertex,
+             const gather_type& total) {
+    changed = total.value > vertex.data();
+    if (changed) vertex.data() = total.value;
+  }
+  edge_dir_type
+  scatter_edges(icontext_type& context, const vertex_type& vertex) const {
+    return changed ? graphlab::OUT_EDGES : graphlab::NO_EDGES;
+  }
+  void scatter(icontext_type& context, const vertex_type& vertex,
+               edge_type& edge) const {
+    if (edge.target().id() % 3 == 0) {
+      context.clear_gather_cache(edge.target());
+    } else {
+      context.post_delta(edge.target(), max_gather(vertex.data()));
+    }
+    context.signal(edge.target());
+  }
+}; // end of propagate max
+
+
+void set_vertex_to_id(graph_type::vertex_type vtx) {
+  vtx.data() = vtx.id();
+}
+
+// Runs propagate_max from every vertex with the given engine options,
+// and returns the data of the local vertices
+template <typename EngineType>
+std::vector<int> run_propagate_max(graphlab::distributed_control& dc,
+                                   graphlab::command_line_options clopts,
+                                   graph_type& graph,
+                                   const std::string& options) {
+  std::cout << "Propagating the largest id with " << options << std::endl;
+  clopts.get_engine_args().parse_string(options);
+  graph.transform_vertices(set_vertex_to_id);
+  EngineType engine(dc, graph, clopts);
+  engine.signal_all();
+  engine.start();
+  std::vector<int> ret(graph.num_local_vertices());
+  for (graphlab::lvid_type i = 0; i < graph.num_local_vertices(); ++i) {
+    ret[i] = graph.l_vertex(i).data();
+  }
+  return ret;
+}
+
+// With several machines the hubs of the powerlaw graph have mirrors on
+// most of them, and their caches are updated by scatters on every mirror
+void test_cache_deltas(graphlab::distributed_control& dc,
+                       graphlab::command_line_options& clopts,
+                       graph_type& graph) {
+  typedef graphlab::async_consistent_engine<propagate_max> engine_type;
+  const std::vector<int> expected = run_propagate_max<engine_type>(
+      dc, clopts, graph, "factorized=false,use_cache=false");
+  std::vector<int> result = run_propagate_max<engine_type>(
+      dc, clopts, graph, "factorized=false,use_cache=true");
+  ASSERT_TRUE(result == expected);
+  result = run_propagate_max<engine_type>(
+      dc, clopts, graph, "factorized=false,use_cache=true,lock_batch=16");
+  ASSERT_TRUE(result == expected);
+  result = run_propagate_max<engine_type>(
+      dc, clopts, graph, "factorized=true,use_cache=true");
+  ASSERT_TRUE(result == expected);
+}
+
+
+
+// propagate_max with a slow gather, which keeps optimistic updates open
+// long enough for their neighbors to change under them
+class propagate_max_slow : public propagate_max {
+public:
+  gather_type
+  gather(icontext_type& context, const vertex_type& vertex,
+         edge_type& edge) const {
+    graphlab::timer::sleep_ms(1);
+    return propagate_max::gather(context, vertex, edge);
+  }
+}; // end of propagate max slow
+
+// The vertices whose neighbors have no mirrors run optimistically, next to
+// vertices which take the locks: all the vertices on one machine, the
+// hubs and their neighbors on several. With no retries an aborted update
+// falls back to the locks at once.
+void test_optimistic(graphlab::distributed_control& dc,
+                     graphlab::command_line_options clopts,
+                     graph_type& graph) {
+  typedef graphlab::async_consistent_engine<propagate_max> engine_type;
+  typedef graphlab::async_consistent_engine<propagate_max_slow>
+      slow_engine_type;
+  const std::vector<int> expected = run_propagate_max<engine_type>(
+      dc, clopts, graph, "factorized=false");
+
+  std::cout << "Propagating the largest id optimistically" << std::endl;
+  clopts.get_engine_args().parse_string(
+      "factorized=false,optimistic=true,optimistic_retries=0");
+  graph.transform_vertices(set_vertex_to_id);
+  slow_engine_type engine(dc, graph, clopts);
+  engine.signal_all();
+  engine.start();
+  for (graphlab::lvid_type i = 0; i < graph.num_local_vertices(); ++i) {
+    ASSERT_EQ(graph.l_vertex(i).data(), expected[i]);
+  }
+  size_t ncommits = engine.num_optimistic_commits();
+  size_t naborts = engine.num_optimistic_aborts();
+  dc.all_reduce(ncommits);
+  dc.all_reduce(naborts);
+  std::cout << ncommits << " optimistic commits, "
+            << naborts << " fallbacks" << std::endl;
+  ASSERT_GT(ncommits, 0);
+  ASSERT_GT(naborts, 0);
+}
+
+
+
+
 int main(int argc, char** argv) {
+  // enough workers for the optimistic updates to contend on any machine
+  graphlab::fiber_control::instance_set_parameters(
+      std::max<size_t>(graphlab::thread::cpu_count(), 4), 0);
 
   global_logger().set_log_level(LOG_INFO);
   ///! Initialize control plain using mpi
@@ -329,6 +473,8 @@ int main(int argc, char** argv) {
   test_out_neighbors(dc, clopts, graph);
   test_all_neighbors(dc, clopts, graph);
   test_aggregator(dc, clopts, graph);
+  test_cache_deltas(dc, clopts, graph);
+  test_optimistic(dc, clopts, graph);
   graphlab::mpi_tools::finalize();
 } // end of main
 
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <vector>
+#include <boost/bind.hpp>
+#include <cxxtest/TestSuite.h>
+
+#include <graphlab/scheduler/block_sweep_scheduler.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+
+using namespace graphlab;
+
+const size_t NUM_VERTICES = 10000;
+
+void block_sweep_worker(block_sweep_scheduler* sched, size_t cpuid,
+                        std::vector<atomic<size_t> >* counts) {
+  lvid_type vid;
+  while (sched->get_next(cpuid, vid) == sched_status::NEW_TASK) {
+    // run every multiple of 7 twice
+    if ((*counts)[vid].inc() == 1 && vid % 7 == 0) {
+      sched->schedule(vid);
+    }
+  }
+}
+
+class block_sweep_scheduler_test : public CxxTest::TestSuite {
+public:
+
+  void test_first_bit_in_range() {
+    dense_bitset bits(300);
+    bits.clear();
+    bits.set_bit(5);
+    bits.set_bit(130);
+    size_t b = 0;
+    TS_ASSERT(bits.first_bit_in_range(b, 300));
+    TS_ASSERT_EQUALS(b, 5);
+    b = 6;
+    TS_ASSERT(!bits.first_bit_in_range(b, 130));
+    TS_ASSERT(bits.first_bit_in_range(b, 131));
+    TS_ASSERT_EQUALS(b, 130);
+    b = 131;
+    TS_ASSERT(!bits.first_bit_in_range(b, 1000));
+  }
+
+  void test_tile_order() {
+    // a single thread sweeps each tile in ascending order
+    graphlab_options opts;
+    opts.set_ncpus(1);
+    opts.get_scheduler_args().set_option("tile_size", 100);
+    block_sweep_scheduler sched(NUM_VERTICES, opts);
+    // tiles are rounded up to 128 vertices
+    for (size_t i = 0; i < NUM_VERTICES; i += 3) sched.schedule(i);
+    lvid_type vid;
+    size_t count = 0;
+    lvid_type last = 0;
+    while (sched.get_next(0, vid) == sched_status::NEW_TASK) {
+      TS_ASSERT_EQUALS(vid % 3, 0);
+      if (count > 0 && vid / 128 == last / 128) TS_ASSERT_LESS_THAN(last, vid);
+      last = vid;
+      ++count;
+    }
+    TS_ASSERT_EQUALS(count, (NUM_VERTICES + 2) / 3);
+    TS_ASSERT(sched.empty());
+  }
+
+  void test_parallel() {
+    const size_t ncpus = 4;
+    graphlab_options opts;
+    opts.set_ncpus(ncpus);
+    opts.get_scheduler_args().set_option("tile_size", 256);
+    block_sweep_scheduler sched(NUM_VERTICES, opts);
+    for (size_t i = 0; i < NUM_VERTICES; ++i) sched.schedule(i);
+    std::vector<atomic<size_t> > counts(NUM_VERTICES);
+    thread_group group;
+    for (size_t i = 0; i < ncpus; ++i) {
+      group.launch(boost::bind(block_sweep_worker, &sched, i, &counts));
+    }
+    group.join();
+    for (size_t i = 0; i < NUM_VERTICES; ++i) {
+      TS_ASSERT_EQUALS(counts[i].value, i % 7 == 0 ? 2 : 1);
+    }
+    TS_ASSERT(sched.empty());
+  }
+};
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <cxxtest/TestSuite.h>
+
+#include <graphlab/util/bloom_filter.hpp>
+
+using namespace graphlab;
+
+class bloom_filter_test : public CxxTest::TestSuite {
+public:
+
+  void test_blocked_bloom_filter() {
+    const size_t n = 100000;
+    blocked_bloom_filter filter(n, 12);
+    for (size_t i = 0; i < n; ++i) filter.insert(3 * i);
+    // no false negatives
+    for (size_t i = 0; i < n; ++i) TS_ASSERT(filter.may_contain(3 * i));
+    // few false positives
+    size_t false_positives = 0;
+    for (size_t i = 0; i < n; ++i) false_positives += filter.may_contain(3 * i + 1);
+    TS_ASSERT_LESS_THAN(false_positives, n / 50);
+    filter.clear();
+    TS_ASSERT(!filter.may_contain(0));
+  }
+
+  void test_empty_filter() {
+    blocked_bloom_filter filter;
+    TS_ASSERT(!filter.may_contain(12345));
+    filter.insert(12345);
+    TS_ASSERT(filter.may_contain(12345));
+  }
+
+  void test_fixed_bloom_filter() {
+    fixed_bloom_filter<4096, 3> filter;
+    for (size_t i = 0; i < 100; ++i) filter.insert(7 * i);
+    for (size_t i = 0; i < 100; ++i) TS_ASSERT(filter.may_contain(7 * i));
+    filter.clear();
+    TS_ASSERT(!filter.may_contain(7));
+  }
+};
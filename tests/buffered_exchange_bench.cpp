@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+/*
+ * Measures the throughput of buffered_exchange as the number of sending
+ * threads grows. Every thread sends VALUES_PER_THREAD (vertex id, double)
+ * pairs round robin to all machines, and then all machines receive.
+ */
+#include <iostream>
+#include <utility>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <graphlab/util/timer.hpp>
+#include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/rpc/dc_init_from_mpi.hpp>
+#include <graphlab/rpc/buffered_exchange.hpp>
+#include <graphlab/logger/logger.hpp>
+using namespace graphlab;
+
+typedef std::pair<size_t, double> value_type;
+const size_t VALUES_PER_THREAD = 1000000;
+
+int main(int argc, char ** argv) {
+  global_logger().set_log_level(LOG_INFO);
+
+  dc_init_param param;
+  mpi_tools::init(argc, argv);
+  if (!init_param_from_mpi(param)) {
+    return 0;
+  }
+  distributed_control dc(param);
+
+#ifdef _OPENMP
+  const size_t max_threads = omp_get_max_threads();
+#else
+  const size_t max_threads = 1;
+#endif
+  for (size_t nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+    buffered_exchange<value_type> exchange(dc, nthreads);
+    dc.full_barrier();
+    timer ti;
+    ti.start();
+#pragma omp parallel num_threads(nthreads)
+    {
+#ifdef _OPENMP
+      const size_t thread_id = omp_get_thread_num();
+#else
+      const size_t thread_id = 0;
+#endif
+      for (size_t i = 0; i < VALUES_PER_THREAD; ++i) {
+        exchange.send(i % dc.numprocs(), value_type(i, 1.0), thread_id);
+      }
+      exchange.partial_flush(thread_id);
+    }
+    const double send_time = ti.current_time();
+    exchange.flush();
+
+    size_t received = 0;
+#pragma omp parallel num_threads(nthreads) reduction(+:received)
+    {
+      procid_t proc;
+      buffered_exchange<value_type>::buffer_type buffer;
+      while(exchange.recv(proc, buffer)) received += buffer.size();
+    }
+    const double total_time = ti.current_time();
+    // every thread on every machine sent this machine every numprocs'th value
+    const size_t per_thread =
+        (VALUES_PER_THREAD - dc.procid() + dc.numprocs() - 1) / dc.numprocs();
+    ASSERT_EQ(received, per_thread * nthreads * dc.numprocs());
+
+    dc.full_barrier();
+    if (dc.procid() == 0) {
+      std::cout << nthreads << " threads: "
+                << VALUES_PER_THREAD * nthreads / send_time
+                << " sends/s per machine, "
+                << VALUES_PER_THREAD * nthreads / total_time
+                << " values/s exchanged per machine" << std::endl;
+    }
+  }
+  mpi_tools::finalize();
+}
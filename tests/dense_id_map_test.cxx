@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <map>
+#include <utility>
+#include <sstream>
+
+#include <cxxtest/TestSuite.h>
+
+#include <graphlab/util/hopscotch_map.hpp>
+#include <graphlab/util/dense_id_map.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+
+using namespace graphlab;
+
+#include <graphlab/macros_def.hpp>
+class dense_id_map_test : public CxxTest::TestSuite {
+public:
+  typedef dense_id_map<size_t, size_t, hopscotch_map<size_t, size_t> >
+      map_type;
+
+  // fills the map with every third id and checks it against a std::map
+  void check_map(map_type& map) {
+    std::map<size_t, size_t> ref;
+    for (size_t i = 0; i < 3000; i += 3) {
+      TS_ASSERT(map.insert(std::make_pair(i, i / 3)).second);
+      ref[i] = i / 3;
+    }
+    TS_ASSERT(!map.insert(std::make_pair(size_t(0), size_t(7))).second);
+    map[3001] = 5;
+    ref[3001] = 5;
+    TS_ASSERT(map.erase(3));
+    TS_ASSERT(!map.erase(4));
+    ref.erase(3);
+    TS_ASSERT_EQUALS(map.size(), ref.size());
+    for (size_t i = 0; i < 3010; ++i) {
+      TS_ASSERT_EQUALS(map.count(i), ref.count(i));
+      if (ref.count(i)) {
+        TS_ASSERT(map.find(i) != map.end());
+        TS_ASSERT_EQUALS(map.find(i)->second, ref[i]);
+      } else {
+        TS_ASSERT(map.find(i) == map.end());
+      }
+    }
+    size_t n = 0;
+    typedef std::pair<size_t, size_t> pair_type;
+    foreach(const pair_type& pair, map) {
+      TS_ASSERT_EQUALS(ref[pair.first], pair.second);
+      ++n;
+    }
+    TS_ASSERT_EQUALS(n, ref.size());
+  }
+
+  void test_hashed() {
+    map_type map;
+    TS_ASSERT(!map.is_dense());
+    check_map(map);
+  }
+
+  void test_dense() {
+    map_type map;
+    map.set_dense(true);
+    TS_ASSERT(map.is_dense());
+    check_map(map);
+    map_type other;
+    other.set_dense(true);
+    other.swap(map);
+    TS_ASSERT_EQUALS(map.size(), 0);
+    TS_ASSERT_EQUALS(other.size(), 1000);
+    other.clear();
+    TS_ASSERT(other.is_dense());
+    TS_ASSERT(other.begin() == other.end());
+  }
+
+  void test_dense_range() {
+    map_type map;
+    map.set_dense(true);
+    // the array only spans the ids that were inserted, in any order
+    for (size_t i = 0; i < 100; ++i) map[1000000 + i] = i;
+    for (size_t i = 1; i <= 100; ++i) map[1000000 - i] = i;
+    TS_ASSERT_EQUALS(map.size(), 200);
+    TS_ASSERT_EQUALS(map.span(), 200);
+    TS_ASSERT_EQUALS(map.count(0), 0);
+    TS_ASSERT_EQUALS(map.count(999899), 0);
+    TS_ASSERT_EQUALS(map.count(1000100), 0);
+    TS_ASSERT(map.find(5) == map.end());
+    TS_ASSERT(!map.erase(5));
+    TS_ASSERT_EQUALS(map.find(999900)->second, 100);
+    TS_ASSERT_EQUALS(map.find(1000099)->second, 99);
+    size_t n = 0;
+    typedef std::pair<size_t, size_t> pair_type;
+    foreach(const pair_type& pair, map) {
+      TS_ASSERT_EQUALS(pair.second, pair.first >= 1000000 ?
+                       pair.first - 1000000 : 1000000 - pair.first);
+      ++n;
+    }
+    TS_ASSERT_EQUALS(n, 200);
+    map.reserve(10);
+    TS_ASSERT_EQUALS(map.span(), 1000100);
+    TS_ASSERT_EQUALS(map.find(1000000)->second, 0);
+    TS_ASSERT_EQUALS(map.size(), 200);
+  }
+
+  void test_serialization_between_modes() {
+    map_type dense;
+    dense.set_dense(true);
+    for (size_t i = 0; i < 100; ++i) dense[2 * i] = i;
+    std::stringstream strm;
+    oarchive oarc(strm);
+    oarc << dense;
+    strm.flush();
+    iarchive iarc(strm);
+    map_type hashed;
+    iarc >> hashed;
+    TS_ASSERT(!hashed.is_dense());
+    TS_ASSERT_EQUALS(hashed.size(), 100);
+    for (size_t i = 0; i < 100; ++i) TS_ASSERT_EQUALS(hashed[2 * i], i);
+
+    std::stringstream strm2;
+    oarchive oarc2(strm2);
+    oarc2 << hashed;
+    strm2.flush();
+    iarchive iarc2(strm2);
+    map_type dense2;
+    dense2.set_dense(true);
+    iarc2 >> dense2;
+    TS_ASSERT_EQUALS(dense2.size(), 100);
+    for (size_t i = 0; i < 100; ++i) TS_ASSERT_EQUALS(dense2[2 * i], i);
+  }
+};
+#include <graphlab/macros_undef.hpp>
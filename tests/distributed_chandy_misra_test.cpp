@@ -36,7 +36,7 @@
 
 #include <graphlab/macros_def.hpp>
 
-#define INITIAL_NLOCKS_TO_ACQUIRE 1000
+size_t initial_nlocks_to_acquire = 1000;
 graphlab::mutex mt;
 graphlab::conditional cond;
 std::vector<graphlab::vertex_id_type> lockable_vertices;
@@ -66,7 +66,30 @@ typedef graphlab::distributed_graph<vertex_data, edge_data> graph_type;
 
 graphlab::distributed_chandy_misra<graph_type> *locks;
 graph_type *ggraph;
+graphlab::distributed_control *gdc;
 graphlab::blocking_queue<graphlab::vertex_id_type> locked_elements;
+bool per_replica = false;
+
+/*
+ * Releases a replica of a vertex on its mirror, as the engine does at the
+ * end of the scatter on each machine.
+ */
+bool release_replica(graphlab::vertex_id_type gvid) {
+  locks->philosopher_stops_eating_per_replica(ggraph->local_vid(gvid));
+  return true;
+}
+
+/*
+ * Releases a vertex through its replicas: the mirrors are released
+ * first, then the owner.
+ */
+void release_per_replica(graphlab::lvid_type lvid) {
+  const graph_type::vertex_record& rec = ggraph->l_get_vertex_record(lvid);
+  foreach(graphlab::procid_t mirror, rec.mirrors()) {
+    gdc->remote_request(mirror, release_replica, rec.gvid);
+  }
+  locks->philosopher_stops_eating_per_replica(lvid);
+}
 
 
 void callback(graphlab::vertex_id_type v) {
@@ -87,7 +110,8 @@ void thread_stuff() {
     deq = locked_elements.dequeue();
     if (deq.second == false) break;
     else {
-      locks->philosopher_stops_eating(deq.first);
+      if (per_replica) release_per_replica(deq.first);
+      else locks->philosopher_stops_eating(deq.first);
       mt.lock();
       current_demand_set[deq.first] = 0;
       bool getnextlock = nlocks_to_acquire > 0;
@@ -98,7 +122,7 @@ void thread_stuff() {
         }
       }
       if (nlocks_to_acquire == 0 &&
-        nlocksacquired == INITIAL_NLOCKS_TO_ACQUIRE + lockable_vertices.size()) cond.signal();
+        nlocksacquired == initial_nlocks_to_acquire + lockable_vertices.size()) cond.signal();
       mt.unlock();
 
       if (getnextlock > 0) {
@@ -131,6 +155,7 @@ int main(int argc, char** argv) {
   graphlab::dc_init_param rpc_parameters;
   graphlab::init_param_from_mpi(rpc_parameters);
   graphlab::distributed_control dc(rpc_parameters);
+  gdc = &dc;
 
 
   // Parse command line options -----------------------------------------------
@@ -152,6 +177,22 @@ int main(int argc, char** argv) {
                        "The size of a randomly connected network. "
                        "If randomconnect=0 then the graph file is used.");
 
+  clopts.attach_option("nlocks", initial_nlocks_to_acquire,
+                       "The number of locks to acquire after each vertex "
+                       "was locked once.");
+  size_t lock_batch = 0;
+  clopts.attach_option("lock_batch", lock_batch,
+                       "Batch up to this many lock messages per machine. "
+                       "0 disables batching.");
+  size_t lock_batch_window = 100;
+  clopts.attach_option("lock_batch_window", lock_batch_window,
+                       "The longest time in microseconds a lock message "
+                       "is held back for batching.");
+  clopts.attach_option("per_replica", per_replica,
+                       "Release each replica of a vertex from its own "
+                       "machine, as the engine does, instead of "
+                       "broadcasting the release from the owner.");
+
   if(!clopts.parse(argc, argv)) {
     std::cout << "Error in parsing command line arguments." << std::endl;
     return EXIT_FAILURE;
@@ -249,8 +290,9 @@ int main(int argc, char** argv) {
   // }
   dc.barrier();
   locks = new graphlab::distributed_chandy_misra<graph_type>(dc, graph, callback);
+  locks->set_batching(lock_batch, lock_batch_window);
   nlocksacquired = 0;
-  nlocks_to_acquire = INITIAL_NLOCKS_TO_ACQUIRE;
+  nlocks_to_acquire = initial_nlocks_to_acquire;
   dc.full_barrier();
   for (graphlab::vertex_id_type v = 0; v < graph.num_local_vertices(); ++v) {
     if (graph.l_get_vertex_record(v).owner == dc.procid()) {
@@ -260,6 +302,7 @@ int main(int argc, char** argv) {
     }
   }
   dc.full_barrier();
+  graphlab::timer locktimer; locktimer.start();
   graphlab::thread_group thrs;
   for (size_t i = 0;i < 10; ++i) {
     thrs.launch(thread_stuff);
@@ -271,15 +314,19 @@ int main(int argc, char** argv) {
     }
   }
   mt.lock();
-  while (nlocksacquired != INITIAL_NLOCKS_TO_ACQUIRE + lockable_vertices.size()) cond.wait(mt);
+  while (nlocksacquired != initial_nlocks_to_acquire + lockable_vertices.size()) cond.wait(mt);
   mt.unlock();
+  const double locktime = locktimer.current_time();
   dc.barrier();
   locked_elements.stop_blocking();
   thrs.join();
-  std::cout << INITIAL_NLOCKS_TO_ACQUIRE + lockable_vertices.size() << " Locks to acquire\n";
+  std::cout << initial_nlocks_to_acquire + lockable_vertices.size() << " Locks to acquire\n";
   std::cout << nlocksacquired << " Locks Acquired in total\n";
+  std::cout << "Lock acquisitions per second: " << nlocksacquired / locktime << "\n";
+  std::cout << locks->num_remote_messages() << " lock messages sent in "
+            << locks->num_remote_calls() << " remote calls\n";
   boost::unordered_map<graphlab::vertex_id_type, size_t>::const_iterator iter = demand_set.begin();
-  bool bad = (nlocksacquired != INITIAL_NLOCKS_TO_ACQUIRE + lockable_vertices.size());
+  bool bad = (nlocksacquired != initial_nlocks_to_acquire + lockable_vertices.size());
   while (iter != demand_set.end()) {
     if(locked_set[iter->first] != iter->second) {
       std::cout << graph.l_get_vertex_record(iter->first).gvid << " mismatch: "
@@ -291,6 +338,10 @@ int main(int argc, char** argv) {
   if (bad) {
     locks->print_out();
   }
+  // a mirror which was released before it was set eating is left eating
+  locks->flush();
+  dc.full_barrier();
+  locks->no_locks_consistency_check();
   dc.barrier();
   graphlab::mpi_tools::finalize();
   return EXIT_SUCCESS;
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cxxtest/TestSuite.h>
+
+#include <graphlab/util/memory_info.hpp>
+#include <graphlab/rpc/distributed_event_log.hpp>
+
+using namespace graphlab;
+
+class event_log_memory_test : public CxxTest::TestSuite {
+public:
+
+  void test_memory_totals() {
+    const size_t MB = 1024 * 1024;
+    memory_info::tracked_size scheduler(memory_info::SCHEDULER);
+    memory_info::tracked_size gather_cache(memory_info::GATHER_CACHE);
+    scheduler.set(4 * MB);
+    gather_cache.set(2 * MB);
+
+    std::vector<std::vector<double> > by_machine =
+        get_event_log().gather_memory_megabytes();
+    TS_ASSERT_EQUALS(by_machine.size(), 1);
+    TS_ASSERT_EQUALS(by_machine[0].size(),
+                     size_t(memory_info::NUM_MEMORY_CATEGORIES));
+    TS_ASSERT_LESS_THAN_EQUALS(4, by_machine[0][memory_info::SCHEDULER]);
+    TS_ASSERT_LESS_THAN_EQUALS(2, by_machine[0][memory_info::GATHER_CACHE]);
+
+    // the total shown on memory.json includes the tracked sizes
+    const std::string json = get_event_log().memory_json();
+    const std::string name = std::string("\"name\": \"") +
+        memory_info::category_name(memory_info::SCHEDULER) + "\"";
+    size_t pos = json.find(name);
+    TS_ASSERT_DIFFERS(pos, std::string::npos);
+    pos = json.find("\"total\": ", pos);
+    TS_ASSERT_DIFFERS(pos, std::string::npos);
+    const double total = atof(json.c_str() + pos + strlen("\"total\": "));
+    TS_ASSERT_LESS_THAN_EQUALS(4, total);
+
+    scheduler.set(0);
+    TS_ASSERT_LESS_THAN(
+        get_event_log().local_memory_megabytes()[memory_info::SCHEDULER],
+        by_machine[0][memory_info::SCHEDULER]);
+  }
+};
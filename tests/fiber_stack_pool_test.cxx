@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <cstring>
+#include <set>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+
+#include <graphlab/parallel/fiber_stack_pool.hpp>
+
+using namespace graphlab;
+
+class fiber_stack_pool_test : public CxxTest::TestSuite {
+public:
+
+  void test_recycling() {
+    fiber_stack_pool pool(2, false, false);
+    size_t stacksize = 10000;
+    void* s = pool.allocate(0, stacksize);
+    TS_ASSERT_EQUALS(stacksize, 12288);
+    memset(s, 1, stacksize);
+    pool.deallocate(0, s, stacksize);
+    size_t stacksize2 = 12288;
+    TS_ASSERT_EQUALS(pool.allocate(0, stacksize2), s);
+    pool.deallocate(0, s, stacksize2);
+    // one slab serves all the stacks it holds
+    TS_ASSERT_EQUALS(pool.bytes_mapped(), fiber_stack_pool::SLAB_SIZE);
+    TS_ASSERT_EQUALS(pool.num_allocated(), 2);
+  }
+
+  void test_spill() {
+    // stacks freed on one worker beyond max_local_stacks() are reused
+    // by another
+    fiber_stack_pool pool(2, false, false);
+    const size_t n = 2 * fiber_stack_pool::max_local_stacks();
+    std::vector<void*> stacks;
+    std::set<void*> distinct;
+    for (size_t i = 0; i < n; ++i) {
+      size_t stacksize = 16384;
+      stacks.push_back(pool.allocate(0, stacksize));
+      distinct.insert(stacks.back());
+    }
+    TS_ASSERT_EQUALS(distinct.size(), n);
+    const size_t mapped = pool.bytes_mapped();
+    for (size_t i = 0; i < n; ++i) pool.deallocate(1, stacks[i], 16384);
+    for (size_t i = 0; i < n / 2; ++i) {
+      size_t stacksize = 16384;
+      TS_ASSERT_EQUALS(distinct.count(pool.allocate(0, stacksize)), 1);
+    }
+    TS_ASSERT_EQUALS(pool.bytes_mapped(), mapped);
+  }
+
+  void test_peak_usage() {
+    fiber_stack_pool pool(1, false, true);
+    TS_ASSERT(pool.tracking_usage());
+    size_t stacksize = 16384;
+    char* s = reinterpret_cast<char*>(pool.allocate(0, stacksize));
+    // the stack grows down from its top
+    memset(s + stacksize - 1000, 0, 1000);
+    pool.deallocate(0, s, stacksize);
+    TS_ASSERT_EQUALS(pool.peak_usage(16384), 1000);
+    s = reinterpret_cast<char*>(pool.allocate(0, stacksize));
+    memset(s + stacksize - 200, 0, 200);
+    pool.deallocate(0, s, stacksize);
+    // the peak is kept, and the stack was repainted
+    TS_ASSERT_EQUALS(pool.peak_usage(16384), 1000);
+    s = reinterpret_cast<char*>(pool.allocate(0, stacksize));
+    pool.deallocate(0, s, stacksize);
+    TS_ASSERT_EQUALS(pool.peak_usage(8192), 0);
+  }
+};
@@ -1,8 +1,67 @@
 #include <iostream>
+#include <algorithm>
+#include <boost/bind.hpp>
 #include <graphlab/parallel/fiber_group.hpp>
+#include <graphlab/logger/assertions.hpp>
 #include <graphlab/util/timer.hpp>
 using namespace graphlab;
 int numticks = 0;
+
+// keeps its worker busy for a few milliseconds
+void busy_fiber() {
+  timer ti; ti.start();
+  while (ti.current_time() < 0.005) fiber_control::yield();
+}
+
+// launches all the fibers from the worker running it
+void skewed_launcher(size_t nfibers) {
+  for (size_t i = 0;i < nfibers; ++i) {
+    fiber_control::get_instance().launch(busy_fiber);
+  }
+}
+
+// Launches the fibers from a single worker: the other workers only
+// get work by stealing it.
+void test_skewed_launch() {
+  fiber_control& fc = fiber_control::get_instance();
+  const size_t steals = fc.total_steals();
+  fc.launch(boost::bind(skewed_launcher, 1000));
+  fc.join();
+  ASSERT_GT(fc.total_steals(), steals);
+  std::cout << "Skewed launch: " << fc.total_steals() - steals
+            << " fibers stolen\n";
+}
+
+int wrong_worker = 0;
+
+// checks that the fiber never runs on another worker than the one it
+// is pinned to
+void pinned_fiber(size_t worker) {
+  timer ti; ti.start();
+  while (ti.current_time() < 0.005) {
+    if (fiber_control::get_worker_id() != worker) {
+      __sync_fetch_and_add(&wrong_worker, 1);
+    }
+    fiber_control::yield();
+  }
+}
+
+// Fibers pinned to one worker are never stolen, even while the other
+// workers look for work.
+void test_pinned_affinity() {
+  fiber_control& fc = fiber_control::get_instance();
+  const size_t worker = fc.num_workers() - 1;
+  fiber_control::affinity_type affinity;
+  affinity.clear();
+  affinity.set_bit(worker);
+  for (size_t i = 0;i < 200; ++i) {
+    fc.launch(boost::bind(pinned_fiber, worker), 8192, affinity);
+  }
+  fc.launch(boost::bind(skewed_launcher, 200));
+  fc.join();
+  ASSERT_EQ(wrong_worker, 0);
+  std::cout << "Pinned fibers ran only on worker " << worker << "\n";
+}
 void threadfn() {
 
   timer ti; ti.start();
@@ -25,6 +84,12 @@ void threadfn2() {
 }
 
 int main(int argc, char** argv) {
+  // stealing needs several workers even on machines with few cores
+  fiber_control::instance_set_parameters(
+      std::max<size_t>(thread::cpu_count(), 4), 0);
+  test_skewed_launch();
+  test_pinned_affinity();
+
   timer ti; ti.start();
   fiber_group group;
   fiber_group group2;
@@ -38,4 +103,8 @@ int main(int argc, char** argv) {
   group2.join();
   std::cout << "Completion in " << ti.current_time() << "s\n";
   std::cout << "Context Switches: " << numticks << "\n";
+  std::cout << "Fibers Stolen: "
+            << fiber_control::get_instance().total_steals() << "\n";
+  std::cout << "Worker Idle Time: "
+            << fiber_control::get_instance().total_idle_time() << "s\n";
 }
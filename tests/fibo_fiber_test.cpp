@@ -68,4 +68,7 @@ int main(int argc, char** argv) {
 
   std::cout << "Completion in " << ti.current_time() << "s\n";
   std::cout << fiber_control::get_instance().total_threads_created() << " threads created\n";
+  std::cout << fiber_control::get_instance().total_steals() << " fibers stolen\n";
+  std::cout << "Worker idle time: "
+            << fiber_control::get_instance().total_idle_time() << "s\n";
 }
@@ -1,5 +1,6 @@
 #include <graphlab/util/hopscotch_table.hpp>
 #include <graphlab/util/hopscotch_map.hpp>
+#include <graphlab/util/swiss_map.hpp>
 #include <graphlab/util/cuckoo_map_pow2.hpp>
 #include <boost/unordered_set.hpp>
 #include <boost/bind.hpp>
@@ -79,6 +80,70 @@ void hopscotch_map_sanity_checks() {
 
 
 
+graphlab::swiss_map<uint32_t, uint32_t> sm2;
+
+void swiss_map_sanity_checks() {
+  const size_t NINS = 1500000;
+  boost::unordered_map<uint32_t, uint32_t> um2;
+  ASSERT_TRUE(sm2.begin() == sm2.end());
+  for (size_t i = 0;i < NINS; ++i) {
+    sm2[17 * i] = i;
+    um2[17 * i] = i;
+  }
+
+  for (size_t i = 0;i < NINS; ++i) {
+    ASSERT_EQ(sm2[17 * i], i);
+  }
+  ASSERT_EQ(sm2.size(), NINS);
+
+  for (size_t i = 0;i < NINS; i+=2) {
+    sm2.erase(17*i);
+    um2.erase(17*i);
+  }
+  for (size_t i = 0;i < NINS; ++i) {
+    ASSERT_EQ(sm2.count(17*i), i % 2);
+    if (sm2.count(17*i)) {
+      ASSERT_EQ(sm2.find(17*i)->second, i);
+    }
+  }
+  ASSERT_EQ(sm2.size(), NINS / 2);
+
+  // reinsert into the deleted slots
+  for (size_t i = 0;i < NINS; i+=2) {
+    ASSERT_TRUE(sm2.insert(std::make_pair(uint32_t(17 * i), uint32_t(i))).second);
+    um2[17 * i] = i;
+  }
+  ASSERT_EQ(sm2.size(), NINS);
+
+  typedef graphlab::swiss_map<uint32_t, uint32_t>::value_type vpair;
+  {
+    size_t cnt = 0;
+    foreach(const vpair &v, sm2) {
+      ASSERT_EQ(v.second, um2[v.first]);
+      ++cnt;
+    }
+    ASSERT_EQ(cnt, NINS);
+  }
+
+  std::stringstream strm;
+  graphlab::oarchive oarc(strm);
+  oarc << sm2;
+  strm.flush();
+
+  sm2.clear();
+  ASSERT_EQ(sm2.size(), 0);
+  graphlab::iarchive iarc(strm);
+  iarc >> sm2;
+  ASSERT_EQ(sm2.size(), NINS);
+  for (size_t i = 0;i < NINS; ++i) {
+    ASSERT_EQ(sm2[17 * i], i);
+  }
+}
+
+
+
+
+
 struct bad_hasher {
   size_t operator()(uint32_t a) const {
     return 1;
@@ -159,6 +224,29 @@ void hopscotch_high_collision_sanity_checks() {
 
 
 
+void swiss_high_collision_sanity_checks() {
+  const size_t NINS = 15000;
+  graphlab::swiss_map<uint32_t, uint32_t, bad_hasher> sm2;
+  for (size_t i = 0;i < NINS; ++i) {
+    sm2[17 * i] = i;
+  }
+  ASSERT_EQ(sm2.size(), NINS);
+  for (size_t i = 0;i < NINS; i+=2) {
+    sm2.erase(17*i);
+  }
+  for (size_t i = 0;i < NINS; ++i) {
+    ASSERT_EQ(sm2.count(17*i), i % 2);
+    if (sm2.count(17*i)) {
+      ASSERT_EQ(sm2.find(17*i)->second, i);
+    }
+  }
+  ASSERT_EQ(sm2.size(), NINS / 2);
+}
+
+
+
+
+
 void benchmark() {
   graphlab::timer ti;
 
@@ -233,6 +321,39 @@ void benchmark() {
     }
     std::cout << "10M hopscotch successful probes in " << ti.current_time() << std::endl;
 
+    ti.start();
+    size_t found = 0;
+    for (size_t i = 0;i < 10000000; ++i) {
+      found += cm.find(u + v[i]) != cm.end();
+    }
+    ASSERT_EQ(found, 0);
+    std::cout << "10M hopscotch unsuccessful probes in " << ti.current_time() << std::endl;
+  }
+
+  {
+    graphlab::swiss_map<uint32_t, uint32_t> cm;
+    ti.start();
+    for (size_t i = 0;i < NUM_ELS; ++i) {
+      cm[v[i]] = i;
+    }
+    std::cout << NUM_ELS / 1000000 << "M swiss map inserts in " << ti.current_time() << " (Load factor = " << cm.load_factor() << ")" << std::endl;
+
+    graphlab::memory_info::print_usage();
+
+    ti.start();
+    for (size_t i = 0;i < 10000000; ++i) {
+      size_t t = cm[v[i]];
+      assert(t == i);
+    }
+    std::cout << "10M swiss map successful probes in " << ti.current_time() << std::endl;
+
+    ti.start();
+    size_t found = 0;
+    for (size_t i = 0;i < 10000000; ++i) {
+      found += cm.find(u + v[i]) != cm.end();
+    }
+    ASSERT_EQ(found, 0);
+    std::cout << "10M swiss map unsuccessful probes in " << ti.current_time() << std::endl;
   }
 }
 
@@ -245,6 +366,12 @@ int main(int argc, char** argv) {
   std::cout << "Hopscotch High Collision Sanity Checks... \n";
   hopscotch_high_collision_sanity_checks();
 
+  std::cout << "Swiss Map Sanity Checks... \n";
+  swiss_map_sanity_checks();
+
+  std::cout << "Swiss Map High Collision Sanity Checks... \n";
+  swiss_high_collision_sanity_checks();
+
   std::cout << "Map Benchmarks... \n";
   benchmark();
   std::cout << "Done" << std::endl;
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <vector>
+#include <boost/bind.hpp>
+#include <cxxtest/TestSuite.h>
+
+#include <graphlab/scheduler/multiqueue_scheduler.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+
+using namespace graphlab;
+
+const size_t NUM_VERTICES = 1000;
+
+void multiqueue_worker(multiqueue_scheduler* sched, size_t cpuid,
+                       std::vector<atomic<size_t> >* counts) {
+  lvid_type vid;
+  while (sched->get_next(cpuid, vid) == sched_status::NEW_TASK) {
+    (*counts)[vid].inc();
+  }
+}
+
+class multiqueue_scheduler_test : public CxxTest::TestSuite {
+public:
+
+  void test_priority_order() {
+    // with a single queue the buckets are popped in priority order
+    graphlab_options opts;
+    opts.set_ncpus(1);
+    opts.get_scheduler_args().set_option("multi", 1);
+    multiqueue_scheduler sched(NUM_VERTICES, opts);
+    for (size_t i = 0; i < NUM_VERTICES; ++i) {
+      sched.schedule(i, double(i % 100) / 8);
+    }
+    // raising a priority moves the vertex up. Lowering it does not.
+    sched.schedule(0, 1000);
+    sched.schedule(999, 0);
+    std::vector<size_t> count(NUM_VERTICES, 0);
+    lvid_type vid;
+    TS_ASSERT_EQUALS(sched.get_next(0, vid), sched_status::NEW_TASK);
+    TS_ASSERT_EQUALS(vid, 0);
+    ++count[vid];
+    double last_priority = 1000;
+    while (sched.get_next(0, vid) == sched_status::NEW_TASK) {
+      const double priority = double(vid % 100) / 8;
+      // within a bucket (a quarter of a doubling) order is arbitrary
+      TS_ASSERT_LESS_THAN_EQUALS(priority, last_priority * 1.25);
+      last_priority = priority;
+      ++count[vid];
+    }
+    for (size_t i = 0; i < NUM_VERTICES; ++i) TS_ASSERT_EQUALS(count[i], 1);
+    TS_ASSERT(sched.empty());
+  }
+
+  void test_parallel() {
+    const size_t ncpus = 4;
+    graphlab_options opts;
+    opts.set_ncpus(ncpus);
+    multiqueue_scheduler sched(NUM_VERTICES, opts);
+    for (size_t i = 0; i < NUM_VERTICES; ++i) sched.schedule(i, i);
+    // scheduling a scheduled vertex again does not duplicate it
+    for (size_t i = 0; i < NUM_VERTICES; ++i) sched.schedule(i, 2 * i);
+    std::vector<atomic<size_t> > counts(NUM_VERTICES);
+    thread_group group;
+    for (size_t i = 0; i < ncpus; ++i) {
+      group.launch(boost::bind(multiqueue_worker, &sched, i, &counts));
+    }
+    group.join();
+    for (size_t i = 0; i < NUM_VERTICES; ++i) {
+      TS_ASSERT_EQUALS(counts[i].value, 1);
+    }
+    TS_ASSERT(sched.empty());
+  }
+};
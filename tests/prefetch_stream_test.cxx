@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+#include <cxxtest/TestSuite.h>
+
+#include <graphlab/util/prefetch_stream.hpp>
+
+using namespace graphlab;
+
+class prefetch_stream_test : public CxxTest::TestSuite {
+public:
+
+  // reads a split of the file through a prefetch_device
+  std::string read_split(const std::string& filename, size_t begin,
+                         size_t end, size_t block_size) {
+    prefetch_device device(new posix_random_access_file(filename),
+                           begin, end, block_size, 2);
+    prefetch_stream strm(device);
+    std::stringstream out;
+    out << strm.rdbuf();
+    return out.str();
+  }
+
+  void test_splits_read_every_line_once() {
+    const std::string filename = "prefetch_stream_test.txt";
+    std::string contents;
+    for (size_t i = 0; i < 300; ++i) {
+      // some lines are longer than the blocks and the splits
+      contents += std::string(i % 7 == 0 ? 300 : i % 50, 'a' + i % 26) + "\n";
+    }
+    // the last line has no newline
+    contents += "last";
+    std::ofstream fout(filename.c_str(), std::ios::binary);
+    fout << contents;
+    fout.close();
+
+    const size_t split_sizes[] = {3, 17, 1000, 4096, contents.size()};
+    const size_t block_sizes[] = {1, 100, 1 << 20};
+    for (size_t s = 0; s < 5; ++s) {
+      for (size_t b = 0; b < 3; ++b) {
+        std::vector<file_split> splits;
+        split_files(std::vector<std::string>(1, filename),
+                    std::vector<size_t>(1, contents.size()),
+                    split_sizes[s], splits);
+        std::string result;
+        for (size_t i = 0; i < splits.size(); ++i) {
+          result += read_split(filename, splits[i].begin, splits[i].end,
+                               block_sizes[b]);
+        }
+        TS_ASSERT_EQUALS(result, contents);
+      }
+    }
+    // the consumer may stop before the end
+    {
+      prefetch_device device(new posix_random_access_file(filename),
+                             0, size_t(-1), 100, 2);
+      prefetch_stream strm(device);
+      std::string line;
+      std::getline(strm, line);
+      TS_ASSERT_EQUALS(line.length(), 300);
+    }
+    remove(filename.c_str());
+  }
+
+  void test_compressed_files_are_not_split() {
+    std::vector<std::string> files;
+    files.push_back("a.gz");
+    files.push_back("b");
+    std::vector<size_t> sizes(2, 1000);
+    std::vector<file_split> splits;
+    split_files(files, sizes, 300, splits);
+    TS_ASSERT_EQUALS(splits.size(), 5);
+    TS_ASSERT_EQUALS(splits[0].end, 1000);
+    TS_ASSERT_EQUALS(splits[1].begin, 0);
+    TS_ASSERT_EQUALS(splits[4].end, 1000);
+  }
+};
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include <cxxtest/TestSuite.h>
+
+#include <graphlab/util/region_allocator.hpp>
+
+using namespace graphlab;
+
+class region_allocator_test : public CxxTest::TestSuite {
+public:
+
+  void test_chunks_are_returned() {
+    region_allocator region(1 << 16);
+    std::vector<char*> ptrs;
+    for (size_t i = 0; i < 100; ++i) {
+      char* p = reinterpret_cast<char*>(region.allocate(1000));
+      TS_ASSERT_EQUALS(reinterpret_cast<size_t>(p) % 16, 0);
+      memset(p, (int)i, 1000);
+      ptrs.push_back(p);
+    }
+    TS_ASSERT_LESS_THAN_EQUALS(region.bytes_mapped(), 3 * (1 << 16));
+    // a large allocation gets a chunk of its own
+    void* large = region.allocate(1 << 20);
+    TS_ASSERT_LESS_THAN(1 << 20, region.bytes_mapped());
+    region.deallocate(large);
+    TS_ASSERT_LESS_THAN_EQUALS(region.bytes_mapped(), 3 * (1 << 16));
+    for (size_t i = 0; i < ptrs.size(); ++i) {
+      TS_ASSERT_EQUALS(ptrs[i][999], (char)i);
+      region.deallocate(ptrs[i]);
+    }
+    // only the current chunk is left
+    TS_ASSERT_EQUALS(region.bytes_mapped(), 1 << 16);
+    region.release();
+    TS_ASSERT_EQUALS(region.bytes_mapped(), 0);
+  }
+
+  void test_chunked_array() {
+    chunked_array<size_t> arr;
+    const size_t n = 3 * chunked_array<size_t>::SEGMENT_BYTES / sizeof(size_t) + 7;
+    for (size_t i = 0; i < n; ++i) arr.push_back(i);
+    TS_ASSERT_EQUALS(arr.size(), n);
+    TS_ASSERT_EQUALS(arr[n - 1], n - 1);
+    std::vector<size_t> out(1, 42);
+    arr.move_to(out);
+    TS_ASSERT_EQUALS(arr.size(), 0);
+    TS_ASSERT_EQUALS(out.size(), n + 1);
+    for (size_t i = 0; i < n; ++i) TS_ASSERT_EQUALS(out[i + 1], i);
+
+    chunked_array<std::string> strs;
+    for (size_t i = 0; i < 1000; ++i) strs.push_back(std::string(i % 50, 'a'));
+    chunked_array<std::string> copy(strs);
+    strs.clear();
+    std::vector<std::string> sout;
+    copy.move_to(sout);
+    TS_ASSERT_EQUALS(sout.size(), 1000);
+    TS_ASSERT_EQUALS(sout[999].length(), 999 % 50);
+  }
+
+  void test_memory_accounting() {
+    const size_t before = memory_info::category_bytes(memory_info::RPC_BUFFERS);
+    {
+      region_allocator region(1 << 16, memory_info::RPC_BUFFERS);
+      region.allocate(100);
+      TS_ASSERT_EQUALS(memory_info::category_bytes(memory_info::RPC_BUFFERS),
+                       before + region.bytes_mapped());
+      memory_info::tracked_size tracked(memory_info::RPC_BUFFERS);
+      tracked.set(1000);
+      tracked.set(500);
+      TS_ASSERT_EQUALS(memory_info::category_bytes(memory_info::RPC_BUFFERS),
+                       before + region.bytes_mapped() + 500);
+    }
+    TS_ASSERT_EQUALS(memory_info::category_bytes(memory_info::RPC_BUFFERS),
+                     before);
+  }
+};
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+
+#include <sstream>
+#include <cxxtest/TestSuite.h>
+
+#include <boost/bind.hpp>
+#include <graphlab/engine/residual_tracker.hpp>
+#include <graphlab/parallel/fiber_group.hpp>
+
+using namespace graphlab;
+
+const lvid_type NUM_CONCURRENT_VERTICES = 64;
+const size_t NUM_CONCURRENT_REPORTS = 20000;
+
+// alternates the residuals of a range of vertices between 2 and 1,
+// yielding between the two so that the fiber may move to another worker
+// and the reports of a vertex are spread over the workers
+void report_alternating(residual_tracker* tracker, lvid_type begin,
+                        lvid_type end, volatile size_t* nrunning) {
+  for (size_t i = 0; i < NUM_CONCURRENT_REPORTS; ++i) {
+    for (lvid_type v = begin; v < end; ++v) tracker->report(v, 2);
+    fiber_control::yield();
+    for (lvid_type v = begin; v < end; ++v) tracker->report(v, 1);
+    fiber_control::yield();
+  }
+  __sync_fetch_and_sub(nrunning, 1);
+}
+
+class residual_tracker_test : public CxxTest::TestSuite {
+public:
+
+  void test_residual_bucket() {
+    TS_ASSERT_EQUALS(residual_tracker::residual_bucket(0), 0);
+    TS_ASSERT_EQUALS(residual_tracker::residual_bucket(1e-30), 0);
+    TS_ASSERT_EQUALS(residual_tracker::residual_bucket(0.5),
+                     residual_tracker::residual_bucket(0.75));
+    TS_ASSERT_EQUALS(residual_tracker::residual_bucket(1) -
+                     residual_tracker::residual_bucket(0.5), 1);
+    TS_ASSERT_EQUALS(residual_tracker::residual_bucket(1e300),
+                     residual_tracker::NUM_BUCKETS - 1);
+    for (double r = 1e-20; r < 1e10; r *= 3.7) {
+      const size_t b = residual_tracker::residual_bucket(r);
+      TS_ASSERT_LESS_THAN(r, residual_tracker::bucket_limit(b));
+      TS_ASSERT_LESS_THAN_EQUALS(residual_tracker::bucket_limit(b), 2 * r);
+    }
+  }
+
+  void test_report() {
+    residual_tracker tracker;
+    tracker.init(2, 10, 0, 0);
+    TS_ASSERT(!tracker.enabled());
+    tracker.init(2, 10, 0.5, 0);
+    TS_ASSERT(tracker.enabled());
+    // reported from outside the fibers
+    for (lvid_type i = 0; i < 9; ++i) tracker.report(i, 1);
+    residual_tracker::summary s = tracker.get_summary();
+    TS_ASSERT_EQUALS(s.count, 9);
+    TS_ASSERT_DELTA(s.l1, 9, 1e-9);
+    TS_ASSERT_EQUALS(s.linf(), 2);
+    // not every vertex has reported
+    TS_ASSERT(!tracker.converged(s, 10));
+    // later reports replace the earlier ones
+    for (lvid_type i = 0; i < 10; ++i) tracker.report(i, -0.01);
+    s = tracker.get_summary();
+    TS_ASSERT_EQUALS(s.count, 10);
+    TS_ASSERT_DELTA(s.l1, 0.1, 1e-6);
+    TS_ASSERT_LESS_THAN_EQUALS(s.linf(), 0.02);
+    TS_ASSERT(tracker.converged(s, 10));
+    // a machine which has not reported keeps the total from converging
+    TS_ASSERT(!tracker.converged(s, 20));
+    std::stringstream strm;
+    residual_tracker::write_histogram(s, strm);
+    std::string line;
+    size_t nlines = 0;
+    while (std::getline(strm, line)) ++nlines;
+    TS_ASSERT_EQUALS(nlines, 1 + 1);
+    tracker.reset();
+    TS_ASSERT_EQUALS(tracker.get_summary().count, 0);
+  }
+
+  void test_linf_tolerance() {
+    residual_tracker tracker;
+    tracker.init(1, 4, 0, 1e-3);
+    for (lvid_type i = 0; i < 4; ++i) tracker.report(i, 1e-5);
+    tracker.report(2, 0.1);
+    residual_tracker::summary s = tracker.get_summary();
+    TS_ASSERT(!tracker.converged(s, 4));
+    tracker.report(2, 1e-5);
+    s = tracker.get_summary();
+    TS_ASSERT(tracker.converged(s, 4));
+    s.consistent = false;
+    TS_ASSERT(!tracker.converged(s, 4));
+    // NaN never converges
+    tracker.report(1, 0.0 / 0.0);
+    TS_ASSERT(!tracker.converged(tracker.get_summary(), 4));
+  }
+
+  void test_concurrent_summary() {
+    const size_t nworkers = fiber_control::get_instance().num_workers();
+    residual_tracker tracker;
+    tracker.init(nworkers, NUM_CONCURRENT_VERTICES, 1, 0);
+    for (lvid_type i = 0; i < NUM_CONCURRENT_VERTICES; ++i) {
+      tracker.report(i, 1);
+    }
+    const size_t nfibers = 4;
+    volatile size_t nrunning = nfibers;
+    fiber_group group;
+    const lvid_type range = NUM_CONCURRENT_VERTICES / nfibers;
+    for (size_t i = 0; i < nfibers; ++i) {
+      group.launch(boost::bind(report_alternating, &tracker, i * range,
+                               (i + 1) * range, &nrunning));
+    }
+    // every vertex always has a residual of at least 1. A summary which
+    // may be torn by concurrent reports must say so
+    while (nrunning > 0) {
+      residual_tracker::summary s = tracker.get_summary();
+      if (!s.consistent) {
+        TS_ASSERT(!tracker.converged(s, NUM_CONCURRENT_VERTICES));
+        continue;
+      }
+      TS_ASSERT_EQUALS(s.count, NUM_CONCURRENT_VERTICES);
+      TS_ASSERT_LESS_THAN_EQUALS(NUM_CONCURRENT_VERTICES - 1e-6, s.l1);
+      TS_ASSERT_LESS_THAN_EQUALS(2, s.linf());
+    }
+    group.join();
+    residual_tracker::summary s = tracker.get_summary();
+    TS_ASSERT(s.consistent);
+    TS_ASSERT_DELTA(s.l1, NUM_CONCURRENT_VERTICES, 1e-6);
+  }
+
+  void test_combine() {
+    residual_tracker::summary a, b;
+    a.l1 = 1; a.count = 2; a.buckets[3] = 2;
+    b.l1 = 0.5; b.count = 1; b.buckets[5] = 1;
+    a += b;
+    TS_ASSERT_EQUALS(a.l1, 1.5);
+    TS_ASSERT_EQUALS(a.count, 3);
+    TS_ASSERT_EQUALS(a.buckets[3], 2);
+    TS_ASSERT_EQUALS(a.buckets[5], 1);
+    TS_ASSERT_EQUALS(a.linf(), residual_tracker::bucket_limit(5));
+    // a summary combined with one which may be torn is not consistent
+    TS_ASSERT(a.consistent);
+    b.consistent = false;
+    a += b;
+    TS_ASSERT(!a.consistent);
+  }
+};
@@ -36,6 +36,7 @@
 
 #include <graphlab/util/generics/any.hpp>
 #include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/serialization/delta_encoding.hpp>
 
 
 using namespace graphlab;
@@ -414,5 +415,93 @@ public:
         TS_ASSERT_EQUALS(p1[i].x, p2[i].x);
     }
   }
+  void test_compact_integers() {
+    oarchive a;
+    a.compact = true;
+    std::vector<std::string> strs(3, "abc");
+    a << int(-1) << int(300) << uint32_t(0xFFFFFFFF) << size_t(5)
+      << int64_t(-(1LL << 40)) << uint16_t(127) << 'c' << 1.5 << strs;
+    // a small negative int, zigzag encoded, takes a single byte
+    oarchive b;
+    b.compact = true;
+    b << int(-1);
+    TS_ASSERT_EQUALS(b.off, 1);
+
+    iarchive c(a.buf, a.off);
+    c.compact = true;
+    int i1, i2; uint32_t u; size_t s; int64_t l; uint16_t h; char ch;
+    double d; std::vector<std::string> strs2;
+    c >> i1 >> i2 >> u >> s >> l >> h >> ch >> d >> strs2;
+    TS_ASSERT_EQUALS(i1, -1);
+    TS_ASSERT_EQUALS(i2, 300);
+    TS_ASSERT_EQUALS(u, 0xFFFFFFFF);
+    TS_ASSERT_EQUALS(s, 5);
+    TS_ASSERT_EQUALS(l, -(1LL << 40));
+    TS_ASSERT_EQUALS(h, 127);
+    TS_ASSERT_EQUALS(ch, 'c');
+    TS_ASSERT_EQUALS(d, 1.5);
+    TS_ASSERT_EQUALS(strs2.size(), 3);
+    TS_ASSERT_EQUALS(strs2[2], "abc");
+    TS_ASSERT_EQUALS(c.off, a.off);
+    free(a.buf);
+    free(b.buf);
+  }
+
+  void test_delta_encoding() {
+    sorted_id_batch<uint32_t> batch;
+    for (uint32_t i = 0; i < 1000; ++i) batch.ids.push_back(1000000 + 3 * i);
+    batch.ids.push_back(5);
+    oarchive a;
+    a << batch;
+    // one byte per delta, plus the count and the two large jumps
+    TS_ASSERT_LESS_THAN(a.off, 1100);
+    sorted_id_batch<uint32_t> batch2;
+    iarchive b(a.buf, a.off);
+    b >> batch2;
+    TS_ASSERT(batch.ids == batch2.ids);
+    free(a.buf);
+  }
+
+  void test_raw_serialized() {
+    using archive_detail::is_raw_serialized;
+    TS_ASSERT(is_raw_serialized<double>(false));
+    TS_ASSERT(is_raw_serialized<double>(true));
+    TS_ASSERT(is_raw_serialized<uint32_t>(false));
+    TS_ASSERT(!is_raw_serialized<uint32_t>(true));
+    TS_ASSERT(!is_raw_serialized<unsigned long>(false));
+    TS_ASSERT(!is_raw_serialized<std::string>(false));
+    // a raw serialized sequence is exactly the bytes of the values
+    std::vector<uint32_t> v;
+    for (uint32_t i = 0; i < 100; ++i) v.push_back(i * 65537);
+    oarchive a;
+    for (size_t i = 0; i < v.size(); ++i) a << v[i];
+    TS_ASSERT_EQUALS(a.off, v.size() * sizeof(uint32_t));
+    TS_ASSERT_SAME_DATA(a.buf, &(v[0]), a.off);
+    free(a.buf);
+  }
+
+  void test_deserialize_sequence() {
+    std::vector<uint32_t> v;
+    for (uint32_t i = 0; i < 100; ++i) v.push_back(i * 65537);
+    std::vector<std::string> strs(3, "abc");
+    for (int compact = 0; compact < 2; ++compact) {
+      oarchive a;
+      a.compact = compact;
+      for (size_t i = 0; i < v.size(); ++i) a << v[i];
+      for (size_t i = 0; i < strs.size(); ++i) a << strs[i];
+      iarchive b(a.buf, a.off);
+      b.compact = compact;
+      std::vector<uint32_t> v2(v.size());
+      archive_detail::deserialize_sequence<iarchive, uint32_t>::
+          exec(b, &(v2[0]), v2.size());
+      std::vector<std::string> strs2(strs.size());
+      archive_detail::deserialize_sequence<iarchive, std::string>::
+          exec(b, &(strs2[0]), strs2.size());
+      TS_ASSERT(v == v2);
+      TS_ASSERT(strs == strs2);
+      TS_ASSERT_EQUALS(b.off, a.off);
+      free(a.buf);
+    }
+  }
 };
 
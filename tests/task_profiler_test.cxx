@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <sstream>
+#include <cxxtest/TestSuite.h>
+
+#include <graphlab/engine/task_profiler.hpp>
+
+using namespace graphlab;
+
+class task_profiler_test : public CxxTest::TestSuite {
+public:
+
+  void test_degree_bucket() {
+    TS_ASSERT_EQUALS(task_profiler::degree_bucket(0), 0);
+    TS_ASSERT_EQUALS(task_profiler::degree_bucket(1), 1);
+    TS_ASSERT_EQUALS(task_profiler::degree_bucket(3), 2);
+    TS_ASSERT_EQUALS(task_profiler::degree_bucket(4), 3);
+    TS_ASSERT_EQUALS(task_profiler::degree_bucket(size_t(-1)),
+                     task_profiler::NUM_DEGREE_BUCKETS - 1);
+  }
+
+  void test_sampling() {
+    task_profiler profiler;
+    TS_ASSERT(!profiler.enabled());
+    profiler.init(2, 0.25);
+    TS_ASSERT(profiler.enabled());
+    size_t nsampled = 0;
+    for (size_t i = 0; i < 100; ++i) {
+      if (profiler.sample(0)) {
+        task_profiler::task_record rec;
+        rec.begin(i);
+        rec.end_phase(task_profiler::GATHER);
+        profiler.add(0, rec);
+        ++nsampled;
+      }
+    }
+    TS_ASSERT_EQUALS(nsampled, 25);
+    task_profiler::histogram hist = profiler.get_histogram();
+    double ntasks = 0;
+    for (size_t b = 0; b < hist.buckets.size(); ++b) {
+      ntasks += hist.buckets[b].ntasks;
+    }
+    TS_ASSERT_EQUALS(ntasks, 25);
+    // tasks 0, 4, 8, ... 96 land in buckets 0 and 3 to 7
+    std::stringstream strm;
+    task_profiler::write_histogram(hist, strm);
+    std::string line;
+    size_t nlines = 0;
+    while (std::getline(strm, line)) ++nlines;
+    TS_ASSERT_EQUALS(nlines, 1 + 6);
+    TS_ASSERT(task_profiler::histogram_json(hist).find("\"tasks\"") !=
+              std::string::npos);
+    profiler.reset();
+    TS_ASSERT_EQUALS(profiler.get_histogram().buckets[0].ntasks, 0);
+  }
+};
@@ -139,6 +139,23 @@ int main(int argc, char** argv) {
   dc.cout() << graph.vertex_set_size(out_nbrs_in_nbrs) << " nbr nbr size\n";
   // this set must contain the original out_deg_one set
   ASSERT_TRUE(graph.vertex_set_empty((out_deg_one & out_nbrs_in_nbrs) - out_deg_one));
+
+  // small sets are stored as lists of vertices
+  graphlab::vertex_set div_1000_id = graph.select(boost::bind(select_vid_modulo, _1, 1000));
+  ASSERT_TRUE(div_1000_id.is_sparse());
+  size_t num_div_1000 = graph.map_reduce_vertices<size_t>(boost::bind(is_divisible, _1, 1000));
+  ASSERT_EQ(graph.vertex_set_size(div_1000_id), num_div_1000);
+  ASSERT_EQ(graph.vertex_set_size(div_1000_id & div_6_id), 1 + (graph.num_vertices() - 1) / 3000);
+  ASSERT_EQ(graph.vertex_set_size(div_1000_id | div_6_id), 
+            num_div_6 + num_div_1000 - (1 + (graph.num_vertices() - 1) / 3000));
+  ASSERT_EQ(graph.vertex_set_size(~div_1000_id), graph.num_vertices() - num_div_1000);
+  graphlab::vertex_set sparse_nbrs = graph.neighbors(div_1000_id, graphlab::OUT_EDGES);
+  graphlab::vertex_set dense_div_1000_id = div_1000_id;
+  dense_div_1000_id.make_explicit(graph);
+  ASSERT_FALSE(dense_div_1000_id.is_sparse());
+  graphlab::vertex_set dense_nbrs = graph.neighbors(dense_div_1000_id, graphlab::OUT_EDGES);
+  ASSERT_TRUE(graph.vertex_set_empty(sparse_nbrs - dense_nbrs));
+  ASSERT_TRUE(graph.vertex_set_empty(dense_nbrs - sparse_nbrs));
   graphlab::mpi_tools::finalize();
 }
 
@@ -0,0 +1,475 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+#include <graphlab.hpp>
+#include <graphlab/parallel/lockfree_push_back.hpp>
+
+/*
+ * Approximate betweenness and closeness centrality on unweighted graphs.
+ *
+ * Implements Brandes' algorithm
+ *
+ *   U. Brandes. A Faster Algorithm for Betweenness Centrality (2001).
+ *
+ * over a uniform sample of source vertices (Brandes and Pich, 2007).
+ * Sources are processed in batches of 64: every vertex keeps one bit per
+ * source of the batch, so a single breadth first traversal advances the
+ * frontiers of all 64 sources at once (multi-source BFS), and a single
+ * backward sweep accumulates all 64 dependencies.
+ */
+
+// The number of sources traversed together. One bit per source.
+const size_t BATCH_SIZE = 64;
+const uint16_t UNREACHED = 0xFFFF;
+
+/**
+ * \brief The per vertex state of the current batch together with the
+ * accumulated centrality scores.
+ */
+struct vertex_data : graphlab::IS_POD_TYPE {
+  // sources of the batch which have reached this vertex
+  uint64_t visited;
+  // sources which reached this vertex in the last level
+  uint64_t frontier;
+  // distance from each source
+  uint16_t level[BATCH_SIZE];
+  // number of shortest paths from each source
+  double sigma[BATCH_SIZE];
+  // dependency of each source on this vertex
+  double delta[BATCH_SIZE];
+
+  // accumulated over all batches
+  double betweenness;
+  double farness;
+  size_t reached;
+
+  vertex_data() : betweenness(0), farness(0), reached(0) { reset_batch(); }
+
+  void reset_batch() {
+    visited = 0;
+    frontier = 0;
+    for (size_t i = 0; i < BATCH_SIZE; ++i) {
+      level[i] = UNREACHED;
+      sigma[i] = 0;
+      delta[i] = 0;
+    }
+  }
+
+  // the sources for which this vertex is at distance l
+  uint64_t sources_at_level(uint16_t l) const {
+    uint64_t ret = 0;
+    uint64_t bits = visited;
+    while (bits) {
+      size_t i = __builtin_ctzll(bits);
+      bits &= bits - 1;
+      if (level[i] == l) ret |= (uint64_t(1) << i);
+    }
+    return ret;
+  }
+}; // end of vertex data
+
+typedef graphlab::distributed_graph<vertex_data, graphlab::empty> graph_type;
+
+/**
+ * \brief Treat the graph as directed.
+ */
+bool DIRECTED = false;
+
+/**
+ * \brief The BFS level currently being expanded (forward) or
+ * accumulated (backward).
+ */
+uint16_t CURRENT_LEVEL = 0;
+
+inline graph_type::vertex_type
+get_other_vertex(const graph_type::edge_type& edge,
+                 const graph_type::vertex_type& vertex) {
+  return vertex.id() == edge.source().id()? edge.target() : edge.source();
+}
+
+/**
+ * \brief One value per source of the batch together with the mask of the
+ * sources which contributed. Used as the gather type of both sweeps.
+ */
+struct bit_parallel_sum : graphlab::IS_POD_TYPE {
+  uint64_t bits;
+  double value[BATCH_SIZE];
+  bit_parallel_sum() : bits(0) {
+    for (size_t i = 0; i < BATCH_SIZE; ++i) value[i] = 0;
+  }
+  bit_parallel_sum& operator+=(const bit_parallel_sum& other) {
+    bits |= other.bits;
+    uint64_t b = other.bits;
+    while (b) {
+      size_t i = __builtin_ctzll(b);
+      b &= b - 1;
+      value[i] += other.value[i];
+    }
+    return *this;
+  }
+};
+
+/**
+ * \brief The sources of the batch located at a vertex.
+ */
+struct source_mask : graphlab::IS_POD_TYPE {
+  uint64_t bits;
+  source_mask(uint64_t bits = 0) : bits(bits) { }
+  source_mask& operator+=(const source_mask& other) {
+    bits |= other.bits;
+    return *this;
+  }
+};
+
+
+/*
+ * Per machine lists of the vertices reached at each level, so the backward
+ * sweep only signals the vertices of the level it accumulates.
+ */
+struct level_bucket {
+  std::vector<graphlab::lvid_type> lvids;
+  graphlab::lockfree_push_back<std::vector<graphlab::lvid_type> > pusher;
+  level_bucket() : pusher(lvids, 0) { }
+};
+std::vector<level_bucket*> level_buckets;
+
+
+/**
+ * \brief Expands the frontiers of all the sources of the batch by one
+ * level, counting shortest paths.
+ */
+class forward_bfs :
+  public graphlab::ivertex_program<graph_type, bit_parallel_sum, source_mask>,
+  public graphlab::IS_POD_TYPE {
+  uint64_t sources;
+  uint64_t new_bits;
+public:
+  forward_bfs() : sources(0), new_bits(0) { }
+
+  void init(icontext_type& context, const vertex_type& vertex,
+            const source_mask& msg) {
+    sources = msg.bits;
+  }
+
+  edge_dir_type gather_edges(icontext_type& context,
+                             const vertex_type& vertex) const {
+    return DIRECTED ? graphlab::IN_EDGES : graphlab::ALL_EDGES;
+  }
+
+  bit_parallel_sum gather(icontext_type& context, const vertex_type& vertex,
+                          edge_type& edge) const {
+    const vertex_type other = get_other_vertex(edge, vertex);
+    bit_parallel_sum ret;
+    ret.bits = other.data().frontier & ~vertex.data().visited;
+    uint64_t b = ret.bits;
+    while (b) {
+      size_t i = __builtin_ctzll(b);
+      b &= b - 1;
+      ret.value[i] = other.data().sigma[i];
+    }
+    return ret;
+  }
+
+  void apply(icontext_type& context, vertex_type& vertex,
+             const bit_parallel_sum& total) {
+    vertex_data& vdata = vertex.data();
+    new_bits = (total.bits | sources) & ~vdata.visited;
+    vdata.visited |= new_bits;
+    vdata.frontier = new_bits;
+    uint64_t b = new_bits;
+    while (b) {
+      size_t i = __builtin_ctzll(b);
+      b &= b - 1;
+      vdata.level[i] = CURRENT_LEVEL;
+      vdata.sigma[i] = ((sources >> i) & 1) ? 1.0 : total.value[i];
+      if (CURRENT_LEVEL > 0) {
+        vdata.farness += CURRENT_LEVEL;
+        ++vdata.reached;
+      }
+    }
+    if (new_bits) level_buckets[CURRENT_LEVEL]->pusher.push_back(vertex.local_id());
+  }
+
+  edge_dir_type scatter_edges(icontext_type& context,
+                              const vertex_type& vertex) const {
+    if (new_bits == 0) return graphlab::NO_EDGES;
+    return DIRECTED ? graphlab::OUT_EDGES : graphlab::ALL_EDGES;
+  }
+
+  void scatter(icontext_type& context, const vertex_type& vertex,
+               edge_type& edge) const {
+    const vertex_type other = get_other_vertex(edge, vertex);
+    if (new_bits & ~other.data().visited) context.signal(other);
+  }
+}; // end of forward_bfs
+
+
+/**
+ * \brief Accumulates the dependencies of all the sources for which the
+ * vertex is at CURRENT_LEVEL from its successors at CURRENT_LEVEL + 1.
+ *
+ *  delta_s(v) = sum_{w : v -> w, d(s,w) = d(s,v) + 1}
+ *                    sigma_s(v) / sigma_s(w) * (1 + delta_s(w))
+ */
+class backward_accumulate :
+  public graphlab::ivertex_program<graph_type, bit_parallel_sum>,
+  public graphlab::IS_POD_TYPE {
+public:
+  edge_dir_type gather_edges(icontext_type& context,
+                             const vertex_type& vertex) const {
+    return DIRECTED ? graphlab::OUT_EDGES : graphlab::ALL_EDGES;
+  }
+
+  bit_parallel_sum gather(icontext_type& context, const vertex_type& vertex,
+                          edge_type& edge) const {
+    const vertex_type other = get_other_vertex(edge, vertex);
+    const vertex_data& odata = other.data();
+    bit_parallel_sum ret;
+    uint64_t b = vertex.data().sources_at_level(CURRENT_LEVEL) & odata.visited;
+    while (b) {
+      size_t i = __builtin_ctzll(b);
+      b &= b - 1;
+      if (odata.level[i] == CURRENT_LEVEL + 1) {
+        ret.bits |= (uint64_t(1) << i);
+        ret.value[i] = (1.0 + odata.delta[i]) / odata.sigma[i];
+      }
+    }
+    return ret;
+  }
+
+  void apply(icontext_type& context, vertex_type& vertex,
+             const bit_parallel_sum& total) {
+    vertex_data& vdata = vertex.data();
+    uint64_t b = total.bits;
+    while (b) {
+      size_t i = __builtin_ctzll(b);
+      b &= b - 1;
+      vdata.delta[i] = vdata.sigma[i] * total.value[i];
+      // a source does not lie on its own paths
+      if (CURRENT_LEVEL > 0) vdata.betweenness += vdata.delta[i];
+    }
+  }
+
+  edge_dir_type scatter_edges(icontext_type& context,
+                              const vertex_type& vertex) const {
+    return graphlab::NO_EDGES;
+  }
+}; // end of backward_accumulate
+
+
+void reset_batch(graph_type::vertex_type& vertex) {
+  vertex.data().reset_batch();
+}
+
+/**
+ * \brief A list of vertex ids combined by concatenation.
+ */
+struct source_list {
+  std::vector<graphlab::vertex_id_type> vids;
+  source_list& operator+=(const source_list& other) {
+    vids.insert(vids.end(), other.vids.begin(), other.vids.end());
+    return *this;
+  }
+  void save(graphlab::oarchive& oarc) const { oarc << vids; }
+  void load(graphlab::iarchive& iarc) { iarc >> vids; }
+};
+
+double SAMPLE_PROBABILITY = 1.0;
+
+source_list select_source(const graph_type::vertex_type& vertex) {
+  source_list ret;
+  if (SAMPLE_PROBABILITY >= 1.0 ||
+      graphlab::random::rand01() < SAMPLE_PROBABILITY) {
+    ret.vids.push_back(vertex.id());
+  }
+  return ret;
+}
+
+/*
+ * Scales the accumulated scores into estimates once all sources are done.
+ */
+double BETWEENNESS_SCALE = 1.0;
+
+struct centrality_writer {
+  std::string save_vertex(graph_type::vertex_type v) {
+    std::stringstream strm;
+    const double closeness = v.data().farness > 0 ?
+        v.data().reached / v.data().farness : 0.0;
+    strm << v.id() << "\t" << v.data().betweenness * BETWEENNESS_SCALE
+         << "\t" << closeness << "\n";
+    return strm.str();
+  }
+  std::string save_edge(graph_type::edge_type e) { return ""; }
+};
+
+
+int main(int argc, char** argv) {
+  // Initialize control plain using mpi
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::distributed_control dc;
+  global_logger().set_log_level(LOG_INFO);
+
+  // Parse command line options -----------------------------------------------
+  graphlab::command_line_options
+    clopts("Approximate betweenness and closeness centrality using "
+           "sampled sources and 64-way bit-parallel BFS. Edge weights "
+           "are ignored.");
+  std::string graph_dir;
+  std::string format = "adj";
+  std::string saveprefix;
+  size_t samplesize = 0;
+  double epsilon = 0;
+  double confidence = 0.95;
+  clopts.attach_option("graph", graph_dir, "The graph file. Required ");
+  clopts.add_positional("graph");
+  clopts.attach_option("format", format, "The graph file format");
+  clopts.attach_option("directed", DIRECTED, "Treat edges as directed.");
+  clopts.attach_option("samplesize", samplesize,
+                       "The expected number of sampled sources. If 0 and "
+                       "epsilon is 0, all vertices are used (exact).");
+  clopts.attach_option("epsilon", epsilon,
+                       "If positive and samplesize is 0, picks the number of "
+                       "sources so that, with the requested confidence, all "
+                       "the estimates are simultaneously within epsilon of "
+                       "their maximum values.");
+  clopts.attach_option("confidence", confidence,
+                       "The confidence of the reported error bounds.");
+  clopts.attach_option("saveprefix", saveprefix,
+                       "If set, will save \"id betweenness closeness\" "
+                       "to a sequence of files with prefix saveprefix");
+
+  if(!clopts.parse(argc, argv)) {
+    dc.cout() << "Error in parsing command line arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (graph_dir == "") {
+    dc.cout() << "Graph not specified. Cannot continue";
+    return EXIT_FAILURE;
+  }
+  if (!(confidence > 0 && confidence < 1)) {
+    dc.cout() << "confidence must be in (0, 1)" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Build the graph ----------------------------------------------------------
+  graph_type graph(dc, clopts);
+  dc.cout() << "Loading graph in format: "<< format << std::endl;
+  graph.load_format(graph_dir, format);
+  graph.finalize();
+  const size_t n = graph.num_vertices();
+  dc.cout() << "#vertices: " << n << " #edges:" << graph.num_edges() << std::endl;
+
+  // Sample the sources -------------------------------------------------------
+  // Hoeffding: with k sources, P(|estimate - exact| >= eps * range)
+  // <= 2 exp(-2 k eps^2) for each vertex, and by the union bound the
+  // estimates of all n vertices are within eps * range with probability
+  // at least 1 - 2 n exp(-2 k eps^2)
+  const double log_term =
+      std::log(2.0 * std::max<size_t>(n, 1) / (1.0 - confidence));
+  if (samplesize == 0 && epsilon > 0) {
+    samplesize = (size_t)std::ceil(log_term / (2 * epsilon * epsilon));
+  }
+  if (samplesize > 0 && samplesize < n) {
+    SAMPLE_PROBABILITY = (double)samplesize / n;
+  }
+  std::vector<graphlab::vertex_id_type> sources =
+      graph.map_reduce_vertices<source_list>(select_source).vids;
+  std::sort(sources.begin(), sources.end());
+  const size_t k = sources.size();
+  if (k == 0) {
+    dc.cout() << "No sources sampled." << std::endl;
+    return EXIT_FAILURE;
+  }
+  dc.cout() << "Using " << k << " sources in "
+            << (k + BATCH_SIZE - 1) / BATCH_SIZE << " batches" << std::endl;
+
+  // Running The Engines ------------------------------------------------------
+  // each engine run processes exactly one level
+  clopts.get_engine_args().set_option("max_iterations", 1);
+  graphlab::synchronous_engine<forward_bfs> forward(dc, graph, clopts);
+  graphlab::synchronous_engine<backward_accumulate> backward(dc, graph, clopts);
+
+  graphlab::timer timer;
+  for (size_t batch_start = 0; batch_start < k; batch_start += BATCH_SIZE) {
+    const size_t batch_end = std::min(k, batch_start + BATCH_SIZE);
+    graph.transform_vertices(reset_batch);
+    for (size_t i = 0; i < level_buckets.size(); ++i) delete level_buckets[i];
+    level_buckets.clear();
+
+    for (size_t i = batch_start; i < batch_end; ++i) {
+      forward.signal(sources[i], source_mask(uint64_t(1) << (i - batch_start)));
+    }
+    // forward sweep: one level per engine run until no frontier grows
+    for (CURRENT_LEVEL = 0; ; ++CURRENT_LEVEL) {
+      level_buckets.push_back(new level_bucket);
+      forward.start();
+      size_t reached = level_buckets[CURRENT_LEVEL]->pusher.size();
+      dc.all_reduce(reached);
+      if (reached == 0) break;
+    }
+    // backward sweep: the deepest level has no dependencies
+    while (CURRENT_LEVEL > 0) {
+      --CURRENT_LEVEL;
+      level_bucket& bucket = *level_buckets[CURRENT_LEVEL];
+      graphlab::vertex_set vset(false);
+      vset.make_explicit(graph);
+      for (size_t i = 0; i < bucket.pusher.size(); ++i) {
+        vset.set_lvid(bucket.lvids[i]);
+      }
+      backward.signal_vset(vset);
+      backward.start();
+    }
+    dc.cout() << "Finished " << batch_end << " of " << k << " sources in "
+              << timer.current_time() << " seconds." << std::endl;
+  }
+  for (size_t i = 0; i < level_buckets.size(); ++i) delete level_buckets[i];
+  level_buckets.clear();
+
+  // every pair is counted from both ends in the undirected case
+  BETWEENNESS_SCALE = (double)n / k;
+  if (!DIRECTED) BETWEENNESS_SCALE /= 2;
+
+  if (k < n) {
+    const double eps = std::sqrt(log_term / (2.0 * k));
+    dc.cout() << "With probability " << confidence << " all betweenness "
+              << "estimates are within " << eps * n * (n - 2)
+              << " of their exact values, and all average distance "
+              << "estimates are within " << eps << " times the diameter."
+              << std::endl;
+  }
+
+  if (saveprefix != "") {
+    graph.save(saveprefix, centrality_writer(),
+               false,  // do not gzip
+               true,   // save vertices
+               false); // do not save edges
+  }
+
+  graphlab::mpi_tools::finalize();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <graphlab.hpp>
+
+/*
+ * HyperANF: approximate neighborhood function and diameter using
+ * HyperLogLog counters.
+ *
+ * P. Boldi, M. Rosa, S. Vigna. HyperANF: Approximating the Neighbourhood
+ * Function of Very Large Graphs on a Budget. WWW 2011.
+ *
+ * Every vertex keeps a HyperLogLog sketch of the set of vertices it can
+ * reach in at most t hops. One hop is a register-wise max over the
+ * sketches of the out-neighbors. Only vertices whose sketch changed in
+ * the last hop signal their in-neighbors, so late hops touch only the
+ * part of the graph that is still growing.
+ */
+
+// Number of index bits. Each sketch has 2^HLL_PRECISION one byte
+// registers; the relative standard error is 1.04 / sqrt(2^HLL_PRECISION).
+const size_t HLL_PRECISION = 7;
+const size_t HLL_REGISTERS = (size_t)1 << HLL_PRECISION;
+
+// The hop currently being computed. Set by main() on every machine
+// before each engine run.
+size_t CURRENT_HOP = 0;
+
+uint64_t HASH_SEED = 0x9e3779b97f4a7c15ULL;
+
+// 64 bit finalizer from MurmurHash3
+inline uint64_t hash_vertex_id(uint64_t x) {
+  x ^= HASH_SEED;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+/*
+ * A HyperLogLog sketch stored as a flat array of byte sized registers.
+ * The sketch is a POD so it is serialized with a single memcpy both as
+ * vertex data and as a gather partial sum.
+ */
+struct hll_sketch : public graphlab::IS_POD_TYPE {
+  uint8_t registers[HLL_REGISTERS];
+
+  hll_sketch() { memset(registers, 0, HLL_REGISTERS); }
+
+  void add(uint64_t hash) {
+    size_t idx = hash >> (64 - HLL_PRECISION);
+    uint64_t rest = hash << HLL_PRECISION;
+    uint8_t rank = (rest == 0) ? (uint8_t)(64 - HLL_PRECISION + 1)
+                               : (uint8_t)(__builtin_clzll(rest) + 1);
+    if (registers[idx] < rank) registers[idx] = rank;
+  }
+
+  /*
+   * Register-wise max with another sketch. Returns true if any
+   * register of this sketch grew.
+   */
+  bool merge(const hll_sketch& other) {
+    bool changed = false;
+#ifdef __SSE2__
+    for (size_t i = 0; i < HLL_REGISTERS; i += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(registers + i));
+      __m128i b = _mm_loadu_si128((const __m128i*)(other.registers + i));
+      __m128i m = _mm_max_epu8(a, b);
+      changed |= (_mm_movemask_epi8(_mm_cmpeq_epi8(a, m)) != 0xFFFF);
+      _mm_storeu_si128((__m128i*)(registers + i), m);
+    }
+#else
+    for (size_t i = 0; i < HLL_REGISTERS; ++i) {
+      if (registers[i] < other.registers[i]) {
+        registers[i] = other.registers[i];
+        changed = true;
+      }
+    }
+#endif
+    return changed;
+  }
+
+  hll_sketch& operator+=(const hll_sketch& other) {
+    merge(other);
+    return *this;
+  }
+
+  // HyperLogLog estimate with linear counting for the small range.
+  double estimate() const {
+    const double m = (double)HLL_REGISTERS;
+    double alpha;
+    if (HLL_REGISTERS == 16) alpha = 0.673;
+    else if (HLL_REGISTERS == 32) alpha = 0.697;
+    else if (HLL_REGISTERS == 64) alpha = 0.709;
+    else alpha = 0.7213 / (1.0 + 1.079 / m);
+    double sum = 0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < HLL_REGISTERS; ++i) {
+      sum += std::ldexp(1.0, -(int)registers[i]);
+      if (registers[i] == 0) ++zeros;
+    }
+    double est = alpha * m * m / sum;
+    if (est <= 2.5 * m && zeros > 0) {
+      est = m * std::log(m / (double)zeros);
+    }
+    return est;
+  }
+};
+
+struct vdata : public graphlab::IS_POD_TYPE {
+  hll_sketch sketch;
+  // the last hop in which the sketch grew
+  size_t last_changed;
+  vdata() : last_changed(0) { }
+};
+
+typedef graphlab::distributed_graph<vdata, graphlab::empty> graph_type;
+
+void initialize_vertex(graph_type::vertex_type& v) {
+  v.data().sketch = hll_sketch();
+  v.data().sketch.add(hash_vertex_id(v.id()));
+  v.data().last_changed = 0;
+}
+
+//B(h + 1; i) = B(h; i) UNION {B(h; k) | source = i & target = k}
+class hll_hop :
+  public graphlab::ivertex_program<graph_type, hll_sketch>,
+  public graphlab::IS_POD_TYPE {
+  bool changed;
+public:
+  hll_hop() : changed(false) { }
+
+  edge_dir_type gather_edges(icontext_type& context,
+                             const vertex_type& vertex) const {
+    return graphlab::OUT_EDGES;
+  }
+
+  hll_sketch gather(icontext_type& context, const vertex_type& vertex,
+                    edge_type& edge) const {
+    return edge.target().data().sketch;
+  }
+
+  void apply(icontext_type& context, vertex_type& vertex,
+             const gather_type& total) {
+    changed = vertex.data().sketch.merge(total);
+    if (changed) vertex.data().last_changed = CURRENT_HOP;
+  }
+
+  // only the in-neighbors of a grown sketch can grow in the next hop
+  edge_dir_type scatter_edges(icontext_type& context,
+                              const vertex_type& vertex) const {
+    return changed ? graphlab::IN_EDGES : graphlab::NO_EDGES;
+  }
+
+  void scatter(icontext_type& context, const vertex_type& vertex,
+               edge_type& edge) const {
+    context.signal(edge.source());
+  }
+};
+
+struct hop_stats : public graphlab::IS_POD_TYPE {
+  double reachable_pairs;
+  size_t num_changed;
+  hop_stats() : reachable_pairs(0), num_changed(0) { }
+  hop_stats& operator+=(const hop_stats& other) {
+    reachable_pairs += other.reachable_pairs;
+    num_changed += other.num_changed;
+    return *this;
+  }
+};
+
+hop_stats compute_hop_stats(const graph_type::vertex_type& vertex) {
+  hop_stats ret;
+  ret.reachable_pairs = vertex.data().sketch.estimate();
+  ret.num_changed = (vertex.data().last_changed == CURRENT_HOP);
+  return ret;
+}
+
+int main(int argc, char** argv) {
+  std::cout << "HyperANF: approximate neighborhood function\n\n";
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::distributed_control dc;
+
+  graphlab::command_line_options clopts(
+                "Approximate neighborhood function and diameter using "
+                "HyperLogLog counters. Directions of edges are considered.");
+  std::string graph_dir;
+  std::string format = "adj";
+  std::string nf_output;
+  size_t max_hops = 1000;
+  float termination_criteria = 0;
+  clopts.attach_option("graph", graph_dir,
+                       "The graph file. This is not optional");
+  clopts.add_positional("graph");
+  clopts.attach_option("format", format,
+                       "The graph file format");
+  clopts.attach_option("tol", termination_criteria,
+                       "Stop when the neighborhood function grows by less "
+                       "than this fraction. If 0, runs until no sketch "
+                       "changes.");
+  clopts.attach_option("max-hops", max_hops,
+                       "The maximum number of hops to compute.");
+  clopts.attach_option("seed", HASH_SEED,
+                       "The seed of the vertex hash function.");
+  clopts.attach_option("nf-output", nf_output,
+                       "If set, the neighborhood function is written to "
+                       "this file, one \"hop value\" line per hop.");
+
+  if (!clopts.parse(argc, argv)){
+    dc.cout() << "Error in parsing command line arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (graph_dir == "") {
+    std::cout << "--graph is not optional\n";
+    return EXIT_FAILURE;
+  }
+
+  graph_type graph(dc, clopts);
+  dc.cout() << "Loading graph in format: "<< format << std::endl;
+  graph.load_format(graph_dir, format);
+  graph.finalize();
+
+  graphlab::timer timer;
+  graph.transform_vertices(initialize_vertex);
+
+  // each engine run computes exactly one hop. Signals issued in the
+  // scatter of one hop are kept by the engine for the next run.
+  clopts.get_engine_args().set_option("max_iterations", 1);
+  graphlab::synchronous_engine<hll_hop> engine(dc, graph, clopts);
+
+  std::vector<double> nf;
+  CURRENT_HOP = 0;
+  nf.push_back(graph.map_reduce_vertices<hop_stats>(compute_hop_stats)
+                    .reachable_pairs);
+  dc.cout() << "0-th hop: " << nf[0] << " vertex pairs are reached\n";
+
+  engine.signal_all();
+  for (CURRENT_HOP = 1; CURRENT_HOP <= max_hops; ++CURRENT_HOP) {
+    engine.start();
+    hop_stats stats = graph.map_reduce_vertices<hop_stats>(compute_hop_stats);
+    if (stats.num_changed == 0) break;
+    nf.push_back(stats.reachable_pairs);
+    dc.cout() << CURRENT_HOP << "-th hop: " << stats.reachable_pairs
+              << " vertex pairs are reached, "
+              << stats.num_changed << " sketches changed\n";
+    if (termination_criteria > 0 &&
+        nf[CURRENT_HOP] < nf[CURRENT_HOP - 1] * (1.0 + termination_criteria)) {
+      break;
+    }
+  }
+  double runtime = timer.current_time();
+
+  // statistics derived from the neighborhood function
+  const size_t diameter = nf.size() - 1;
+  const double total = nf.back();
+  double avg_distance = 0;
+  for (size_t t = 1; t < nf.size(); ++t) {
+    avg_distance += t * (nf[t] - nf[t - 1]);
+  }
+  if (total > nf[0]) avg_distance /= (total - nf[0]);
+  // interpolated 90th percentile of the distance distribution
+  double effective_diameter = 0;
+  for (size_t t = 0; t < nf.size(); ++t) {
+    if (nf[t] >= 0.9 * total) {
+      effective_diameter = t;
+      if (t > 0 && nf[t] > nf[t - 1]) {
+        effective_diameter = (t - 1) +
+            (0.9 * total - nf[t - 1]) / (nf[t] - nf[t - 1]);
+      }
+      break;
+    }
+  }
+
+  dc.cout() << "graph calculation time is " << runtime << " sec\n";
+  dc.cout() << "The approximate diameter is " << diameter << "\n";
+  dc.cout() << "The effective diameter is " << effective_diameter << "\n";
+  dc.cout() << "The average distance is " << avg_distance << "\n";
+
+  if (!nf_output.empty() && dc.procid() == 0) {
+    std::ofstream fout(nf_output.c_str());
+    for (size_t t = 0; t < nf.size(); ++t) {
+      fout << t << "\t" << nf[t] << "\n";
+    }
+  }
+
+  graphlab::mpi_tools::finalize();
+
+  return EXIT_SUCCESS;
+}
@@ -21,8 +21,11 @@
  */
 
 
+#include <limits>
+#include <vector>
 #include <boost/unordered_set.hpp>
 #include <graphlab.hpp>
+#include <graphlab/parallel/lockfree_push_back.hpp>
 #include <graphlab/macros_def.hpp>
 /**
  *
@@ -35,13 +38,26 @@
  *  - Essentially, recursively remove everything with degree 1
  *  - Then recursively remove everything with degree 2
  *  - etc.
+ *
+ * The full decomposition is computed in a single run. Every machine
+ * keeps a bucket queue of its master vertices indexed by their current
+ * degree, so the next K to peel is found by looking at the lowest
+ * non-empty bucket instead of sweeping the graph, and values of K with
+ * no vertices are skipped entirely. Only the vertices in that bucket are
+ * signaled; everything else is reached through the cascade of deletions.
  */
 
 /*
- * Each vertex maintains a "degree" count. If this value
- * is 0, the vertex is "deleted"
+ * Each vertex maintains a "degree" count of the adjacent edges which
+ * have not been deleted, and its core number once it is deleted.
  */
-typedef int vertex_data_type;
+struct vertex_data_type : public graphlab::IS_POD_TYPE {
+  int degree;
+  // -1 while the vertex is not yet deleted
+  int core;
+  vertex_data_type() : degree(0), core(-1) { }
+  bool deleted() const { return core >= 0; }
+};
 
 /*
  * Don't need any edges
@@ -55,7 +71,46 @@ typedef graphlab::distributed_graph<vertex_data_type,
                                     edge_data_type> graph_type;
 
 // The current K to compute
-size_t CURRENT_K;
+int CURRENT_K;
+
+/*
+ * A bucket of vertex ids which may be appended to concurrently
+ * without locks. Entries are never removed: a vertex whose degree drops
+ * is simply appended to its new bucket, and stale entries are skipped
+ * when the bucket is read.
+ */
+struct core_bucket {
+  std::vector<graphlab::vertex_id_type> vids;
+  graphlab::lockfree_push_back<std::vector<graphlab::vertex_id_type> > pusher;
+  core_bucket() : pusher(vids, 0) { }
+};
+
+/*
+ * The bucket queue of the local master vertices. buckets[d] holds the
+ * vertices which had degree d at some point. Buckets are allocated on
+ * first use.
+ */
+std::vector<core_bucket*> buckets;
+
+void bucket_push(int degree, graphlab::vertex_id_type vid) {
+  core_bucket* b = buckets[degree];
+  if (b == NULL) {
+    core_bucket* newb = new core_bucket;
+    if (graphlab::atomic_compare_and_swap(buckets[degree],
+                                          (core_bucket*)NULL, newb)) {
+      b = newb;
+    } else {
+      delete newb;
+      b = buckets[degree];
+    }
+  }
+  b->pusher.push_back(vid);
+}
+
+void bucket_free(int degree) {
+  delete buckets[degree];
+  buckets[degree] = NULL;
+}
 
 /*
  * The core K-core implementation.
@@ -63,9 +118,10 @@ size_t CURRENT_K;
  * Each vertex maintains a count of the number of adjacent edges.
  * If a vertex receives a message, the message contains the number of
  * adjacent edges deleted. The vertex then updates its counter.
- * If the counter falls below K, it deletes itself
- * (set the adjacent count to 0) and signals each of its neighbors
- * with a message of 1.
+ * If the counter falls to K or below, it deletes itself
+ * (its core number is K) and signals each of its neighbors
+ * with a message of 1. Otherwise it moves into the bucket of its
+ * new degree.
  */
 class k_core :
   public graphlab::ivertex_program<graph_type,
@@ -101,18 +157,19 @@ public:
 
   /* On apply, if the vertex has not yet been deleted,
    * decrement the counter on the vertex.
-   * If the adjacency count of the vertex falls below K,
-   * the vertex shall be deleted.
-   * We set the vertex data to 0 to designate that it is deleted
-   * and Set the just_deleted flag to signal the neighbors in scatter
+   * If the adjacency count of the vertex falls to K or below,
+   * the vertex shall be deleted with core number K, and we set the
+   * just_deleted flag to signal the neighbors in scatter.
    */
   void apply(icontext_type& context, vertex_type& vertex,
              const gather_type& unused) {
-    if (vertex.data() > 0) {
-      vertex.data() -= msg;
-      if (vertex.data() < CURRENT_K) {
+    if (!vertex.data().deleted()) {
+      vertex.data().degree -= msg;
+      if (vertex.data().degree <= CURRENT_K) {
         just_deleted = true;
-        vertex.data() = 0;
+        vertex.data().core = CURRENT_K;
+      } else if (msg > 0) {
+        bucket_push(vertex.data().degree, vertex.id());
       }
     }
   } 
@@ -135,7 +192,7 @@ public:
                edge_type& edge) const {
     vertex_type other = edge.source().id() == vertex.id() ?
       edge.target() : edge.source();
-    if (other.data() > 0) {
+    if (!other.data().deleted()) {
       context.signal(other, 1);
     }
   }
@@ -147,58 +204,126 @@ typedef graphlab::synchronous_engine<k_core> engine_type;
 
 /*
  * Called before any graph operation is performed.
- * Initializes all vertex data to the number of adjacent edges.
+ * Initializes all vertex data to the number of adjacent edges
+ * and places the vertex in the bucket of its degree.
  * Can be called from a graph.transform_vertices()
  */
 void initialize_vertex_values(graph_type::vertex_type& v) {
-  v.data() = v.num_in_edges() + v.num_out_edges();
+  v.data().degree = v.num_in_edges() + v.num_out_edges();
+  v.data().core = -1;
+  bucket_push(v.data().degree, v.id());
+}
+
+struct max_degree : public graphlab::IS_POD_TYPE {
+  int value;
+  max_degree(int value = 0) : value(value) { }
+  max_degree& operator+=(const max_degree& other) {
+    value = std::max(value, other.value);
+    return *this;
+  }
+};
+
+max_degree get_degree(const graph_type::vertex_type& v) {
+  return max_degree(v.num_in_edges() + v.num_out_edges());
+}
+
+void min_equal(int& a, const int& b) {
+  a = std::min(a, b);
 }
 
 /*
- * Signals all non-deleted vertices with degree less than K.
- * Can be called from an engine.map_reduce_vertices()
- * We return empty since no reduction is performed. Only the map.
+ * Returns the lowest degree d >= start such that a local vertex which
+ * is not yet deleted has degree d. Buckets below that are empty of live
+ * entries and are released. Returns the largest int if there is none.
  */
-graphlab::empty signal_vertices_at_k(engine_type::icontext_type& ctx,
-                                     const graph_type::vertex_type& vertex) {
-  if (vertex.data() > 0 && vertex.data() < CURRENT_K) {
-    ctx.signal(vertex, 0);
+int next_local_k(graph_type& graph, int start) {
+  for (int d = start; d < (int)buckets.size(); ++d) {
+    if (buckets[d] == NULL) continue;
+    core_bucket& b = *buckets[d];
+    for (size_t i = 0; i < b.pusher.size(); ++i) {
+      const vertex_data_type& vdata = graph.vertex(b.vids[i]).data();
+      if (!vdata.deleted() && vdata.degree == d) return d;
+    }
+    bucket_free(d);
   }
-  return graphlab::empty();
+  return std::numeric_limits<int>::max();
 }
 
 /*
- * Counts the number of un-deleted vertices.
+ * Returns the set of local vertices which are not yet deleted and
+ * have degree exactly k.
  */
-size_t count_active_vertices(const graph_type::vertex_type& vertex) {
-  return vertex.data() > 0;
+graphlab::vertex_set bucket_frontier(graph_type& graph, int k) {
+  graphlab::vertex_set frontier(false);
+  frontier.make_explicit(graph);
+  if (k < (int)buckets.size() && buckets[k] != NULL) {
+    core_bucket& b = *buckets[k];
+    for (size_t i = 0; i < b.pusher.size(); ++i) {
+      graph_type::vertex_type vtx = graph.vertex(b.vids[i]);
+      if (!vtx.data().deleted() && vtx.data().degree == k) {
+        frontier.set_lvid(vtx.local_id());
+      }
+    }
+  }
+  return frontier;
+}
+
+// per machine histograms of core numbers, indexed by core number
+std::vector<size_t> vertex_core_count;
+std::vector<size_t> edge_core_count;
+
+/*
+ * Counts the vertex in the histogram of core numbers.
+ * Can be called from a graph.map_reduce_vertices()
+ */
+graphlab::empty count_vertex_core(const graph_type::vertex_type& vertex) {
+  __sync_fetch_and_add(&vertex_core_count[vertex.data().core], 1);
+  return graphlab::empty();
 }
 
 /*
- * Counts the degree of each un-deleted vertex. Half of this
- * will be the size of the K-core graph.
+ * An edge belongs to every K-core with K at most the smaller core
+ * number of its endpoints. Can be called from a graph.map_reduce_edges()
  */
-size_t double_count_active_edges(const graph_type::vertex_type& vertex) {
-  return (size_t) vertex.data();
+graphlab::empty count_edge_core(const graph_type::edge_type& edge) {
+  int core = std::min(edge.source().data().core, edge.target().data().core);
+  __sync_fetch_and_add(&edge_core_count[core], 1);
+  return graphlab::empty();
+}
+
+void vector_plus_equal(std::vector<size_t>& a, const std::vector<size_t>& b) {
+  for (size_t i = 0; i < a.size(); ++i) a[i] += b[i];
 }
 
 
 
 /*
  * Saves the graph in a tsv format with the condition that
- * the adjacent vertices have not yet been deleted.
+ * both adjacent vertices are in the K-core.
  * This allows saving of the k-core graph.
  */
 struct save_core_at_k {
   std::string save_vertex(graph_type::vertex_type) { return ""; }
   std::string save_edge(graph_type::edge_type e) {
-    if (e.source().data() > 0 && e.target().data() > 0) {
+    if (e.source().data().core >= CURRENT_K &&
+        e.target().data().core >= CURRENT_K) {
       return graphlab::tostr(e.source().id()) + "\t" +
         graphlab::tostr(e.target().id()) + "\n";
     }
     else return "";
   }
 };
+
+/*
+ * Saves the core number of every vertex in a tsv format.
+ */
+struct save_core_number {
+  std::string save_vertex(graph_type::vertex_type v) {
+    return graphlab::tostr(v.id()) + "\t" +
+      graphlab::tostr(v.data().core) + "\n";
+  }
+  std::string save_edge(graph_type::edge_type e) { return ""; }
+};
     
 int main(int argc, char** argv) {
   std::cout << "Computes a k-core decomposition of a graph.\n\n";
@@ -213,6 +338,7 @@ int main(int argc, char** argv) {
   size_t kmin = 0;
   size_t kmax = (size_t)(-1);
   std::string savecores;
+  std::string savecorenumbers;
   clopts.attach_option("graph", prefix,
                        "Graph input. reads all graphs matching prefix*");
   clopts.attach_option("format", format,
@@ -223,6 +349,9 @@ int main(int argc, char** argv) {
                        "Compute the k-Core for k the range [kmin,kmax]");
   clopts.attach_option("savecores", savecores,
                        "If non-empty, will save tsv of each core with prefix [savecores].K.");
+  clopts.attach_option("savecorenumbers", savecorenumbers,
+                       "If non-empty, will save the core number of each vertex "
+                       "as a tsv with prefix [savecorenumbers].");
 
   if(!clopts.parse(argc, argv)) return EXIT_FAILURE;
   if (prefix == "") {
@@ -254,18 +383,45 @@ int main(int argc, char** argv) {
 
   graphlab::synchronous_engine<k_core> engine(dc, graph, clopts);
 
-  // initialize the vertex data with the degree
+  // initialize the vertex data with the degree and fill the buckets
+  int maxdegree = graph.map_reduce_vertices<max_degree>(get_degree).value;
+  buckets.resize(maxdegree + 1, NULL);
   graph.transform_vertices(initialize_vertex_values);
 
-  // for each K value
-  for (CURRENT_K = kmin; CURRENT_K <= kmax; CURRENT_K++) {
-    // signal all vertices with degree less than K
-    engine.map_reduce_vertices<graphlab::empty>(signal_vertices_at_k);
-    // recursively delete all vertices with degree less than K
+  // peel each non-empty K in increasing order
+  int maxcore = 0;
+  CURRENT_K = next_local_k(graph, 0);
+  dc.all_reduce2(CURRENT_K, min_equal);
+  while (CURRENT_K != std::numeric_limits<int>::max()) {
+    maxcore = CURRENT_K;
+    // signal all vertices with degree K
+    engine.signal_vset(bucket_frontier(graph, CURRENT_K));
+    // recursively delete all vertices with degree at most K
     engine.start();
-    // count the number of vertices and edges remaining
-    size_t numv = graph.map_reduce_vertices<size_t>(count_active_vertices);
-    size_t nume = graph.map_reduce_vertices<size_t>(double_count_active_edges) / 2;
+    bucket_free(CURRENT_K);
+    CURRENT_K = next_local_k(graph, CURRENT_K + 1);
+    dc.all_reduce2(CURRENT_K, min_equal);
+  }
+  dc.cout() << "Decomposition completed in " << ti.current_time()
+            << " seconds. Maximum core number: " << maxcore << std::endl;
+
+  // count the number of vertices and edges of each K-core in one pass
+  vertex_core_count.resize(maxcore + 1, 0);
+  edge_core_count.resize(maxcore + 1, 0);
+  graph.map_reduce_vertices<graphlab::empty>(count_vertex_core);
+  graph.map_reduce_edges<graphlab::empty>(count_edge_core);
+  dc.all_reduce2(vertex_core_count, vector_plus_equal);
+  dc.all_reduce2(edge_core_count, vector_plus_equal);
+  // the K-core contains everything with core number at least K
+  for (int k = maxcore - 1; k >= 0; --k) {
+    vertex_core_count[k] += vertex_core_count[k + 1];
+    edge_core_count[k] += edge_core_count[k + 1];
+  }
+
+  for (CURRENT_K = kmin;
+       CURRENT_K <= maxcore && (size_t)CURRENT_K <= kmax; CURRENT_K++) {
+    size_t numv = vertex_core_count[CURRENT_K];
+    size_t nume = edge_core_count[CURRENT_K];
     if (numv == 0) break;
     // Output the size of the graph
     dc.cout() << "K=" << CURRENT_K << ":  #V = "
@@ -281,8 +437,16 @@ int main(int argc, char** argv) {
                  clopts.get_ncpus()); /* one file per machine */
     }
   }
+
+  if (savecorenumbers != "") {
+    graph.save(savecorenumbers,
+               save_core_number(),
+               false, /* no compression */
+               true, /* save vertex */
+               false, /* do not save edge */
+               clopts.get_ncpus()); /* one file per machine */
+  }
   
   graphlab::mpi_tools::finalize();
   return EXIT_SUCCESS;
 } // End of main
-
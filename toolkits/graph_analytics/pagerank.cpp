@@ -101,6 +101,8 @@ public:
     const double newval = (1.0 - RESET_PROB) * total + RESET_PROB;
     last_change = (newval - vertex.data());
     vertex.data() = newval;
+    // lets the engine stop on the residual_l1 and residual_linf options
+    context.report_residual(vertex, last_change);
     if (ITERATIONS) context.signal(vertex);
   }
 
@@ -76,17 +76,45 @@ get_other_vertex(const graph_type::edge_type& edge,
 bool DIRECTED_SSSP = false;
 
 
+/**
+ * \brief The delta-stepping bucket width. If 0, delta-stepping is not used.
+ *
+ * Edges no longer than DELTA are "light" and edges longer than DELTA are
+ * "heavy". When the distance of a vertex improves only its light edges
+ * are relaxed right away. The heavy edges are relaxed once, when the
+ * vertex is revisited at its settled distance, since their targets fall
+ * into later buckets anyway.
+ */
+distance_type DELTA = 0;
+
+
 /**
  * \brief This class is used as the gather type.
  */
 struct min_distance_type : graphlab::IS_POD_TYPE {
   distance_type dist;
+  // set on the message a vertex sends itself to relax its heavy edges
+  bool relax_heavy;
   min_distance_type(distance_type dist = 
-                    std::numeric_limits<distance_type>::max()) : dist(dist) { }
+                    std::numeric_limits<distance_type>::max(),
+                    bool relax_heavy = false) :
+    dist(dist), relax_heavy(relax_heavy) { }
   min_distance_type& operator+=(const min_distance_type& other) {
-    dist = std::min(dist, other.dist);
+    if (other.dist < dist) {
+      (*this) = other;
+    } else if (other.dist == dist) {
+      relax_heavy = relax_heavy || other.relax_heavy;
+    }
     return *this;
   }
+  /**
+   * Closer vertices have higher priority. Heavy edge relaxations are
+   * deferred to the next bucket so that they run after the light edges
+   * of the current bucket have settled.
+   */
+  double priority() const {
+    return relax_heavy ? -(dist + DELTA) : -dist;
+  }
 };
 
 
@@ -99,13 +127,16 @@ class sssp :
                                    min_distance_type>,
   public graphlab::IS_POD_TYPE {
   distance_type min_dist;
+  bool relax_heavy;
   bool changed;
+  bool settled;
 public:
 
 
   void init(icontext_type& context, const vertex_type& vertex,
             const min_distance_type& msg) {
     min_dist = msg.dist;
+    relax_heavy = msg.relax_heavy;
   } 
 
   /**
@@ -133,9 +164,14 @@ public:
   void apply(icontext_type& context, vertex_type& vertex,
              const graphlab::empty& empty) {
     changed = false;
+    settled = false;
     if(vertex.data().dist > min_dist) {
       changed = true;
       vertex.data().dist = min_dist;
+      // come back to the heavy edges once the distance has settled
+      if (DELTA > 0) context.signal(vertex, min_distance_type(min_dist, true));
+    } else if (relax_heavy && vertex.data().dist == min_dist) {
+      settled = true;
     }
   }
 
@@ -144,7 +180,7 @@ public:
    */
   edge_dir_type scatter_edges(icontext_type& context, 
                              const vertex_type& vertex) const {
-    if(changed)
+    if(changed || settled)
       return DIRECTED_SSSP? graphlab::OUT_EDGES : graphlab::ALL_EDGES; 
     else return graphlab::NO_EDGES;
   }; // end of scatter_edges
@@ -154,6 +190,11 @@ public:
    */
   void scatter(icontext_type& context, const vertex_type& vertex,
                edge_type& edge) const {
+    if (DELTA > 0) {
+      // light edges are relaxed on change, heavy edges once settled
+      const bool heavy = edge.data().dist > DELTA;
+      if (heavy != settled) return;
+    }
     const vertex_type other = get_other_vertex(edge, vertex);
     distance_type newd = vertex.data().dist + edge.data().dist;
     if (other.data().dist > newd) {
@@ -233,6 +274,10 @@ int main(int argc, char** argv) {
 
   clopts.attach_option("engine", exec_type, 
                        "The engine type synchronous or asynchronous");
+  clopts.attach_option("delta", DELTA,
+                       "If positive, runs delta-stepping with buckets of this "
+                       "width on the asynchronous engine with the \"delta\" "
+                       "scheduler.");
  
   
   clopts.attach_option("powerlaw", powerlaw,
@@ -288,6 +333,12 @@ int main(int argc, char** argv) {
 
 
   // Running The Engine -------------------------------------------------------
+  if (DELTA > 0) {
+    exec_type = "asynchronous";
+    clopts.set_scheduler_type("delta");
+    clopts.get_scheduler_args().set_option("delta", DELTA);
+    dc.cout() << "Delta-stepping with delta = " << DELTA << std::endl;
+  }
   graphlab::omni_engine<sssp> engine(dc, graph, exec_type, clopts);
 
 
@@ -0,0 +1,480 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ *
+ */
+
+
+/**
+ * Functionality: The code solves the linear system Ax = b using
+ * Krylov subspace methods (A is a square sparse matrix):
+ *
+ *  - cg: preconditioned conjugate gradient. A must be symmetric
+ *    positive definite.
+ *    http://en.wikipedia.org/wiki/Conjugate_gradient_method
+ *  - gmres: restarted GMRES with right preconditioning. A may be any
+ *    nonsingular matrix.
+ *    http://en.wikipedia.org/wiki/Generalized_minimal_residual_method
+ *
+ * Both methods use the diagonal (Jacobi) preconditioner M = diag(A).
+ *
+ * The matrix is stored as a graph: A_ii is kept on vertex i and every
+ * off diagonal entry A_ij is an edge i -> j. Sparse matrix vector
+ * products are computed with graph_gather_apply, which runs the apply
+ * on every replica of a vertex, so the product is consistent across
+ * machines without a separate synchronization. All the other vector
+ * operations are element-wise and are therefore applied in place on
+ * every replica as well; only the dot products communicate.
+ */
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cmath>
+#include <boost/unordered_map.hpp>
+#include <graphlab.hpp>
+#include <graphlab/macros_def.hpp>
+
+
+struct vertex_data {
+  double diag;
+  double b;
+  double x;
+  // residual b - Ax
+  double r;
+  // CG search direction
+  double p;
+  // output of the last matrix vector product
+  double Ap;
+  // GMRES Krylov basis, restart + 1 columns
+  std::vector<double> basis;
+
+  vertex_data(double diag = 0) :
+    diag(diag), b(0), x(0), r(0), p(0), Ap(0) { }
+
+  void save(graphlab::oarchive& arc) const {
+    arc << diag << b << x << r << p << Ap << basis;
+  }
+  void load(graphlab::iarchive& arc) {
+    arc >> diag >> b >> x >> r >> p >> Ap >> basis;
+  }
+}; // end of vertex_data
+
+struct edge_data : public graphlab::IS_POD_TYPE {
+  double val;
+  edge_data(double val = 0) : val(val) { }
+}; // end of edge data
+
+typedef graphlab::distributed_graph<vertex_data, edge_data> graph_type;
+
+
+bool use_precond = true;
+
+inline double inv_diag(const vertex_data& vdata) {
+  return (use_precond && vdata.diag != 0) ? 1.0 / vdata.diag : 1.0;
+}
+
+
+/**
+ * \brief The graph loader. Each line is "row col value"; lines starting
+ * with '%' or '#' are comments.
+ */
+inline bool graph_loader(graph_type& graph,
+                         const std::string& filename,
+                         const std::string& line) {
+  if (line.empty() || line[0] == '%' || line[0] == '#') return true;
+  std::stringstream strm(line);
+  graph_type::vertex_id_type row(-1), col(-1);
+  double val = 0;
+  strm >> row >> col >> val;
+  if (strm.fail()) {
+    logstream(LOG_ERROR) << "Failed to parse line: " << line << std::endl;
+    return false;
+  }
+  if (row == col) graph.add_vertex(row, vertex_data(val));
+  else graph.add_edge(row, col, edge_data(val));
+  return true;
+} // end of graph_loader
+
+
+/*
+ * Sparse matrix vector product --------------------------------------------
+ */
+enum spmv_input_type { SPMV_X, SPMV_P, SPMV_BASIS };
+
+// the vector multiplied by the next graph_gather_apply exec
+spmv_input_type SPMV_INPUT = SPMV_X;
+// the basis column multiplied when SPMV_INPUT == SPMV_BASIS
+size_t BASIS_COLUMN = 0;
+
+inline double spmv_input(const vertex_data& vdata) {
+  switch(SPMV_INPUT) {
+  case SPMV_X: return vdata.x;
+  case SPMV_P: return vdata.p;
+  // right preconditioning: multiply by A M^-1
+  default: return vdata.basis[BASIS_COLUMN] * inv_diag(vdata);
+  }
+}
+
+double spmv_gather(graphlab::lvid_type lvid, graph_type& graph) {
+  double sum = 0;
+  foreach(const graph_type::local_edge_type& edge,
+          graph.l_vertex(lvid).out_edges()) {
+    sum += edge.data().val * spmv_input(edge.target().data());
+  }
+  return sum;
+}
+
+void spmv_apply(graphlab::lvid_type lvid, const double& accum,
+                graph_type& graph) {
+  vertex_data& vdata = graph.l_vertex(lvid).data();
+  vdata.Ap = vdata.diag * spmv_input(vdata) + accum;
+}
+
+typedef graphlab::graph_gather_apply<graph_type, double> spmv_type;
+
+
+/**
+ * \brief Applies an element-wise vector update to every replica. Every
+ * replica holds the same inputs so no synchronization is required.
+ */
+void update_local(graph_type& graph, void (*update)(vertex_data&)) {
+#ifdef _OPENMP
+  #pragma omp parallel for
+#endif
+  for (int i = 0; i < (int)graph.num_local_vertices(); ++i) {
+    update(graph.l_vertex(i).data());
+  }
+}
+
+// scalars of the element-wise updates, identical on every machine
+double ALPHA = 0;
+double BETA = 0;
+std::vector<double> COEFFS;
+size_t RESTART = 30;
+
+void set_rhs_ones(graph_type::vertex_type& v) { v.data().b = 1; }
+void set_residual(vertex_data& v) { v.r = v.b - v.Ap; }
+
+double norm2_b(const graph_type::vertex_type& v) {
+  return v.data().b * v.data().b;
+}
+double norm2_r(const graph_type::vertex_type& v) {
+  return v.data().r * v.data().r;
+}
+double norm2_Ap(const graph_type::vertex_type& v) {
+  return v.data().Ap * v.data().Ap;
+}
+
+
+/*
+ * Conjugate gradient --------------------------------------------------------
+ */
+void cg_init(vertex_data& v) {
+  v.r = v.b - v.Ap;
+  v.p = v.r * inv_diag(v);
+}
+void cg_step(vertex_data& v) {
+  v.x += ALPHA * v.p;
+  v.r -= ALPHA * v.Ap;
+}
+void cg_direction(vertex_data& v) {
+  v.p = v.r * inv_diag(v) + BETA * v.p;
+}
+
+double dot_p_Ap(const graph_type::vertex_type& v) {
+  return v.data().p * v.data().Ap;
+}
+
+struct residual_dots : public graphlab::IS_POD_TYPE {
+  double rr, rz;
+  residual_dots() : rr(0), rz(0) { }
+  residual_dots& operator+=(const residual_dots& other) {
+    rr += other.rr;
+    rz += other.rz;
+    return *this;
+  }
+};
+
+residual_dots compute_residual_dots(const graph_type::vertex_type& v) {
+  residual_dots ret;
+  ret.rr = v.data().r * v.data().r;
+  ret.rz = ret.rr * inv_diag(v.data());
+  return ret;
+}
+
+size_t run_cg(graph_type& graph, spmv_type& spmv,
+              size_t max_iter, double tol, double bnorm) {
+  SPMV_INPUT = SPMV_X;
+  spmv.exec();
+  update_local(graph, cg_init);
+  residual_dots dots =
+      graph.map_reduce_vertices<residual_dots>(compute_residual_dots);
+  size_t iter = 0;
+  SPMV_INPUT = SPMV_P;
+  while (iter < max_iter && std::sqrt(dots.rr) > tol * bnorm) {
+    spmv.exec();
+    const double pAp = graph.map_reduce_vertices<double>(dot_p_Ap);
+    if (pAp <= 0) {
+      logstream(LOG_WARNING) << "p'Ap = " << pAp << " <= 0: the matrix is "
+                             << "not positive definite." << std::endl;
+      break;
+    }
+    ALPHA = dots.rz / pAp;
+    update_local(graph, cg_step);
+    residual_dots next =
+        graph.map_reduce_vertices<residual_dots>(compute_residual_dots);
+    BETA = next.rz / dots.rz;
+    dots = next;
+    update_local(graph, cg_direction);
+    ++iter;
+    logstream(LOG_INFO) << "Iteration " << iter << " residual "
+                        << std::sqrt(dots.rr) / bnorm << std::endl;
+  }
+  return iter;
+}
+
+
+/*
+ * Restarted GMRES -----------------------------------------------------------
+ */
+struct dot_products {
+  std::vector<double> values;
+  dot_products& operator+=(const dot_products& other) {
+    if (values.empty()) values = other.values;
+    else for (size_t i = 0; i < other.values.size(); ++i) {
+      values[i] += other.values[i];
+    }
+    return *this;
+  }
+  void save(graphlab::oarchive& arc) const { arc << values; }
+  void load(graphlab::iarchive& arc) { arc >> values; }
+};
+
+// Ap . basis[i] for all columns i <= BASIS_COLUMN
+dot_products basis_dots(const graph_type::vertex_type& v) {
+  dot_products ret;
+  ret.values.resize(BASIS_COLUMN + 1);
+  for (size_t i = 0; i <= BASIS_COLUMN; ++i) {
+    ret.values[i] = v.data().Ap * v.data().basis[i];
+  }
+  return ret;
+}
+
+void gmres_start(vertex_data& v) {
+  v.r = v.b - v.Ap;
+  v.basis.assign(RESTART + 1, 0);
+  v.basis[0] = v.r * ALPHA;
+}
+void gmres_orthogonalize(vertex_data& v) {
+  for (size_t i = 0; i < COEFFS.size(); ++i) v.Ap -= COEFFS[i] * v.basis[i];
+}
+void gmres_extend(vertex_data& v) {
+  v.basis[BASIS_COLUMN + 1] = v.Ap * ALPHA;
+}
+void gmres_update_x(vertex_data& v) {
+  double sum = 0;
+  for (size_t i = 0; i < COEFFS.size(); ++i) sum += COEFFS[i] * v.basis[i];
+  v.x += sum * inv_diag(v);
+}
+
+size_t run_gmres(graph_type& graph, spmv_type& spmv,
+                 size_t max_iter, double tol, double bnorm) {
+  size_t iter = 0;
+  // upper Hessenberg matrix, column major, and its Givens rotations
+  std::vector<std::vector<double> > H(RESTART, std::vector<double>(RESTART + 1));
+  std::vector<double> cs(RESTART), sn(RESTART), g(RESTART + 1);
+  while (true) {
+    SPMV_INPUT = SPMV_X;
+    spmv.exec();
+    update_local(graph, set_residual);
+    const double beta = std::sqrt(graph.map_reduce_vertices<double>(norm2_r));
+    if (iter >= max_iter || beta <= tol * bnorm) break;
+    ALPHA = 1.0 / beta;
+    update_local(graph, gmres_start);
+    std::fill(g.begin(), g.end(), 0);
+    g[0] = beta;
+
+    SPMV_INPUT = SPMV_BASIS;
+    size_t k = 0;
+    while (k < RESTART && iter < max_iter) {
+      BASIS_COLUMN = k;
+      spmv.exec();
+      std::vector<double>& h = H[k];
+      std::fill(h.begin(), h.end(), 0);
+      // classical Gram-Schmidt applied twice: one reduction per pass
+      for (size_t pass = 0; pass < 2; ++pass) {
+        COEFFS = graph.map_reduce_vertices<dot_products>(basis_dots).values;
+        update_local(graph, gmres_orthogonalize);
+        for (size_t i = 0; i <= k; ++i) h[i] += COEFFS[i];
+      }
+      h[k + 1] = std::sqrt(graph.map_reduce_vertices<double>(norm2_Ap));
+      if (h[k + 1] > 0) {
+        ALPHA = 1.0 / h[k + 1];
+        update_local(graph, gmres_extend);
+      }
+      // reduce the new column to upper triangular form
+      for (size_t i = 0; i < k; ++i) {
+        const double tmp = cs[i] * h[i] + sn[i] * h[i + 1];
+        h[i + 1] = -sn[i] * h[i] + cs[i] * h[i + 1];
+        h[i] = tmp;
+      }
+      const double denom = std::sqrt(h[k] * h[k] + h[k + 1] * h[k + 1]);
+      cs[k] = denom > 0 ? h[k] / denom : 1;
+      sn[k] = denom > 0 ? h[k + 1] / denom : 0;
+      h[k] = denom;
+      h[k + 1] = 0;
+      g[k + 1] = -sn[k] * g[k];
+      g[k] = cs[k] * g[k];
+      ++k; ++iter;
+      logstream(LOG_INFO) << "Iteration " << iter << " residual "
+                          << std::fabs(g[k]) / bnorm << std::endl;
+      if (std::fabs(g[k]) <= tol * bnorm || denom == 0) break;
+    }
+    // solve the triangular system and update x
+    COEFFS.assign(k, 0);
+    for (int i = (int)k - 1; i >= 0; --i) {
+      double sum = g[i];
+      for (size_t j = i + 1; j < k; ++j) sum -= H[j][i] * COEFFS[j];
+      COEFFS[i] = H[i][i] != 0 ? sum / H[i][i] : 0;
+    }
+    update_local(graph, gmres_update_x);
+  }
+  return iter;
+}
+
+
+struct solution_saver {
+  typedef graph_type::vertex_type vertex_type;
+  typedef graph_type::edge_type   edge_type;
+  std::string save_vertex(const vertex_type& vertex) const {
+    std::stringstream strm;
+    strm.precision(16);
+    strm << vertex.id() << " " << vertex.data().x << "\n";
+    return strm.str();
+  }
+  std::string save_edge(const edge_type& edge) const {
+    return "";
+  }
+};
+
+// right hand side entries read from --rhs, keyed by vertex id
+boost::unordered_map<graphlab::vertex_id_type, double> rhs_values;
+void set_rhs(graph_type::vertex_type& v) {
+  boost::unordered_map<graphlab::vertex_id_type, double>::const_iterator it =
+      rhs_values.find(v.id());
+  v.data().b = (it == rhs_values.end()) ? 0 : it->second;
+}
+
+
+int main(int argc, char** argv) {
+  global_logger().set_log_to_console(true);
+
+  // Parse command line options -----------------------------------------------
+  const std::string description =
+    "Solve a linear system using conjugate gradient or restarted GMRES";
+  graphlab::command_line_options clopts(description);
+  std::string input_dir;
+  std::string rhs_file;
+  std::string method = "cg";
+  std::string saveprefix = "x.out";
+  size_t max_iter = 1000;
+  double tol = 1e-8;
+  int quiet = 0;
+  clopts.attach_option("matrix", input_dir,
+      "The directory or file prefix containing \"row col value\" lines");
+  clopts.add_positional("matrix");
+  clopts.attach_option("rhs", rhs_file,
+      "File of \"row value\" lines with the right hand side b. "
+      "If not given, b is all ones.");
+  clopts.attach_option("method", method, "cg or gmres");
+  clopts.attach_option("restart", RESTART, "GMRES restart length");
+  clopts.attach_option("precond", use_precond,
+      "Use the diagonal (Jacobi) preconditioner");
+  clopts.attach_option("max_iter", max_iter, "max iterations");
+  clopts.attach_option("tol", tol,
+      "convergence threshold on ||b - Ax|| / ||b||");
+  clopts.attach_option("saveprefix", saveprefix, "prefix of the output files");
+  clopts.attach_option("quiet", quiet, "quiet mode (less verbose)");
+  if(!clopts.parse(argc, argv) || input_dir == "") {
+    std::cout << "Error in parsing command line arguments." << std::endl;
+    clopts.print_description();
+    return EXIT_FAILURE;
+  }
+  if (method != "cg" && method != "gmres") {
+    std::cout << "Unknown method " << method << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (RESTART == 0) {
+    std::cout << "restart must be positive" << std::endl;
+    return EXIT_FAILURE;
+  }
+  global_logger().set_log_level(quiet ? LOG_ERROR : LOG_INFO);
+
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::distributed_control dc;
+
+  dc.cout() << "Loading graph." << std::endl;
+  graphlab::timer timer;
+  graph_type graph(dc, clopts);
+  graph.load(input_dir, graph_loader);
+  graph.finalize();
+  dc.cout() << "Loading graph. Finished in "
+    << timer.current_time() << std::endl;
+  dc.cout() << "Num rows: " << graph.num_vertices()
+            << " Num off diagonal entries: " << graph.num_edges() << std::endl;
+
+  if (rhs_file.empty()) {
+    graph.transform_vertices(set_rhs_ones);
+  } else {
+    std::ifstream fin(rhs_file.c_str());
+    if (!fin.good())
+      logstream(LOG_FATAL) << "Failed to open " << rhs_file << std::endl;
+    graphlab::vertex_id_type row;
+    double val;
+    while (fin >> row >> val) rhs_values[row] = val;
+    graph.transform_vertices(set_rhs);
+    rhs_values.clear();
+  }
+  const double bnorm = std::sqrt(graph.map_reduce_vertices<double>(norm2_b));
+  if (bnorm == 0)
+    logstream(LOG_FATAL) << "The right hand side is zero" << std::endl;
+
+  spmv_type spmv(graph, spmv_gather, spmv_apply, clopts);
+
+  dc.cout() << "Running " << method << std::endl;
+  timer.start();
+  const size_t iter = (method == "cg") ?
+      run_cg(graph, spmv, max_iter, tol, bnorm) :
+      run_gmres(graph, spmv, max_iter, tol, bnorm);
+  const double runtime = timer.current_time();
+
+  // report the true residual
+  SPMV_INPUT = SPMV_X;
+  spmv.exec();
+  update_local(graph, set_residual);
+  const double residual =
+      std::sqrt(graph.map_reduce_vertices<double>(norm2_r)) / bnorm;
+  dc.cout() << "----------------------------------------------------------"
+            << std::endl
+            << "Iterations: " << iter << std::endl
+            << "Relative residual: " << residual << std::endl
+            << "Final Runtime (seconds): " << runtime << std::endl;
+
+  graph.save(saveprefix, solution_saver(), false, true, false);
+  graphlab::mpi_tools::finalize();
+  return EXIT_SUCCESS;
+}
+#include <graphlab/macros_undef.hpp>